@@ -9,11 +9,42 @@
 #define I2C_PORT i2c0           // Define the I2C port
 #define I2C_SDA_PIN 16          // Define the SDA pin for I2C
 #define I2C_SCL_PIN 17          // Define the SCL pin for I2C
+#define I2C_BAUDRATE 400000     // I2C clock. The RP2040 can run fast-mode plus (1000000), but the LIS3DH is only rated for 400 kHz
 #define LIS3DH_I2C_ADDRESS 0x19 // The I2C address of the LIS3DH
+#define LIS3DH_DATA_RATE LIS3DH_ODR_25HZ // Accelerometer output data rate (see LIS3DHDataRate)
+#define LIS3DH_RANGE LIS3DH_RANGE_2G      // Accelerometer full scale (see LIS3DHRange)
+#define LIS3DH_MODE LIS3DH_MODE_NORMAL    // Accelerometer resolution (see LIS3DHMode)
+#define LIS3DH_FIFO_WATERMARK 16 // FIFO level (0-31) above which the LIS3DH raises its watermark interrupt
+#define ACCELEROMETER_STREAM_QUEUE_LENGTH 256 // Samples that can wait to be streamed over Bluetooth (a power of two)
+#define BLUETOOTH_TX_BUFFER_SIZE 2048 // Bytes of telemetry that can wait for the Bluetooth UART (a power of two)
 #define BUTTON_PIN 15           // GPIO pin for the button (SWI)
-#define BUFFER_SIZE 1024        // Define buffer size for reading samples
-#define FFT_SIZE 1024           // Define the size of the FFT (must be a power of 2)
+#ifndef FFT_SIZE
+#define FFT_SIZE 1024           // Size of the microphone FFT (256, 512, 1024 or 2048; normally set by CMake)
+#endif
 #define DC_OFFSET 2048          // Example DC offset value, modify based on your microphone
+#define MIC_GPIO_PIN 26         // GPIO pin (ADC input) the microphone is connected to
+#define MIC_SAMPLE_RATE 44100   // Microphone sample rate in Hz
+#define MIC_CAPTURE_BUFFERS 4   // Number of DMA capture buffers used when streaming (at least 2)
+#define LED_BAND_LOW_HZ 250     // Lower edge of the lowest LED frequency band (bands are log spaced up to Nyquist)
+#ifndef MIC_ANALYZER_GOERTZEL
+#define MIC_ANALYZER_GOERTZEL 0 // Analyse the microphone with a Goertzel resonator per LED band instead of the FFT (normally set by CMake)
+#endif
+#if MIC_ANALYZER_GOERTZEL
+#define STFT_HOP_SIZE 128       // Samples between successive band updates (2.9 ms; the resonators need no frame overlap)
+#else
+#define STFT_HOP_SIZE 256       // Samples between successive FFT frames (FFT_SIZE / 4 = 75% overlap)
+#endif
+#ifndef MIC_DUAL_CORE
+#define MIC_DUAL_CORE 1         // Run microphone capture and analysis on core 1 (normally set by CMake)
+#endif
+#define MIC_FRAME_QUEUE_LENGTH 8 // Analysed frames that can wait for core 0 in dual core mode (a power of two)
+
+// Task periods (microseconds). Each task's step runs on deadlines spaced by its period.
+#define LED_TASK_PERIOD_US 50000            // Snake animation speed
+#define ACCELEROMETER_TASK_PERIOD_US 100000 // Tilt display update rate
+#define MICROPHONE_TASK_PERIOD_US (STFT_HOP_SIZE * 1000000ull / MIC_SAMPLE_RATE) // One hop of audio
+#define BLUETOOTH_TASK_PERIOD_US 500000     // Rate at which readings are sent to the Bluetooth module
+#define SCHEDULER_STATS_PERIOD_US 10000000  // How often the scheduler timing statistics are printed
 
 // Global Variables
 extern volatile Tasks current_task;
@@ -0,0 +1,143 @@
+#ifndef LED_COLOR_H
+#define LED_COLOR_H
+
+#include <stdint.h>
+#include <array>
+
+// Colour tables for the LED driver and tasks. Everything here is generated by the compiler, so the
+// RP2040 (which has no FPU) only ever does table lookups and integer multiplies at run time.
+
+#define HUE_WHEEL_STEPS 360 // One entry per degree of hue
+#define LED_GAMMA 2.2       // Gamma of the LED brightness curve
+
+struct RGBColor {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+};
+
+/*! \brief Build a fully saturated HSV colour wheel.
+ *
+ * Entry `h` holds the colour for a hue of `h` degrees at brightness `value` (0-255). The
+ * arithmetic matches the original floating point `hueToRGB` exactly.
+ */
+constexpr std::array<RGBColor, HUE_WHEEL_STEPS> make_hue_wheel(float value)
+{
+    std::array<RGBColor, HUE_WHEEL_STEPS> wheel {};
+    for (unsigned int hue = 0; hue < HUE_WHEEL_STEPS; ++hue) {
+        float s = 1.0;  // Maximum saturation
+        float v = value;
+        float h = hue / 60.0;
+        int i = (int)h;
+        float f = h - (float)i;
+        float p = v * (1 - s);
+        float q = v * (1 - s * f);
+        float t = v * (1 - s * (1 - f));
+
+        float red = 0, green = 0, blue = 0;
+        switch (i) {
+        case 0:
+            red = v, green = t, blue = p;
+            break;
+        case 1:
+            red = q, green = v, blue = p;
+            break;
+        case 2:
+            red = p, green = v, blue = t;
+            break;
+        case 3:
+            red = p, green = q, blue = v;
+            break;
+        case 4:
+            red = t, green = p, blue = v;
+            break;
+        case 5:
+        default:
+            red = v, green = p, blue = q;
+            break;
+        }
+        wheel[hue] = { (uint8_t)red, (uint8_t)green, (uint8_t)blue };
+    }
+    return wheel;
+}
+
+/*! \brief Natural logarithm for use in constant expressions (x > 0). */
+constexpr double constexpr_log(double x)
+{
+    // Scale into [0.5, 1] and use the atanh series: ln(x) = 2 * atanh((x - 1) / (x + 1))
+    const double ln2 = 0.69314718055994530942;
+    int exponent = 0;
+    while (x > 1.0) {
+        x /= 2.0;
+        exponent++;
+    }
+    while (x < 0.5) {
+        x *= 2.0;
+        exponent--;
+    }
+    double y = (x - 1.0) / (x + 1.0);
+    double y2 = y * y;
+    double term = y;
+    double sum = 0.0;
+    for (int n = 1; n < 200; n += 2) {
+        double next = sum + term / n;
+        if (next == sum) {
+            break;
+        }
+        sum = next;
+        term *= y2;
+    }
+    return 2.0 * sum + exponent * ln2;
+}
+
+/*! \brief e^x for use in constant expressions (x <= 0). */
+constexpr double constexpr_exp(double x)
+{
+    // Halve until small, use the Taylor series, then square back up
+    int halvings = 0;
+    while (x < -0.5) {
+        x /= 2.0;
+        halvings++;
+    }
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 40; ++n) {
+        term *= x / n;
+        double next = sum + term;
+        if (next == sum) {
+            break;
+        }
+        sum = next;
+    }
+    while (halvings-- > 0) {
+        sum *= sum;
+    }
+    return sum;
+}
+
+/*! \brief Build a gamma correction table with 8 fractional bits.
+ *
+ * Entry `i` is 255 * (i / 255)^gamma in 8.8 fixed point (0-65280). The extra fraction bits
+ * allow brightness scaling and temporal dithering without losing the darkest levels.
+ */
+constexpr std::array<uint16_t, 256> make_gamma_table(double gamma)
+{
+    std::array<uint16_t, 256> table {};
+    for (unsigned int i = 1; i < 256; ++i) {
+        double level = constexpr_exp(gamma * constexpr_log(i / 255.0));
+        table[i] = (uint16_t)(level * 255.0 * 256.0 + 0.5);
+    }
+    return table;
+}
+
+/*! \brief Build a linear (no gamma) table in the same 8.8 format as `make_gamma_table`. */
+constexpr std::array<uint16_t, 256> make_linear_table()
+{
+    std::array<uint16_t, 256> table {};
+    for (unsigned int i = 0; i < 256; ++i) {
+        table[i] = (uint16_t)(i << 8);
+    }
+    return table;
+}
+
+#endif // LED_COLOR_H
@@ -1,42 +1,260 @@
 #include "leds.h"
+#include <algorithm>
 #include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
 #include "WS2812.pio.h"
+#include "led_color.h"
 
+#define WS2812_FREQUENCY 800000  // Bit rate of the WS2812 data line
+#define WS2812_BITS_PER_LED 24   // Bits shifted out for each LED (one FIFO word)
+#define WS2812_RESET_US 280      // Idle time after which the LEDs latch the data they have received
+#define WS2812_LED_US (WS2812_BITS_PER_LED * 1000000 / WS2812_FREQUENCY) // Time to shift out one LED
+
+// LED strip that owns each DMA channel, so the shared interrupt handler can find it
+static LEDs *dma_owners[NUM_DMA_CHANNELS];
+static bool dma_irq_handler_installed = false;
+
+// Colour correction curves (8.8 fixed point), generated at compile time
+static constexpr std::array<uint16_t, 256> gamma_table = make_gamma_table(LED_GAMMA);
+static constexpr std::array<uint16_t, 256> linear_table = make_linear_table();
 
 // Constructor: Initializes the LEDs controller with the specified pin, number of LEDs, PIO instance, 
 // and state machine (SM). It sets up the PIO program and initializes all LEDs to "off".
-LEDs::LEDs(uint pin, uint num_leds, PIO pio, uint sm) : _pin(pin), _num_leds(num_leds), _pio(pio), _sm(sm) {
+// A DMA channel is claimed to feed the PIO, so that commit() does not have to wait for the data to be sent.
+LEDs::LEDs(uint pin, uint num_leds, PIO pio, uint sm) : _pin(pin), _num_leds(num_leds), _pio(pio), _sm(sm),
+    _dma_channel(-1), _busy(false), _queued(false), _has_sent(false), _settings_changed(false), _brightness(255),
+    _gamma_enabled(false), _dither_enabled(false), _frames_sent(0), _frames_skipped(0),
+    _latch_callback(nullptr), _latch_context(nullptr) {
     _led_data.resize(num_leds, 0); // Initialize all LEDs to off
+    _committed_data.resize(num_leds, 0);
+    _dither_error.resize(3 * num_leds, 0);
+    _updateChannelLut();
+    _tx_data.resize(num_leds, 0);
+    _queued_data.resize(num_leds, 0);
     uint offset = pio_add_program(pio, &ws2812_program);  // ws2812_program should be compatible
-    ws2812_program_init(pio, sm, offset, pin, 800000, false);
+    ws2812_program_init(pio, sm, offset, pin, WS2812_FREQUENCY, false);
+
+    // If no DMA channel is free, fall back to sending with the CPU
+    _dma_channel = dma_claim_unused_channel(false);
+    if (_dma_channel < 0) {
+        return;
+    }
+
+    dma_channel_config config = dma_channel_get_default_config(_dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, true);                // Walk through the frame
+    channel_config_set_write_increment(&config, false);              // Always write the TX FIFO
+    channel_config_set_dreq(&config, pio_get_dreq(pio, sm, true));   // Paced by the state machine
+    dma_channel_configure(_dma_channel, &config, &pio->txf[sm], _tx_data.data(), num_leds, false);
+
+    dma_owners[_dma_channel] = this;
+    dma_channel_set_irq0_enabled(_dma_channel, true);
+    if (!dma_irq_handler_installed) {
+        // Shared so that other drivers can also use DMA_IRQ_0
+        irq_add_shared_handler(DMA_IRQ_0, _dmaIrqHandler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0, true);
+        dma_irq_handler_installed = true;
+    }
+}
+
+// Destructor: lets the last frame finish (the DMA reads from our buffers) and releases the DMA channel
+LEDs::~LEDs() {
+    waitForLatch();
+    if (_dma_channel >= 0) {
+        dma_channel_set_irq0_enabled(_dma_channel, false);
+        dma_owners[_dma_channel] = nullptr;
+        dma_channel_unclaim(_dma_channel);
+    }
 }
 
 // setColor(): Allows the user to set the color of an individual LED by its index. 
-// Colors are stored as 32-bit values (with 8 bits unused) in _led_data.
+// Colors are stored as 32-bit values (with 8 bits unused) in _led_data. Brightness and gamma are applied 
+// later, when the frame is committed.
 void LEDs::setColor(uint led_index, uint8_t red, uint8_t green, uint8_t blue) {
     if (led_index < _num_leds) {
         _led_data[led_index] = (red << 24) | (green << 16) | (blue << 8);
     }
 }
 
-// update(): Sends the current color data for all LEDs to the hardware. This method abstracts the complexity 
-// of interacting with the PIO, making it easier for the user to just deal with LED colors.
-void LEDs::update() {
-    for (uint32_t color : _led_data) {
-        pio_sm_put_blocking(_pio, _sm, color);
+// getColor(): Reads back the colour drawn for an LED, or black if the index is out of range.
+uint32_t LEDs::getColor(uint led_index) const {
+    return led_index < _num_leds ? _led_data[led_index] >> 8 : 0;
+}
+
+// commit(): Starts sending the frame drawn with setColor()/clear() to the hardware and returns immediately. 
+// If the frame is identical to the last one committed, nothing is sent at all, unless dithering is on (the 
+// LEDs only show the in-between levels while new dither patterns keep arriving). The frame is copied, so 
+// setColor() can be used straight away to draw the next one. If the previous frame is still being sent, 
+// this frame is queued and sent as soon as the previous one has latched (a newer commit() replaces a 
+// queued frame).
+bool LEDs::commit(bool force) {
+    uint32_t irq_status = save_and_disable_interrupts();
+
+    if (_has_sent && !force && !_settings_changed && !_dither_enabled && _committed_data == _led_data) {
+        _frames_skipped++;
+        restore_interrupts(irq_status);
+        return false;
+    }
+    _has_sent = true;
+    _settings_changed = false;
+    std::copy(_led_data.begin(), _led_data.end(), _committed_data.begin());
+
+    if (_dma_channel < 0) {
+        restore_interrupts(irq_status);
+        _sendData();
+        return true;
     }
+
+    _packFrame(_queued_data);
+    _queued = true;
+    if (!_busy) {
+        _startTransfer();
+    }
+    restore_interrupts(irq_status);
+    return true;
 }
 
-// clear(): Sets all LEDs to off by filling the _led_data array with zeros and optionally updates the LEDs immediately
+// clear(): Sets all LEDs to off by filling the _led_data array with zeros. Nothing is sent until commit().
 void LEDs::clear() {
     std::fill(_led_data.begin(), _led_data.end(), 0);
-    update(); // Optionally update immediately
 }
 
-// _sendData(): A private method that is responsible for the actual sending of data to the LEDs. 
-// It's used by update() to send the current state of all LEDs to the hardware.
+// setBrightness(): Scales every channel of every LED. Takes effect on the next commit().
+void LEDs::setBrightness(uint8_t brightness) {
+    _brightness = brightness;
+    _updateChannelLut();
+}
+
+// setGammaCorrection(): Maps colour values through a gamma curve so that equal steps look equally bright. 
+// Off by default, in which case colours are sent as drawn (apart from brightness).
+void LEDs::setGammaCorrection(bool enabled) {
+    _gamma_enabled = enabled;
+    _updateChannelLut();
+}
+
+// setDithering(): Carries the fraction of each channel that brightness and gamma would otherwise round away 
+// into the next frame, so that dim colours keep their intermediate levels on average. Every commit() is then 
+// sent, even when the frame has not changed, so keep committing at a steady rate.
+void LEDs::setDithering(bool enabled) {
+    _dither_enabled = enabled;
+    std::fill(_dither_error.begin(), _dither_error.end(), 0);
+    _settings_changed = true;
+}
+
+// isBusy(): True until every committed frame has been sent and latched.
+bool LEDs::isBusy() const {
+    return _busy || _queued;
+}
+
+// waitForLatch(): Blocks until the LEDs are showing the last committed frame, i.e. the data has been sent and 
+// the line has been idle for the reset time. Use this before anything that must not overlap the 
+// LED output.
+void LEDs::waitForLatch() {
+    while (isBusy()) {
+        tight_loop_contents();
+    }
+}
+
+// setLatchCallback(): The callback runs in interrupt context each time a frame has been latched, so it 
+// should be short (e.g. set a flag or start preparing the next frame).
+void LEDs::setLatchCallback(LatchCallback callback, void *context) {
+    uint32_t irq_status = save_and_disable_interrupts();
+    _latch_callback = callback;
+    _latch_context = context;
+    restore_interrupts(irq_status);
+}
+
+// _sendData(): A private method that sends the current state of all LEDs with the CPU. It's used by 
+// commit() when no DMA channel is available.
 void LEDs::_sendData() {
-    for (uint32_t color : _led_data) {
+    _packFrame(_tx_data);
+    for (uint32_t color : _tx_data) {
         pio_sm_put_blocking(_pio, _sm, color);
     }
+    _frames_sent = _frames_sent + 1;
+    sleep_us(WS2812_LED_US + WS2812_RESET_US); // Let the last LED shift out and latch
+}
+
+// _updateChannelLut(): Combines the gamma curve and brightness into one table for the packing loop
+void LEDs::_updateChannelLut() {
+    const std::array<uint16_t, 256> &curve = _gamma_enabled ? gamma_table : linear_table;
+    uint32_t scale = (uint32_t)_brightness + 1; // 256 = full brightness
+    for (uint i = 0; i < 256; ++i) {
+        _channel_lut[i] = (uint16_t)((curve[i] * scale) >> 8);
+    }
+    _settings_changed = true;
+}
+
+// _packFrame(): Applies the colour stage to the back buffer and packs it into the wire format
+void LEDs::_packFrame(std::vector<uint32_t> &out) {
+    for (uint led = 0; led < _num_leds; ++led) {
+        uint32_t color = _led_data[led];
+        uint32_t packed = 0;
+        for (uint channel = 0; channel < 3; ++channel) {
+            uint shift = 24 - 8 * channel;  // Red, green, blue
+            uint32_t level = _channel_lut[(color >> shift) & 0xFF];
+            if (_dither_enabled) {
+                // Add the fraction left over from the previous frame and keep the new remainder
+                uint8_t &error = _dither_error[3 * led + channel];
+                level += error;
+                error = level & 0xFF;
+                level >>= 8;
+            } else {
+                level = (level + 0x80) >> 8;
+                level = level > 255 ? 255 : level;
+            }
+            packed |= level << shift;
+        }
+        out[led] = packed;
+    }
+}
+
+// _startTransfer(): Makes the queued frame the one being sent and starts the DMA. Called with interrupts 
+// disabled or from interrupt context.
+void LEDs::_startTransfer() {
+    std::swap(_tx_data, _queued_data);
+    _queued = false;
+    _busy = true;
+    _frames_sent = _frames_sent + 1;
+    dma_channel_set_read_addr(_dma_channel, _tx_data.data(), false);
+    dma_channel_set_trans_count(_dma_channel, _num_leds, true);
+}
+
+// _onTransferComplete(): The DMA has written the last word to the FIFO. The LEDs latch once the FIFO has 
+// drained, the last word has been shifted out and the line has then been idle for the reset time.
+void LEDs::_onTransferComplete() {
+    uint words_left = pio_sm_get_tx_fifo_level(_pio, _sm) + 1;
+    if (add_alarm_in_us(words_left * WS2812_LED_US + WS2812_RESET_US, _latchAlarmCallback, this, true) < 0) {
+        // No alarm slots left: treat the frame as latched rather than stalling the strip
+        _onLatched();
+    }
+}
+
+// _onLatched(): The frame is now showing. Start the queued frame, if there is one.
+void LEDs::_onLatched() {
+    _busy = false;
+    if (_latch_callback != nullptr) {
+        _latch_callback(_latch_context);
+    }
+    if (_queued) {
+        _startTransfer();
+    }
+}
+
+// _dmaIrqHandler(): Shared DMA_IRQ_0 handler for every LED strip
+void LEDs::_dmaIrqHandler() {
+    for (uint channel = 0; channel < NUM_DMA_CHANNELS; ++channel) {
+        if (dma_owners[channel] != nullptr && dma_channel_get_irq0_status(channel)) {
+            dma_channel_acknowledge_irq0(channel);
+            dma_owners[channel]->_onTransferComplete();
+        }
+    }
+}
+
+// _latchAlarmCallback(): Timer alarm for the end of the reset gap
+int64_t LEDs::_latchAlarmCallback(alarm_id_t id, void *user_data) {
+    static_cast<LEDs *>(user_data)->_onLatched();
+    return 0;
 }
@@ -2,22 +2,75 @@
 #define LEDS_H
 
 #include "pico/stdlib.h"
+#include "pico/time.h"
 #include "hardware/pio.h"
 #include <vector>
 
 class LEDs {
 public:
+    // Called (from interrupt context) once a frame has been latched by the LEDs
+    typedef void (*LatchCallback)(void *context);
+
     LEDs(uint pin, uint num_leds, PIO pio, uint sm);
+    ~LEDs();
     void setColor(uint led_index, uint8_t red, uint8_t green, uint8_t blue);
-    void update();
+    // The colour drawn for an LED with setColor()/clear(), as 0xRRGGBB (before brightness and gamma)
+    uint32_t getColor(uint led_index) const;
     void clear();
+    // Send the frame drawn with setColor()/clear() to the LEDs, unless it is identical to the last one sent
+    // (or `force` is set). While dithering is on every frame is sent, as the dither pattern moves on each time.
+    // Returns false if the frame was skipped.
+    bool commit(bool force = false);
+
+    // Colour stage, applied when a frame is committed: global brightness (255 = full), gamma correction 
+    // (off by default, so colours go out as drawn) and temporal dithering of the fraction lost when brightness 
+    // and gamma are applied (off by default)
+    void setBrightness(uint8_t brightness);
+    void setGammaCorrection(bool enabled);
+    void setDithering(bool enabled);
+
+    // Frames actually sent to the strip, and commits skipped because nothing had changed
+    uint32_t framesSent() const { return _frames_sent; }
+    uint32_t framesSkipped() const { return _frames_skipped; }
+
+    // True while a frame is being sent, is waiting for the reset gap, or is queued behind another
+    bool isBusy() const;
+    // Block until every committed frame has been latched (i.e. the reset gap has elapsed)
+    void waitForLatch();
+    // Register a function to be called each time a frame has been latched (nullptr to remove)
+    void setLatchCallback(LatchCallback callback, void *context);
+
 private:
     uint _pin;
     PIO _pio;
     uint _sm;
     uint _num_leds;
-    std::vector<uint32_t> _led_data;
+    std::vector<uint32_t> _led_data;     // Back buffer: the frame being drawn with setColor()
+    std::vector<uint32_t> _committed_data; // The last frame committed, before the colour stage
+    std::vector<uint32_t> _tx_data;      // Front buffer: the frame being (or last) sent
+    std::vector<uint32_t> _queued_data;  // Frame passed to commit() while another was still being sent
+    int _dma_channel;                    // DMA channel feeding the PIO TX FIFO, or -1 to send with the CPU
+    volatile bool _busy;                 // A frame is being sent or waiting for its reset gap
+    volatile bool _queued;               // _queued_data is waiting to be sent
+    bool _has_sent;                      // False until the first frame, whose contents are unknown to the strip
+    bool _settings_changed;              // Brightness/gamma changed, so the next commit must be sent
+    uint8_t _brightness;
+    bool _gamma_enabled;
+    bool _dither_enabled;
+    uint16_t _channel_lut[256];          // Gamma and brightness for one colour channel, in 8.8 fixed point
+    std::vector<uint8_t> _dither_error;  // Fraction carried to the next frame, 3 channels per LED
+    volatile uint32_t _frames_sent;
+    uint32_t _frames_skipped;
+    LatchCallback _latch_callback;
+    void *_latch_context;
     void _sendData();
+    void _updateChannelLut();
+    void _packFrame(std::vector<uint32_t> &out);
+    void _startTransfer();
+    void _onTransferComplete();
+    void _onLatched();
+    static void _dmaIrqHandler();
+    static int64_t _latchAlarmCallback(alarm_id_t id, void *user_data);
 };
 
 #endif // LEDS_H
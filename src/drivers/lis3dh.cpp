@@ -1,24 +1,29 @@
 #include "lis3dh.h"
-#include <stdio.h>  // Required for printf
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "drivers/logging/logging.h"  // Debug messages are logged at the verbose level (see LOG_LEVEL)
+#include <stdio.h>
+#include <string.h>
 
-// Define the debug message flag
-#define DEBUG_MESSAGES 0  // Set to 1 to enable debug messages, 0 to disable
-
-// Robust DEBUG_PRINT macro definition using a do-while loop for better handling
-#if DEBUG_MESSAGES
-    #define DEBUG_PRINT(fmt, ...) do { printf(fmt, ##__VA_ARGS__); } while (0)
-#else
-    #define DEBUG_PRINT(fmt, ...) do { } while (0)  // No-operation macro
-#endif
+// Sensors with an asynchronous read in flight, by DMA channel and by I2C controller (for the interrupt handlers)
+static LIS3DH* dma_owners[NUM_DMA_CHANNELS];
+static LIS3DH* i2c_owners[2];
+static bool dma_irq_handler_installed = false;
 
 // Constructor
 LIS3DH::LIS3DH(i2c_inst_t* i2c_instance, uint8_t i2c_address, uint8_t sda_pin, uint8_t scl_pin)
-    : i2c_instance(i2c_instance), i2c_address(i2c_address), sda_pin(sda_pin), scl_pin(scl_pin) {}
+    : i2c_instance(i2c_instance), i2c_address(i2c_address), sda_pin(sda_pin), scl_pin(scl_pin),
+      fifo_overrun_count(0), sample_shift(6), sensitivity(4), dma_tx_channel(-1), dma_rx_channel(-1), async_stage(ASYNC_IDLE),
+      async_callback(nullptr), async_context(nullptr), fifo_status(0), fifo_result(0), fifo_ready(false) {}
 
 // Function to initialize the accelerometer
-bool LIS3DH::init() {
+bool LIS3DH::init(uint32_t baudrate, const LIS3DHConfig& config) {
     // (a) Initialize the I2C interface
-    i2c_init(i2c_instance, 400000);  // 400 kHz baud rate
+    if (baudrate > LIS3DH_MAX_BAUDRATE) {
+        baudrate = LIS3DH_MAX_BAUDRATE;
+    }
+    i2c_init(i2c_instance, baudrate);
 
     // (b) Set GPIO pins for SDA and SCL
     gpio_set_function(sda_pin, GPIO_FUNC_I2C);
@@ -27,42 +32,125 @@ bool LIS3DH::init() {
     // (c) Read the WHO_AM_I register to check communication
     uint8_t who_am_i;
     if (!read_register(0x0F, &who_am_i, 1)) {
-        DEBUG_PRINT("Failed to read WHO_AM_I register\n");
+        LOG_VERBOSE("Failed to read WHO_AM_I register");
         return false;
     }
 
     if (who_am_i != 0x33) {
-        DEBUG_PRINT("WHO_AM_I register mismatch: expected 0x33, got 0x%02X\n", who_am_i);
+        LOG_VERBOSE("WHO_AM_I register mismatch: expected 0x33, got 0x%02X", who_am_i);
+        return false;
+    }
+
+    LOG_VERBOSE("WHO_AM_I register verified: 0x33");
+
+    // (d) Configure the data rate, range and resolution
+    if (!configure(config)) {
+        LOG_VERBOSE("Failed to configure accelerometer");
+        return false;
+    }
+
+    // (e) Claim DMA channels for asynchronous reads. Without them, only the blocking functions are available.
+    if (dma_tx_channel < 0) {
+        dma_tx_channel = dma_claim_unused_channel(false);
+        dma_rx_channel = dma_claim_unused_channel(false);
+        if (dma_tx_channel < 0 || dma_rx_channel < 0) {
+            LOG_VERBOSE("No DMA channels free, asynchronous reads disabled");
+            if (dma_tx_channel >= 0) {
+                dma_channel_unclaim(dma_tx_channel);
+            }
+            if (dma_rx_channel >= 0) {
+                dma_channel_unclaim(dma_rx_channel);
+            }
+            dma_tx_channel = -1;
+            dma_rx_channel = -1;
+        } else {
+            dma_owners[dma_rx_channel] = this;
+            dma_channel_set_irq0_enabled(dma_rx_channel, true);
+            if (!dma_irq_handler_installed) {
+                // Shared with the LEDs driver, which also completes its transfers on DMA_IRQ_0
+                irq_add_shared_handler(DMA_IRQ_0, dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+                irq_set_enabled(DMA_IRQ_0, true);
+                dma_irq_handler_installed = true;
+            }
+            unsigned int index = i2c_hw_index(i2c_instance);
+            i2c_owners[index] = this;
+            irq_set_exclusive_handler(I2C0_IRQ + index, i2c_irq_handler);
+            irq_set_enabled(I2C0_IRQ + index, true);
+        }
+    }
+
+    return true;
+}
+
+// Function to set the data rate, range and mode
+bool LIS3DH::configure(const LIS3DHConfig& config) {
+    // CTRL_REG1 ODR field for each data rate (1.344 kHz and 5.376 kHz share a code, told apart by LPen)
+    static const uint8_t odr_bits[] = { 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9, 0x9 };
+
+    // Milli-g per digit, by mode and range (datasheet table 4), and the shift that right-justifies each mode
+    static const uint8_t sensitivities[3][4] = {
+        { 16, 32, 64, 192 },  // Low power, 8-bit
+        { 4, 8, 16, 48 },     // Normal, 10-bit
+        { 1, 2, 4, 12 }       // High resolution, 12-bit
+    };
+    static const uint8_t shifts[3] = { 8, 6, 4 };
+
+    bool low_power = config.mode == LIS3DH_MODE_LOW_POWER;
+    if ((config.data_rate == LIS3DH_ODR_1600HZ || config.data_rate == LIS3DH_ODR_5376HZ) && !low_power) {
+        LOG_VERBOSE("Data rate only available in low-power mode");
+        return false;
+    }
+    if (config.data_rate == LIS3DH_ODR_1344HZ && low_power) {
+        LOG_VERBOSE("Data rate not available in low-power mode");
         return false;
     }
 
-    DEBUG_PRINT("WHO_AM_I register verified: 0x33\n");
+    // Keep the current CTRL_REG1, so that it can be put back if CTRL_REG4 cannot be written
+    uint8_t previous_ctrl_reg1;
+    if (!read_register(0x20, &previous_ctrl_reg1, 1)) {
+        LOG_VERBOSE("Failed to read data rate");
+        return false;
+    }
 
-    // (d) Configure accelerometer settings (example: set range and sample rate)
-    if (!write_register(0x20, 0x57)) {  // Example: Set CTRL_REG1 for 100 Hz, normal mode
-        DEBUG_PRINT("Failed to configure accelerometer\n");
+    // CTRL_REG1: ODR, LPen, all axes enabled
+    uint8_t ctrl_reg1 = (odr_bits[config.data_rate] << 4) | (low_power ? 0x08 : 0x00) | 0x07;
+    if (!write_register(0x20, ctrl_reg1)) {
+        LOG_VERBOSE("Failed to set data rate");
         return false;
     }
 
-    // Set measurement range to ±2g (CTRL_REG4)
-    if (!write_register(0x23, 0x00)) {  // Set range to ±2g
-        DEBUG_PRINT("Failed to configure accelerometer range\n");
+    // CTRL_REG4: FS, HR
+    uint8_t ctrl_reg4 = (config.range << 4) | (config.mode == LIS3DH_MODE_HIGH_RESOLUTION ? 0x08 : 0x00);
+    if (!write_register(0x23, ctrl_reg4)) {
+        LOG_VERBOSE("Failed to set range and resolution");
+        if (!write_register(0x20, previous_ctrl_reg1)) {
+            LOG_VERBOSE("Failed to restore data rate");
+        }
         return false;
     }
 
+    current_config = config;
+    sample_shift = shifts[config.mode];
+    sensitivity = sensitivities[config.mode][config.range];
     return true;
 }
 
+// Function to look up the configured data rate in Hz
+uint32_t LIS3DH::data_rate_hz() const {
+    static const uint16_t rates[] = { 0, 1, 10, 25, 50, 100, 200, 400, 1600, 1344, 5376 };
+    return rates[current_config.data_rate];
+}
+
 // Helper function to read from a register
 bool LIS3DH::read_register(uint8_t reg, uint8_t* data, uint8_t length) {
     if (i2c_write_blocking(i2c_instance, i2c_address, &reg, 1, true) != 1) {
-        DEBUG_PRINT("Failed to select register address\n");
+        LOG_VERBOSE("Failed to select register address");
         return false;
     }
 
     int bytes_read = i2c_read_blocking(i2c_instance, i2c_address, data, length, false);
     if (bytes_read != length) {
-        DEBUG_PRINT("Failed to read data\n");
+        LOG_VERBOSE("Failed to read data");
         return false;
     }
 
@@ -73,7 +161,7 @@ bool LIS3DH::read_register(uint8_t reg, uint8_t* data, uint8_t length) {
 bool LIS3DH::write_register(uint8_t reg, uint8_t data) {
     uint8_t buffer[2] = { reg, data };
     if (i2c_write_blocking(i2c_instance, i2c_address, buffer, 2, false) != 2) {
-        DEBUG_PRINT("Failed to write data\n");
+        LOG_VERBOSE("Failed to write data");
         return false;
     }
 
@@ -86,14 +174,15 @@ bool LIS3DH::read_acceleration(int16_t* x, int16_t* y, int16_t* z) {
     
     // Perform a multi-byte read starting from the OUT_X_L register (0x28)
     if (!read_register(0x28 | 0x80, raw_data, 6)) {  // OR with 0x80 to enable auto-increment for multi-byte read
-        DEBUG_PRINT("Failed to read acceleration data\n");
+        LOG_VERBOSE("Failed to read acceleration data");
         return false;
     }
 
     // Combine the raw data into 16-bit signed integers (convert two 8-bit values into a 16-bit value)
-    *x = (int16_t)(raw_data[0] | (raw_data[1] << 8)) >> 4;  // Right shift by 4 as discussed
-    *y = (int16_t)(raw_data[2] | (raw_data[3] << 8)) >> 4;  // Right shift by 4
-    *z = (int16_t)(raw_data[4] | (raw_data[5] << 8)) >> 4;  // Right shift by 4
+    // The data is left-justified, so shift it down by however many bits the current mode leaves unused
+    *x = (int16_t)(raw_data[0] | (raw_data[1] << 8)) >> sample_shift;
+    *y = (int16_t)(raw_data[2] | (raw_data[3] << 8)) >> sample_shift;
+    *z = (int16_t)(raw_data[4] | (raw_data[5] << 8)) >> sample_shift;
 
     return true;
 }
@@ -103,20 +192,295 @@ bool LIS3DH::read_acceleration_g(float* x_g, float* y_g, float* z_g) {
     int16_t x_raw, y_raw, z_raw;
 
     // Read raw acceleration data
-    DEBUG_PRINT("Reading raw acceleration data...\n");
+    LOG_VERBOSE("Reading raw acceleration data...");
     if (!read_acceleration(&x_raw, &y_raw, &z_raw)) {
-        DEBUG_PRINT("Failed to read raw acceleration data\n");
+        LOG_VERBOSE("Failed to read raw acceleration data");
         return false;
     }
-    DEBUG_PRINT("Raw data read successfully: X_raw = %d, Y_raw = %d, Z_raw = %d\n", x_raw, y_raw, z_raw);
+    LOG_VERBOSE("Raw data read successfully: X_raw = %d, Y_raw = %d, Z_raw = %d", x_raw, y_raw, z_raw);
 
-    // Sensitivity for ±2g range (default): 1 mg/digit or 0.001 g/digit
-    const float sensitivity = 0.001; // 0.001 g/LSB (for ±2g range)
+    // Convert raw values to g by multiplying with the sensitivity of the current mode and range
+    const float g_per_digit = sensitivity * 0.001f;
+    *x_g = x_raw * g_per_digit;
+    *y_g = y_raw * g_per_digit;
+    *z_g = z_raw * g_per_digit;
 
-    // Convert raw values to g by multiplying with sensitivity
-    *x_g = x_raw * sensitivity;
-    *y_g = y_raw * sensitivity;
-    *z_g = z_raw * sensitivity;
+    return true;
+}
 
+// Function to read acceleration data for X, Y, and Z axes in milli-g
+bool LIS3DH::read_acceleration_mg(int16_t* x_mg, int16_t* y_mg, int16_t* z_mg) {
+    LIS3DHSample sample;
+    if (!read_acceleration(&sample.x, &sample.y, &sample.z)) {
+        LOG_VERBOSE("Failed to read raw acceleration data");
+        return false;
+    }
+
+    LIS3DHAcceleration acceleration;
+    convert_to_mg(&sample, &acceleration, 1);
+    *x_mg = acceleration.x_mg;
+    *y_mg = acceleration.y_mg;
+    *z_mg = acceleration.z_mg;
     return true;
 }
+
+// Function to convert raw samples to milli-g
+void LIS3DH::convert_to_mg(const LIS3DHSample* samples, LIS3DHAcceleration* accelerations, int count) const {
+    // One integer multiply per axis: the sensitivity is a whole number of milli-g per digit in every mode
+    const int16_t mg_per_digit = sensitivity;
+    for (int i = 0; i < count; ++i) {
+        accelerations[i].x_mg = (int16_t)(samples[i].x * mg_per_digit);
+        accelerations[i].y_mg = (int16_t)(samples[i].y * mg_per_digit);
+        accelerations[i].z_mg = (int16_t)(samples[i].z * mg_per_digit);
+    }
+}
+
+// Function to enable the FIFO in stream mode with a watermark
+bool LIS3DH::enable_fifo_stream(uint8_t watermark) {
+    if (watermark >= LIS3DH_FIFO_DEPTH) {
+        watermark = LIS3DH_FIFO_DEPTH - 1;
+    }
+
+    // Go through bypass mode first, which empties the FIFO and clears any overrun
+    if (!write_register(0x2E, 0x00)) {  // FIFO_CTRL_REG: bypass mode
+        LOG_VERBOSE("Failed to reset FIFO");
+        return false;
+    }
+
+    if (!write_register(0x24, 0x40)) {  // CTRL_REG5: FIFO_EN
+        LOG_VERBOSE("Failed to enable FIFO");
+        return false;
+    }
+
+    if (!write_register(0x2E, 0x80 | watermark)) {  // FIFO_CTRL_REG: stream mode, FTH = watermark
+        LOG_VERBOSE("Failed to set FIFO mode");
+        return false;
+    }
+
+    if (!write_register(0x22, 0x04)) {  // CTRL_REG3: I1_WTM, watermark interrupt on INT1
+        LOG_VERBOSE("Failed to route FIFO watermark interrupt");
+        return false;
+    }
+
+    return true;
+}
+
+// Function to return the FIFO to bypass mode
+bool LIS3DH::disable_fifo() {
+    if (!write_register(0x2E, 0x00) || !write_register(0x24, 0x00) || !write_register(0x22, 0x00)) {
+        LOG_VERBOSE("Failed to disable FIFO");
+        return false;
+    }
+
+    return true;
+}
+
+// Helper function to work out how many samples FIFO_SRC_REG says are waiting
+int LIS3DH::fifo_count_from_status(uint8_t status) {
+    // FIFO_SRC_REG: WTM (bit 7), OVRN_FIFO (bit 6), EMPTY (bit 5), FSS unread sample count (bits 4-0)
+    if (status & 0x20) {
+        return 0;
+    }
+    if (status & 0x40) {
+        // A full FIFO has overwritten its oldest sample; FSS cannot count all 32 levels
+        fifo_overrun_count++;
+        return LIS3DH_FIFO_DEPTH;
+    }
+    return status & 0x1F;
+}
+
+// Helper function to convert burst-read output registers into samples
+void LIS3DH::unpack_samples(const uint8_t* raw_data, LIS3DHSample* samples, int count) {
+    for (int i = 0; i < count; ++i) {
+        const uint8_t* sample = &raw_data[i * 6];
+        samples[i].x = (int16_t)(sample[0] | (sample[1] << 8)) >> sample_shift;  // As in read_acceleration
+        samples[i].y = (int16_t)(sample[2] | (sample[3] << 8)) >> sample_shift;
+        samples[i].z = (int16_t)(sample[4] | (sample[5] << 8)) >> sample_shift;
+    }
+}
+
+// Function to drain the FIFO with a single burst read
+int LIS3DH::read_fifo(LIS3DHSample* samples, int max_samples) {
+    uint8_t fifo_src;
+    if (!read_register(0x2F, &fifo_src, 1)) {
+        LOG_VERBOSE("Failed to read FIFO status");
+        return -1;
+    }
+
+    int count = fifo_count_from_status(fifo_src);
+    if (count > max_samples) {
+        count = max_samples;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    // With the FIFO enabled the register address wraps from OUT_Z_H back to OUT_X_L, and every pass through the
+    // output registers pops one sample, so the whole batch comes out of a single auto-increment read
+    uint8_t raw_data[LIS3DH_FIFO_DEPTH * 6];
+    if (!read_register(0x28 | 0x80, raw_data, (uint8_t)(count * 6))) {
+        LOG_VERBOSE("Failed to read FIFO data");
+        return -1;
+    }
+
+    unpack_samples(raw_data, samples, count);
+    return count;
+}
+
+// Helper function to run a register read by DMA. The TX channel feeds the I2C controller the register address
+// followed by one read command per byte (a repeated start before the first, a stop after the last), and the RX
+// channel collects the bytes as they arrive. Completion is signalled by the RX channel's interrupt, and a NAK by
+// the controller's TX_ABRT interrupt.
+void LIS3DH::start_transfer(uint8_t reg, uint8_t* data, uint8_t length) {
+    async_commands[0] = reg;
+    for (uint8_t i = 0; i < length; ++i) {
+        uint16_t command = I2C_IC_DATA_CMD_CMD_BITS;
+        if (i == 0) {
+            command |= I2C_IC_DATA_CMD_RESTART_BITS;
+        }
+        if (i == length - 1) {
+            command |= I2C_IC_DATA_CMD_STOP_BITS;
+        }
+        async_commands[1 + i] = command;
+    }
+
+    // TAR can only be changed while the controller is disabled, and disabling it while the previous transfer's STOP
+    // is still on the bus would cut that transfer short. FIFO reads start their second transfer from the interrupt
+    // for the first, so leave the controller alone when it is already addressing this device; otherwise wait for
+    // the bus to go idle and for the controller to report that it is disabled.
+    i2c_hw_t* hw = i2c_get_hw(i2c_instance);
+    if (!(hw->enable & I2C_IC_ENABLE_ENABLE_BITS) || hw->tar != i2c_address) {
+        while (hw->status & I2C_IC_STATUS_MST_ACTIVITY_BITS) {
+            tight_loop_contents();
+        }
+        hw->enable = 0;
+        while (hw->enable_status & I2C_IC_ENABLE_STATUS_IC_EN_BITS) {
+            tight_loop_contents();
+        }
+        hw->tar = i2c_address;
+        hw->enable = I2C_IC_ENABLE_ENABLE_BITS;
+    }
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+    hw->intr_mask = I2C_IC_INTR_MASK_M_TX_ABRT_BITS;  // Only while the transfer runs, so blocking calls see aborts
+
+    dma_channel_config rx_config = dma_channel_get_default_config(dma_rx_channel);
+    channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
+    channel_config_set_read_increment(&rx_config, false);  // Always read the RX FIFO
+    channel_config_set_write_increment(&rx_config, true);
+    channel_config_set_dreq(&rx_config, i2c_get_dreq(i2c_instance, false));
+    dma_channel_configure(dma_rx_channel, &rx_config, data, &hw->data_cmd, length, true);
+
+    dma_channel_config tx_config = dma_channel_get_default_config(dma_tx_channel);
+    channel_config_set_transfer_data_size(&tx_config, DMA_SIZE_16);
+    channel_config_set_read_increment(&tx_config, true);
+    channel_config_set_write_increment(&tx_config, false);  // Always write the TX FIFO
+    channel_config_set_dreq(&tx_config, i2c_get_dreq(i2c_instance, true));
+    dma_channel_configure(dma_tx_channel, &tx_config, &hw->data_cmd, async_commands, 1 + length, true);
+}
+
+// Function to start an asynchronous register read
+bool LIS3DH::read_register_async(uint8_t reg, uint8_t* data, uint8_t length, AsyncCallback callback, void* context) {
+    if (dma_tx_channel < 0 || async_stage != ASYNC_IDLE || length == 0 || length > LIS3DH_FIFO_DEPTH * 6) {
+        return false;
+    }
+
+    async_callback = callback;
+    async_context = context;
+    async_stage = ASYNC_READ;
+    start_transfer(reg, data, length);
+    return true;
+}
+
+// Function to start draining the FIFO in the background
+bool LIS3DH::start_fifo_read() {
+    if (dma_tx_channel < 0 || async_stage != ASYNC_IDLE) {
+        return false;
+    }
+
+    fifo_ready = false;
+    async_stage = ASYNC_FIFO_STATUS;
+    start_transfer(0x2F, &fifo_status, 1);
+    return true;
+}
+
+// Function to collect the samples from the last start_fifo_read()
+int LIS3DH::collect_fifo(LIS3DHSample* samples, int max_samples) {
+    if (!fifo_ready) {
+        return 0;
+    }
+    fifo_ready = false;
+
+    int count = fifo_result;
+    if (count > max_samples) {
+        count = max_samples;  // The rest of this batch has already left the sensor's FIFO
+    }
+    if (count > 0) {
+        unpack_samples(fifo_data, samples, count);
+    }
+    return count;
+}
+
+// Helper function to end the asynchronous read in flight (interrupt context)
+void LIS3DH::finish_async(bool ok) {
+    i2c_get_hw(i2c_instance)->intr_mask = 0;
+
+    AsyncStage stage = async_stage;
+    async_stage = ASYNC_IDLE;
+    if (stage == ASYNC_READ) {
+        if (async_callback != nullptr) {
+            async_callback(ok, async_context);
+        }
+    } else {
+        fifo_result = ok ? fifo_result : -1;
+        fifo_ready = true;
+    }
+}
+
+// Helper function called when the RX channel has received every byte (interrupt context)
+void LIS3DH::on_transfer_complete() {
+    if (async_stage == ASYNC_FIFO_STATUS) {
+        // Now read every waiting sample in one burst (see read_fifo)
+        int count = fifo_count_from_status(fifo_status);
+        fifo_result = count;
+        if (count > 0) {
+            async_stage = ASYNC_FIFO_DATA;
+            start_transfer(0x28 | 0x80, fifo_data, (uint8_t)(count * 6));
+            return;
+        }
+    }
+    finish_async(true);
+}
+
+// Helper function called when the device NAKed (interrupt context)
+void LIS3DH::on_transfer_abort() {
+    dma_channel_abort(dma_tx_channel);
+    dma_channel_abort(dma_rx_channel);
+    dma_channel_acknowledge_irq0(dma_rx_channel);
+    finish_async(false);
+}
+
+// Shared DMA_IRQ_0 handler: only acknowledge the channels that belong to a LIS3DH
+void LIS3DH::dma_irq_handler() {
+    for (int channel = 0; channel < NUM_DMA_CHANNELS; ++channel) {
+        if (dma_owners[channel] != nullptr && dma_channel_get_irq0_status(channel)) {
+            dma_channel_acknowledge_irq0(channel);
+            dma_owners[channel]->on_transfer_complete();
+        }
+    }
+}
+
+// I2C0_IRQ/I2C1_IRQ handler: a transfer was aborted, normally because the device did not acknowledge
+void LIS3DH::i2c_irq_handler() {
+    for (LIS3DH* owner : i2c_owners) {
+        if (owner == nullptr) {
+            continue;
+        }
+        i2c_hw_t* hw = i2c_get_hw(owner->i2c_instance);
+        if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+            (void)hw->clr_tx_abrt;  // Reading clears the abort and lets the controller accept commands again
+            if (owner->async_stage != ASYNC_IDLE) {
+                owner->on_transfer_abort();
+            }
+        }
+    }
+}
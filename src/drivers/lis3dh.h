@@ -5,12 +5,84 @@
 #include "hardware/gpio.h"
 #include <stdio.h>
 
+#define LIS3DH_FIFO_DEPTH 32    // Number of samples the sensor's FIFO holds
+#define LIS3DH_MAX_BAUDRATE 1000000  // Fastest I2C clock init() accepts (fast-mode plus)
+
+// Output data rates (CTRL_REG1 ODR). 1.6 kHz and 5.376 kHz are only available in low-power mode, and 1.344 kHz only
+// in normal and high-resolution modes.
+enum LIS3DHDataRate {
+    LIS3DH_ODR_POWER_DOWN,
+    LIS3DH_ODR_1HZ,
+    LIS3DH_ODR_10HZ,
+    LIS3DH_ODR_25HZ,
+    LIS3DH_ODR_50HZ,
+    LIS3DH_ODR_100HZ,
+    LIS3DH_ODR_200HZ,
+    LIS3DH_ODR_400HZ,
+    LIS3DH_ODR_1600HZ,
+    LIS3DH_ODR_1344HZ,
+    LIS3DH_ODR_5376HZ
+};
+
+// Full scale (CTRL_REG4 FS)
+enum LIS3DHRange {
+    LIS3DH_RANGE_2G,
+    LIS3DH_RANGE_4G,
+    LIS3DH_RANGE_8G,
+    LIS3DH_RANGE_16G
+};
+
+// Operating modes, which set the resolution of the samples (CTRL_REG1 LPen and CTRL_REG4 HR)
+enum LIS3DHMode {
+    LIS3DH_MODE_LOW_POWER,       // 8-bit samples
+    LIS3DH_MODE_NORMAL,          // 10-bit samples
+    LIS3DH_MODE_HIGH_RESOLUTION  // 12-bit samples
+};
+
+// Sensor configuration applied by LIS3DH::init() and LIS3DH::configure()
+struct LIS3DHConfig {
+    LIS3DHDataRate data_rate = LIS3DH_ODR_100HZ;
+    LIS3DHRange range = LIS3DH_RANGE_2G;
+    LIS3DHMode mode = LIS3DH_MODE_NORMAL;
+};
+
+// One raw acceleration sample (right-justified at the resolution of the selected mode, as returned by
+// read_acceleration; multiply by LIS3DH::sensitivity_mg() for milli-g)
+struct LIS3DHSample {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+};
+
+// One acceleration sample in milli-g
+struct LIS3DHAcceleration {
+    int16_t x_mg;
+    int16_t y_mg;
+    int16_t z_mg;
+};
+
 class LIS3DH {
 public:
+    // Called (from interrupt context) when an asynchronous read finishes, with `ok` false if the device NAKed
+    typedef void (*AsyncCallback)(bool ok, void* context);
+
     LIS3DH(i2c_inst_t* i2c_instance, uint8_t i2c_address, uint8_t sda_pin, uint8_t scl_pin);
     
-    // Initialization function
-    bool init();  
+    // Initialization function. The I2C clock is capped at LIS3DH_MAX_BAUDRATE; the LIS3DH itself is only rated
+    // for 400 kHz, so only go faster if the board's pull-ups and the sensor have been checked at that speed.
+    bool init(uint32_t baudrate = 400000, const LIS3DHConfig& config = LIS3DHConfig());
+
+    // Function to change the data rate, range and mode. Returns false (leaving the sensor as it was) if the data
+    // rate is not available in the requested mode, or on an I2C error. If the range cannot be set after the data
+    // rate has been, the old data rate is written back; only if that write fails too is the sensor left changed.
+    bool configure(const LIS3DHConfig& config);
+
+    // The configuration in use, and the size of one digit of a raw sample in milli-g
+    const LIS3DHConfig& config() const { return current_config; }
+    uint8_t sensitivity_mg() const { return sensitivity; }
+
+    // Samples per second at the configured data rate (0 when powered down)
+    uint32_t data_rate_hz() const;
     
     // Function to read data from a register
     bool read_register(uint8_t reg, uint8_t* data, uint8_t length);
@@ -24,11 +96,85 @@ public:
         // Function to read acceleration data for X, Y, and Z axes
     bool read_acceleration_g(float* x_g, float* y_g, float* z_g);
 
+    // Function to read acceleration data for X, Y, and Z axes in milli-g, using integer arithmetic only
+    bool read_acceleration_mg(int16_t* x_mg, int16_t* y_mg, int16_t* z_mg);
+
+    // Function to convert a batch of raw samples (from read_fifo or collect_fifo) to milli-g in one pass. The
+    // largest value any mode and range can produce is under 2^15 mg, so the results always fit.
+    void convert_to_mg(const LIS3DHSample* samples, LIS3DHAcceleration* accelerations, int count) const;
+
+    // Function to enable the 32-level FIFO in stream mode. The sensor keeps buffering samples at its output data
+    // rate (discarding the oldest once full), and the watermark flag is raised once more than `watermark` samples
+    // (0-31) are waiting. The watermark is also routed to the INT1 pin.
+    bool enable_fifo_stream(uint8_t watermark);
+
+    // Function to turn the FIFO off again (bypass mode), so read_acceleration() returns the latest sample
+    bool disable_fifo();
+
+    // Function to drain the FIFO in one burst read. Copies out up to `max_samples` samples, oldest first, and
+    // returns how many were read, or -1 on an I2C error. Samples left behind stay queued for the next call.
+    int read_fifo(LIS3DHSample* samples, int max_samples);
+
+    // Number of times read_fifo() found the FIFO full, in which case samples may have been lost
+    uint32_t fifo_overruns() const { return fifo_overrun_count; }
+
+    // Function to start a register read that runs in the background by DMA, so the CPU is free for the whole bus
+    // transaction. `callback` (which may be nullptr) is called when the data is in `data`. Only one read can be in
+    // flight at a time: returns false if one already is, or if no DMA channels were free at init(). The blocking
+    // functions must not be used until it has finished.
+    bool read_register_async(uint8_t reg, uint8_t* data, uint8_t length, AsyncCallback callback, void* context);
+
+    // True if init() claimed the DMA channels that asynchronous reads need
+    bool async_available() const { return dma_tx_channel >= 0; }
+
+    // True while an asynchronous read (or FIFO read) is in flight
+    bool async_busy() const { return async_stage != ASYNC_IDLE; }
+
+    // Function to start draining the FIFO in the background: reads the FIFO status and then bursts out every
+    // waiting sample. Returns false if a read is already in flight or DMA is unavailable.
+    bool start_fifo_read();
+
+    // Function to copy out the samples collected by the last start_fifo_read(), oldest first. Returns how many
+    // were copied (0 if the read is still in flight, or has already been collected), or -1 if it failed.
+    int collect_fifo(LIS3DHSample* samples, int max_samples);
+
 private:
+    enum AsyncStage {
+        ASYNC_IDLE,         // No read in flight
+        ASYNC_READ,         // A read_register_async() transfer
+        ASYNC_FIFO_STATUS,  // start_fifo_read() is reading FIFO_SRC_REG
+        ASYNC_FIFO_DATA     // start_fifo_read() is reading the samples
+    };
+
     i2c_inst_t* i2c_instance;  // I2C instance to be used
     uint8_t i2c_address;       // I2C address of the device
     uint8_t sda_pin;           // SDA pin number
     uint8_t scl_pin;           // SCL pin number
+    uint32_t fifo_overrun_count;  // FIFO overruns seen by read_fifo() and start_fifo_read()
+    LIS3DHConfig current_config;
+    uint8_t sample_shift;      // Right shift that takes a left-justified output register value to a raw sample
+    uint8_t sensitivity;       // Milli-g per raw sample digit
+
+    // Asynchronous transfers
+    int dma_tx_channel;        // Feeds commands to the I2C controller, or -1 if DMA is unavailable
+    int dma_rx_channel;        // Collects the bytes received
+    volatile AsyncStage async_stage;
+    AsyncCallback async_callback;
+    void* async_context;
+    uint16_t async_commands[1 + LIS3DH_FIFO_DEPTH * 6];  // Register address, then one read command per byte
+    uint8_t fifo_status;       // FIFO_SRC_REG, as read by start_fifo_read()
+    uint8_t fifo_data[LIS3DH_FIFO_DEPTH * 6];  // Samples read by start_fifo_read()
+    volatile int fifo_result;  // Samples waiting in fifo_data, or -1 if the read failed
+    volatile bool fifo_ready;  // fifo_data/fifo_result hold a result that has not been collected
+
+    int fifo_count_from_status(uint8_t status);
+    void unpack_samples(const uint8_t* raw_data, LIS3DHSample* samples, int count);
+    void start_transfer(uint8_t reg, uint8_t* data, uint8_t length);
+    void finish_async(bool ok);
+    void on_transfer_complete();
+    void on_transfer_abort();
+    static void dma_irq_handler();
+    static void i2c_irq_handler();
 };
 
 #endif // LIS3DH_H
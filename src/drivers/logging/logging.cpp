@@ -1,46 +1,231 @@
 // Logging system, using the style that state is global in the C file.
+//
+// Messages are not printed when they are logged. log() stores a compact record in a ring buffer for the calling
+// core, and logFlush() formats and prints the records later, when there is time to spare. This keeps the console
+// (which is slow: a line takes milliseconds at 115200 baud) out of the tasks' time-critical paths.
+//
+// Tokenized messages (see LOG_TOKENIZED) are sent as a compact binary record, so that neither the format strings
+// nor the formatted text take up room in flash or time on the UART:
+//
+//   token (4 bytes, little-endian), level (1 byte), time (varint), arguments (one zigzag varint each)
+//
+// A varint is 7 bits per byte, least significant first, with the top bit set on every byte but the last. Arguments
+// are zigzag encoded (0, -1, 1, -2, ... become 0, 1, 2, 3, ...) so that small negative numbers stay short. The
+// record is printed as one line: '$', the record in base64, then a newline. Being text, it passes through the
+// stdio CRLF translation unharmed and can be mixed with ordinary printf output.
 
 #include <stdio.h>
 #include "pico/stdlib.h"
 #include "pico/time.h"
+#include "pico/platform.h"
+#include "hardware/sync.h"
+#include "utils/spsc_ring.h"
 #include "logging.h"
 
+#define LOG_NUM_CORES 2
+
 // --- Device driver internal state:
 
+/// One logged message, waiting to be printed.
+struct LogMessage {
+    uint64_t time;             ///< When it was logged (microseconds since boot)
+    const char *format;        ///< The message, or its printf format if it has arguments (nullptr if tokenized)
+    uint32_t token;            ///< Token of the format string, for a tokenized message
+    uint32_t args[LOG_MAX_ARGS];
+    uint8_t level;
+    uint8_t argCount;
+};
+
 /// Drop messages whose level is below this threshold.
 static LogLevel maxLogLevel = LogLevel::INFORMATION;
 
+/// Messages waiting to be printed, one buffer per core. Each buffer has a single consumer (logFlush) and, in
+/// effect, a single producer: the code running on its core, which stores messages with interrupts disabled so
+/// that an interrupt handler cannot log in the middle of the main program doing so.
+static SpscRing<LogMessage, LOG_BUFFER_LENGTH> messageBuffers[LOG_NUM_CORES];
+
+/// Messages dropped because their core's buffer was full (written by the producer side only).
+static volatile uint32_t droppedCounts[LOG_NUM_CORES];
+
+/// Drops already reported by logFlush().
+static uint32_t reportedDropped;
+
+/// The next message from each core, taken out of its buffer so that the oldest of the two can be printed first.
+static LogMessage nextMessages[LOG_NUM_CORES];
+static bool haveNextMessage[LOG_NUM_CORES];
+
 // --- Device driver functions
 void setLogLevel(LogLevel newLevel)
 {
     maxLogLevel = newLevel;
 }
 
-void log(LogLevel level, const char *msg)
+static void storeMessage(LogLevel level, const char *format, uint32_t token, const uint32_t *args,
+                         unsigned int argCount)
 {
     // Should we show this message?
     if (level < maxLogLevel) {
         return;
     }
 
-    // Get the time since boot
-    uint32_t time = to_ms_since_boot(get_absolute_time());
+    LogMessage message;
+    message.time = time_us_64();
+    message.format = format;
+    message.token = token;
+    message.level = (uint8_t)level;
+    message.argCount = (uint8_t)argCount;
+    for (unsigned int i = 0; i < LOG_MAX_ARGS; ++i) {
+        message.args[i] = i < argCount ? args[i] : 0;
+    }
+
+    uint core = get_core_num();
+    uint32_t interrupts = save_and_disable_interrupts();
+    if (!messageBuffers[core].push(message)) {
+        droppedCounts[core] = droppedCounts[core] + 1;
+    }
+    restore_interrupts(interrupts);
+}
+
+void log(LogLevel level, const char *msg)
+{
+    storeMessage(level, msg, 0, nullptr, 0);
+}
+
+void logRecord(LogLevel level, const char *format, const uint32_t *args, unsigned int argCount)
+{
+    storeMessage(level, format, 0, args, argCount);
+}
+
+void logTokenRecord(LogLevel level, uint32_t token, const uint32_t *args, unsigned int argCount)
+{
+    storeMessage(level, nullptr, token, args, argCount);
+}
+
+/// Append `value` to `out` as a varint, returning the bytes written (at most 5).
+static unsigned int putVarint(uint8_t *out, uint32_t value)
+{
+    unsigned int length = 0;
+    while (value >= 0x80) {
+        out[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+static void printTokenizedMessage(const LogMessage &message)
+{
+    static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    // Pack the record
+    uint8_t record[4 + 1 + 5 * (1 + LOG_MAX_ARGS)];
+    unsigned int length = 0;
+    for (int i = 0; i < 4; ++i) {
+        record[length++] = (uint8_t)(message.token >> (8 * i));
+    }
+    record[length++] = message.level;
+    length += putVarint(&record[length], (uint32_t)message.time);
+    for (unsigned int i = 0; i < message.argCount; ++i) {
+        int32_t arg = (int32_t)message.args[i];
+        length += putVarint(&record[length], ((uint32_t)arg << 1) ^ (uint32_t)(arg >> 31));
+    }
+
+    // Print it in base64 (padded), as a single string so that it goes out in one write
+    char line[2 + 4 * ((sizeof(record) + 2) / 3) + 2];
+    unsigned int out = 0;
+    line[out++] = '$';
+    for (unsigned int i = 0; i < length; i += 3) {
+        uint32_t bits = (uint32_t)record[i] << 16;
+        if (i + 1 < length) {
+            bits |= (uint32_t)record[i + 1] << 8;
+        }
+        if (i + 2 < length) {
+            bits |= record[i + 2];
+        }
+        line[out++] = base64[(bits >> 18) & 0x3F];
+        line[out++] = base64[(bits >> 12) & 0x3F];
+        line[out++] = i + 1 < length ? base64[(bits >> 6) & 0x3F] : '=';
+        line[out++] = i + 2 < length ? base64[bits & 0x3F] : '=';
+    }
+    line[out++] = '\n';
+    line[out] = '\0';
+    fputs(line, stdout);
+}
+
+static void printMessage(const LogMessage &message)
+{
+    if (message.format == nullptr) {
+        printTokenizedMessage(message);
+        return;
+    }
+
+    // Split the time since boot into seconds and milliseconds
+    uint32_t time = (uint32_t)(message.time / 1000);
     uint32_t time_sec = time / 1000;
     uint32_t time_decimal = (time % 1000);
 
     // Convert the level to a string
     const char *levelStr;
-    switch (level) {
+    switch (message.level) {
+        case LogLevel::VERBOSE:
+            levelStr = "Verbose";
+            break;
         case LogLevel::INFORMATION:
             levelStr = "Information";
             break;
         case LogLevel::WARNING:
             levelStr = "Warning";
             break;
-        case LogLevel::ERROR:
+        default:
             levelStr = "Error";
             break;
-        
     };
-    printf("[%u.%03u %s]: %s\n", time_sec, time_decimal, levelStr, msg);
+    printf("[%u.%03u %s]: ", (unsigned)time_sec, (unsigned)time_decimal, levelStr);
+
+    // A message without arguments is printed as it is, so it may contain '%'
+    if (message.argCount == 0) {
+        fputs(message.format, stdout);
+    } else {
+        printf(message.format, message.args[0], message.args[1], message.args[2], message.args[3]);
+    }
+    putchar('\n');
+}
+
+unsigned int logFlush(unsigned int maxMessages)
+{
+    unsigned int printed = 0;
+    while (printed < maxMessages) {
+        // Print the older of the two cores' next messages
+        int oldest = -1;
+        for (int core = 0; core < LOG_NUM_CORES; ++core) {
+            if (!haveNextMessage[core]) {
+                haveNextMessage[core] = messageBuffers[core].pop(nextMessages[core]);
+            }
+            if (haveNextMessage[core] && (oldest < 0 || nextMessages[core].time < nextMessages[oldest].time)) {
+                oldest = core;
+            }
+        }
+        if (oldest < 0) {
+            break;
+        }
+        printMessage(nextMessages[oldest]);
+        haveNextMessage[oldest] = false;
+        printed++;
+    }
+
+    uint32_t dropped = logDroppedCount();
+    if (dropped != reportedDropped) {
+        printf("[log]: %u messages dropped\n", (unsigned)(dropped - reportedDropped));
+        reportedDropped = dropped;
+    }
+    return printed;
+}
+
+uint32_t logDroppedCount()
+{
+    uint32_t total = 0;
+    for (int core = 0; core < LOG_NUM_CORES; ++core) {
+        total += droppedCounts[core];
+    }
+    return total;
 }
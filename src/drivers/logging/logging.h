@@ -1,7 +1,32 @@
-#pragma once 
+#pragma once
+
+#include <stdint.h>
+#include <type_traits>
+
+/// Messages each core can have waiting to be printed (a power of two). A message logged while its core's buffer is
+/// full is dropped and counted.
+#ifndef LOG_BUFFER_LENGTH
+#define LOG_BUFFER_LENGTH 64
+#endif
+
+/// Most integer arguments one message can carry.
+#define LOG_MAX_ARGS 4
+
+/// Lowest level (a LogLevel value) the LOG_ macros compile in; messages below it produce no code at all. Normally
+/// set from the LOG_LEVEL CMake option.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 1
+#endif
+
+/// When 1, the LOG_ macros send a 32-bit token in place of each format string, and the strings are left out of the
+/// program. Normally set from the LOG_TOKENIZED CMake option.
+#ifndef LOG_TOKENIZED
+#define LOG_TOKENIZED 0
+#endif
 
 /// Represents the priority of a log message.
 enum LogLevel {
+    VERBOSE,
     INFORMATION,
     WARNING,
     ERROR,
@@ -11,4 +36,91 @@ enum LogLevel {
 void setLogLevel(LogLevel newLevel);
 
 /// Log a new message.
+///
+/// Logging does not print anything: it stores a small record (the time, the level, a pointer to the message and
+/// its arguments) in a buffer for the calling core, which takes a few microseconds and is safe from interrupt
+/// handlers. The messages are printed later by logFlush(). Because only the pointer is stored, the message must
+/// still exist when it is printed, so it should be a string literal.
 void log(LogLevel level, const char *msg);
+
+/// Store a message with integer arguments. Used by the log() template; call that instead.
+void logRecord(LogLevel level, const char *format, const uint32_t *args, unsigned int argCount);
+
+/// Store a tokenized message. Used by the logTokenized() template; call that instead.
+void logTokenRecord(LogLevel level, uint32_t token, const uint32_t *args, unsigned int argCount);
+
+/// Log a message with up to LOG_MAX_ARGS integer arguments, which are printed with `format` (a printf format
+/// string literal, without a trailing newline) when the message is flushed. Each argument is stored as 32 bits,
+/// so use %d, %u or %x conversions.
+template <typename... Args>
+void log(LogLevel level, const char *format, Args... args)
+{
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many arguments for one log message");
+    static_assert(((std::is_integral<Args>::value || std::is_enum<Args>::value) && ...),
+                  "Only integers can be logged: anything else may have changed by the time the message is printed");
+    const uint32_t values[] = {(uint32_t)args..., 0};  // The extra element keeps the array from being empty
+    logRecord(level, format, values, sizeof...(Args));
+}
+
+/// Log a message identified by the token of its format string (see logToken()), with the same arguments as log().
+template <typename... Args>
+void logTokenized(LogLevel level, uint32_t token, Args... args)
+{
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many arguments for one log message");
+    static_assert(((std::is_integral<Args>::value || std::is_enum<Args>::value) && ...),
+                  "Only integers can be logged: anything else may have changed by the time the message is printed");
+    const uint32_t values[] = {(uint32_t)args..., 0};
+    logTokenRecord(level, token, values, sizeof...(Args));
+}
+
+/// Token that stands for a format string: its 32-bit FNV-1a hash. The log_tokens host tool computes the same hash
+/// when it builds the dictionary used to turn tokens back into text.
+constexpr uint32_t logToken(const char *format)
+{
+    uint32_t hash = 2166136261u;
+    for (; *format != '\0'; ++format) {
+        hash = (hash ^ (uint8_t)*format) * 16777619u;
+    }
+    return hash;
+}
+
+/// The token of a string literal, computed by the compiler so that the string itself is not in the program.
+#define LOG_TOKEN(format) (std::integral_constant<uint32_t, logToken(format)>::value)
+
+/// Log at a given level: tokenized or as text, depending on LOG_TOKENIZED. Use the LOG_ level macros below.
+#if LOG_TOKENIZED
+#define LOG_AT(level, format, ...) logTokenized(level, LOG_TOKEN(format), ##__VA_ARGS__)
+#else
+#define LOG_AT(level, format, ...) log(level, format, ##__VA_ARGS__)
+#endif
+
+/// Log a message (a printf format string literal) with up to LOG_MAX_ARGS integer arguments. A macro for a level
+/// below LOG_MIN_LEVEL expands to nothing, so its arguments are not even evaluated. The log_tokens tool finds the
+/// format strings for the dictionary by looking for these macro names, so pass the literal directly.
+#if LOG_MIN_LEVEL <= 0
+#define LOG_VERBOSE(format, ...) LOG_AT(LogLevel::VERBOSE, format, ##__VA_ARGS__)
+#else
+#define LOG_VERBOSE(format, ...) do { } while (0)
+#endif
+#if LOG_MIN_LEVEL <= 1
+#define LOG_INFO(format, ...) LOG_AT(LogLevel::INFORMATION, format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...) do { } while (0)
+#endif
+#if LOG_MIN_LEVEL <= 2
+#define LOG_WARNING(format, ...) LOG_AT(LogLevel::WARNING, format, ##__VA_ARGS__)
+#else
+#define LOG_WARNING(format, ...) do { } while (0)
+#endif
+#define LOG_ERROR(format, ...) LOG_AT(LogLevel::ERROR, format, ##__VA_ARGS__)
+
+/// Print up to `maxMessages` waiting messages, oldest first from each core, and report any that were dropped.
+/// Returns the number printed. Call it from one place only (e.g. the main loop's idle time on core 0).
+///
+/// Tokenized messages are printed as a line of '$' followed by the message in base64: the token, the level, the
+/// time in microseconds and the arguments (the last two as variable-length integers, see logging.cpp). The
+/// log_tokens tool decodes them and passes any other console output through unchanged.
+unsigned int logFlush(unsigned int maxMessages = UINT32_MAX);
+
+/// Number of messages dropped so far because a buffer was full.
+uint32_t logDroppedCount();
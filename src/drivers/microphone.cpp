@@ -1,12 +1,27 @@
 #include "microphone.h"
 #include <stdio.h>
 #include "hardware/adc.h"  // Ensure that the ADC library is included
+#include "hardware/dma.h"
+#include "hardware/irq.h"
 
 #define DC_OFFSET 2048  // Define a constant for the DC offset
+#define ADC_CLOCK_HZ 48000000  // The ADC is clocked from the 48 MHz USB PLL
+
+// The microphone currently streaming (the DMA interrupt handler has no context pointer)
+static microphone *active_microphone = nullptr;
+static bool dma_irq_handler_installed[2] = {false, false};
 
 // Constructor: Initialize microphone with a default GPIO pin
 microphone::microphone()
-    : gpio_pin(26) {}
+    : gpio_pin(26), storage(nullptr), buffer_size(0), num_buffers(0), dma_channels{-1, -1}, dma_irq_index(0),
+      filled_sequence(0), next_sequence{0, 0}, read_sequence(0), holding_buffer(false),
+      overruns(0), streaming(false) {}
+
+// Destructor: make sure the DMA is no longer writing into the caller's buffers
+microphone::~microphone()
+{
+    stop_streaming();
+}
 
 /*! \brief Initialize the microphone by setting up the ADC.
  *
@@ -14,8 +29,9 @@ microphone::microphone()
  * and sets up the ADC in free-running mode.
  *
  * \param gpio_pin The GPIO pin to read microphone data from (default: GPIO26).
+ * \param sample_rate The ADC sample rate in Hz (default: 44100).
  */
-void microphone::init(uint gpio_pin)
+void microphone::init(uint gpio_pin, uint sample_rate)
 {
     this->gpio_pin = gpio_pin;
 
@@ -38,13 +54,13 @@ void microphone::init(uint gpio_pin)
     // Initialize and configure the ADC
     adc_init();
     adc_select_input(adc_input);  // Select the ADC input channel based on the GPIO pin
-    adc_set_clkdiv(1087);          // Set clock divider for sampling rate (adjust as needed)
+    adc_set_clkdiv((float)ADC_CLOCK_HZ / sample_rate - 1.0f);  // One conversion every (1 + div) ADC clocks
     adc_fifo_setup(
         true,   // Write each completed conversion to the sample FIFO
-        false,  // Disable DMA data request (DREQ)
+        true,   // Enable DMA data request (DREQ), used by start_streaming()
         1,      // Trigger when at least 1 sample is present in the FIFO
         false,  // Disable error bits
-        true    // Shift results to 12 bits for ADC result (0-4095 range)
+        false   // Keep the full 12-bit ADC result (0-4095 range) in each 16-bit FIFO entry
     );
     adc_run(true); // Start ADC in free-running mode
 }
@@ -70,15 +86,223 @@ void microphone::read_blocking(int16_t *microphone_data, size_t buffer_size)
     for (size_t i = 0; i < buffer_size; ++i)
     {
         uint16_t adc_value = adc_fifo_get_blocking();  // Read the next sample from the ADC FIFO
-        microphone_data[i] = (int16_t)(adc_value - DC_OFFSET);  // Subtract DC offset
+        // Subtract DC offset and scale by 32 into Q15 range, in the same pass (a multiply, as the difference
+        // can be negative and left shifting a negative value is undefined)
+        microphone_data[i] = (int16_t)(((int32_t)adc_value - DC_OFFSET) * (1 << 5));
     }
 
     adc_run(false);   // Stop ADC free-running mode after reading required samples
     adc_fifo_drain(); // Drain any leftover samples in the FIFO to clean up
+}
 
-    // Process the microphone samples for Q15 format (optional, can be done in main task instead)
-    for (size_t i = 0; i < buffer_size; ++i)
-    {
-        microphone_data[i] = (int16_t)(microphone_data[i] << 5);  // Left shift by 5 to scale into Q15 range
+// Address of capture buffer used for a given sequence number
+uint16_t *microphone::buffer_for_sequence(uint32_t sequence) const
+{
+    return storage + (sequence % num_buffers) * buffer_size;
+}
+
+/*! \brief Start continuous DMA capture into a ring of buffers.
+ *
+ * Two DMA channels are chained to each other: while one is filling a buffer, the other is
+ * armed for the next one, so the ADC is never left without a destination. Each time a
+ * channel completes, the DMA interrupt publishes the finished buffer and re-arms that
+ * channel two buffers further round the ring.
+ *
+ * \param storage Memory for `num_buffers` consecutive buffers of `buffer_size` samples.
+ * \param buffer_size The number of samples in each capture buffer.
+ * \param num_buffers The number of capture buffers (at least 2).
+ * \return false if the arguments are invalid or no DMA channels are free.
+ */
+bool microphone::start_streaming(uint16_t *storage, size_t buffer_size, uint num_buffers)
+{
+    stop_streaming();
+
+    if (storage == nullptr || buffer_size == 0 || num_buffers < 2) {
+        printf("Error: streaming needs at least two non-empty capture buffers.\n");
+        return false;
+    }
+
+    if (active_microphone != nullptr) {
+        printf("Error: another microphone is already streaming.\n");
+        return false;
+    }
+
+    dma_channels[0] = dma_claim_unused_channel(false);
+    dma_channels[1] = dma_claim_unused_channel(false);
+    if (dma_channels[0] < 0 || dma_channels[1] < 0) {
+        printf("Error: no free DMA channels for microphone streaming.\n");
+        for (int &channel : dma_channels) {
+            if (channel >= 0) {
+                dma_channel_unclaim(channel);
+            }
+            channel = -1;
+        }
+        return false;
+    }
+
+    this->storage = storage;
+    this->buffer_size = buffer_size;
+    this->num_buffers = num_buffers;
+    filled_sequence = 0;
+    read_sequence = 0;
+    holding_buffer = false;
+    overruns = 0;
+
+    // Start from an empty FIFO so the first buffer is contiguous with the ones after it
+    adc_run(false);
+    adc_fifo_drain();
+
+    // Interrupts are taken on the core that starts streaming: DMA_IRQ_0 on core 0 and DMA_IRQ_1 on core 1
+    dma_irq_index = get_core_num();
+
+    // Channel i fills sequence i first, then every second buffer after that
+    for (uint i = 0; i < 2; ++i) {
+        dma_channel_config config = dma_channel_get_default_config(dma_channels[i]);
+        channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+        channel_config_set_read_increment(&config, false);       // Always read the ADC FIFO
+        channel_config_set_write_increment(&config, true);       // Walk through the buffer
+        channel_config_set_dreq(&config, DREQ_ADC);              // Paced by the ADC
+        channel_config_set_chain_to(&config, dma_channels[1 - i]); // Hand over without a gap
+        next_sequence[i] = i;
+        dma_channel_configure(dma_channels[i], &config, buffer_for_sequence(i), &adc_hw->fifo,
+                              buffer_size, false);
+        dma_irqn_set_channel_enabled(dma_irq_index, dma_channels[i], true);
+    }
+
+    active_microphone = this;
+    if (!dma_irq_handler_installed[dma_irq_index]) {
+        // Shared so that other drivers can also use the same DMA interrupt
+        irq_add_shared_handler(DMA_IRQ_0 + dma_irq_index, dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0 + dma_irq_index, true);
+        dma_irq_handler_installed[dma_irq_index] = true;
+    }
+
+    streaming = true;
+    dma_channel_start(dma_channels[0]);
+    adc_run(true);
+    return true;
+}
+
+/*! \brief Stop continuous capture and release the DMA channels. */
+void microphone::stop_streaming()
+{
+    if (!streaming) {
+        return;
+    }
+
+    // Stop conversions first so neither channel can make further progress
+    adc_run(false);
+
+    for (int channel : dma_channels) {
+        dma_irqn_set_channel_enabled(dma_irq_index, channel, false);
+    }
+
+    // Aborting one channel can trigger its chained partner, so abort the first one again
+    dma_channel_abort(dma_channels[0]);
+    dma_channel_abort(dma_channels[1]);
+    dma_channel_abort(dma_channels[0]);
+
+    for (int &channel : dma_channels) {
+        dma_irqn_acknowledge_channel(dma_irq_index, channel);
+        dma_channel_unclaim(channel);
+        channel = -1;
+    }
+
+    adc_fifo_drain();
+    active_microphone = nullptr;
+    holding_buffer = false;
+    streaming = false;
+}
+
+/*! \brief Non-blocking version of `acquire_buffer()`.
+ *
+ * \return Pointer to the next completed buffer, or nullptr if none is ready yet.
+ */
+const uint16_t *microphone::try_acquire_buffer()
+{
+    if (!streaming) {
+        return nullptr;
+    }
+
+    // Acquiring again implicitly hands back the previous buffer
+    release_buffer();
+
+    uint32_t filled = filled_sequence;
+    if (filled == read_sequence) {
+        return nullptr;
+    }
+
+    // A buffer is only intact until the DMA comes back round to it. If we have fallen
+    // that far behind, skip to the newest completed buffer.
+    if (filled - read_sequence > num_buffers - 1) {
+        overruns += (filled - 1) - read_sequence;
+        read_sequence = filled - 1;
+    }
+
+    holding_buffer = true;
+    return buffer_for_sequence(read_sequence);
+}
+
+/*! \brief Wait for the next completed capture buffer.
+ *
+ * \return Pointer to `buffer_size` raw ADC samples, or nullptr if not streaming.
+ */
+const uint16_t *microphone::acquire_buffer()
+{
+    if (!streaming) {
+        return nullptr;
+    }
+
+    const uint16_t *buffer;
+    while ((buffer = try_acquire_buffer()) == nullptr) {
+        tight_loop_contents();
+    }
+    return buffer;
+}
+
+/*! \brief Hand the buffer returned by `acquire_buffer()` back to the DMA.
+ *
+ * If the DMA wrapped round to the buffer while it was still being processed, the data the
+ * caller saw may have been partly overwritten, so this is counted as an overrun.
+ */
+void microphone::release_buffer()
+{
+    if (!holding_buffer) {
+        return;
+    }
+
+    if (filled_sequence - read_sequence > num_buffers - 1) {
+        overruns++;
+    }
+
+    holding_buffer = false;
+    read_sequence++;
+}
+
+// DMA completion: publish the finished buffer and re-arm the channel two buffers ahead.
+// The other channel has already been started by the chain, so this only has to finish
+// before that channel completes.
+void microphone::on_dma_complete(uint channel_index)
+{
+    filled_sequence = filled_sequence + 1;
+
+    uint32_t next = next_sequence[channel_index] + 2;
+    next_sequence[channel_index] = next;
+    dma_channel_set_write_addr(dma_channels[channel_index], buffer_for_sequence(next), false);
+}
+
+// Shared DMA_IRQ_0/DMA_IRQ_1 handler: only acknowledge the channels that belong to the microphone
+void microphone::dma_irq_handler()
+{
+    microphone *mic = active_microphone;
+    if (mic == nullptr) {
+        return;
+    }
+
+    for (uint i = 0; i < 2; ++i) {
+        if (dma_irqn_get_channel_status(mic->dma_irq_index, mic->dma_channels[i])) {
+            dma_irqn_acknowledge_channel(mic->dma_irq_index, mic->dma_channels[i]);
+            mic->on_dma_complete(i);
+        }
     }
 }
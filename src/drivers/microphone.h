@@ -7,6 +7,8 @@
 /*! \brief A class to handle microphone input using the ADC on the RP2040.
  *
  * This class provides methods to initialize the ADC and sample data from the microphone.
+ * Samples can either be read in a single blocking burst (`read_blocking`) or streamed
+ * continuously by DMA into a ring of capture buffers (`start_streaming`).
  */
 class microphone
 {
@@ -14,14 +16,18 @@ public:
     // Constructor
     microphone();
 
+    // Destructor: stops streaming (if active) so the DMA never writes into freed buffers
+    ~microphone();
+
     /*! \brief Initialize the microphone by setting up the ADC.
      *
      * This method configures the GPIO for microphone input (GPIO26 by default),
      * and sets up the ADC in free-running mode.
      *
      * \param gpio_pin The GPIO pin to read microphone data from (default: GPIO26).
+     * \param sample_rate The ADC sample rate in Hz (default: 44100).
      */
-    void init(uint gpio_pin = 26);
+    void init(uint gpio_pin = 26, uint sample_rate = 44100);
 
     /*! \brief Blocking read of ADC samples.
      *
@@ -32,8 +38,69 @@ public:
      */
     void read_blocking(int16_t *microphone_data, size_t buffer_size);
 
+    /*! \brief Start continuous DMA capture into a ring of buffers.
+     *
+     * Two chained DMA channels fill the buffers in `storage` back to back, so no samples
+     * are lost between buffers. Each buffer holds raw 12-bit ADC results (0-4095).
+     *
+     * The DMA interrupt is handled on the calling core (DMA_IRQ_0 on core 0, DMA_IRQ_1 on
+     * core 1), so capture can be run on either core alongside drivers on the other.
+     *
+     * \param storage Memory for `num_buffers` consecutive buffers of `buffer_size` samples.
+     * \param buffer_size The number of samples in each capture buffer.
+     * \param num_buffers The number of capture buffers (at least 2).
+     * \return false if the arguments are invalid or no DMA channels are free.
+     */
+    bool start_streaming(uint16_t *storage, size_t buffer_size, uint num_buffers);
+
+    /*! \brief Stop continuous capture and release the DMA channels. */
+    void stop_streaming();
+
+    /*! \brief Wait for the next completed capture buffer.
+     *
+     * The returned buffer stays valid until `release_buffer()` is called, or until the DMA
+     * wraps around to it again (`num_buffers - 1` capture periods after it completed).
+     * If the caller has fallen too far behind, the oldest buffers are skipped and counted
+     * as overruns.
+     *
+     * \return Pointer to `buffer_size` raw ADC samples.
+     */
+    const uint16_t *acquire_buffer();
+
+    /*! \brief Non-blocking version of `acquire_buffer()`.
+     *
+     * \return Pointer to the next completed buffer, or nullptr if none is ready yet.
+     */
+    const uint16_t *try_acquire_buffer();
+
+    /*! \brief Hand the buffer returned by `acquire_buffer()` back to the DMA. */
+    void release_buffer();
+
+    /*! \brief Number of capture buffers that were lost because the consumer fell behind. */
+    uint32_t overrun_count() const { return overruns; }
+
+    /*! \brief True while continuous capture is running. */
+    bool is_streaming() const { return streaming; }
+
 private:
     uint gpio_pin; /*!< GPIO pin for ADC input */
+
+    // Continuous capture state
+    uint16_t *storage;                  /*!< Capture buffers, laid out back to back */
+    size_t buffer_size;                 /*!< Samples per capture buffer */
+    uint num_buffers;                   /*!< Number of capture buffers */
+    int dma_channels[2];                /*!< Ping-pong DMA channels, chained to each other */
+    uint dma_irq_index;                 /*!< DMA interrupt used (0 or 1, the core that started streaming) */
+    volatile uint32_t filled_sequence;  /*!< Number of buffers the DMA has completed */
+    volatile uint32_t next_sequence[2]; /*!< Sequence number each channel is currently armed for */
+    uint32_t read_sequence;             /*!< Sequence number of the next buffer to hand out */
+    bool holding_buffer;                /*!< True between acquire_buffer() and release_buffer() */
+    uint32_t overruns;                  /*!< Buffers skipped or overwritten before use */
+    bool streaming;                     /*!< True while the DMA is running */
+
+    uint16_t *buffer_for_sequence(uint32_t sequence) const;
+    void on_dma_complete(uint channel_index);
+    static void dma_irq_handler();
 };
 
-#endif // MICROPHONE_H
\ No newline at end of file
+#endif // MICROPHONE_H
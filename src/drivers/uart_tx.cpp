@@ -0,0 +1,128 @@
+#include "uart_tx.h"
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+// Queues with a DMA transfer in flight, by DMA channel (for the interrupt handler)
+static UartTx* dma_owners[NUM_DMA_CHANNELS];
+static bool dma_irq_handler_installed = false;
+
+// Smallest power of two that is at least `n`
+static size_t round_up_pow2(size_t n) {
+    size_t size = 1;
+    while (size < n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+// Constructor: claims a DMA channel that writes to the UART's data register, paced by its TX DREQ
+UartTx::UartTx(uart_inst_t* uart, size_t capacity)
+    : uart(uart), buffer(round_up_pow2(capacity)), mask((uint32_t)buffer.size() - 1), head(0), tail(0),
+      in_flight(0), dma_channel(-1), queued_count(0), sent_count(0), dropped_count(0) {
+    dma_channel = dma_claim_unused_channel(false);
+    if (dma_channel < 0) {
+        return;  // No DMA: write() falls back to blocking writes
+    }
+
+    dma_channel_config config = dma_channel_get_default_config(dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);  // Always write the TX FIFO
+    channel_config_set_dreq(&config, uart_get_dreq(uart, true));
+    dma_channel_configure(dma_channel, &config, &uart_get_hw(uart)->dr, buffer.data(), 0, false);
+
+    dma_owners[dma_channel] = this;
+    dma_channel_set_irq0_enabled(dma_channel, true);
+    if (!dma_irq_handler_installed) {
+        // Shared with the other drivers that complete their transfers on DMA_IRQ_0
+        irq_add_shared_handler(DMA_IRQ_0, dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0, true);
+        dma_irq_handler_installed = true;
+    }
+}
+
+UartTx::~UartTx() {
+    if (dma_channel >= 0) {
+        dma_channel_set_irq0_enabled(dma_channel, false);
+        dma_channel_abort(dma_channel);
+        dma_owners[dma_channel] = nullptr;
+        dma_channel_unclaim(dma_channel);
+    }
+}
+
+bool UartTx::write(const uint8_t* data, size_t length) {
+    if (dma_channel < 0) {
+        uart_write_blocking(uart, data, length);
+        queued_count += length;
+        sent_count = sent_count + length;
+        return true;
+    }
+
+    if (length > space()) {
+        dropped_count += length;
+        return false;
+    }
+
+    // Copy in two parts if the message wraps around the end of the buffer
+    uint32_t write = head;
+    size_t offset = write & mask;
+    size_t first = buffer.size() - offset;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(&buffer[offset], data, first);
+    memcpy(&buffer[0], data + first, length - first);
+    queued_count += length;
+
+    uint32_t irq_status = save_and_disable_interrupts();
+    head = write + (uint32_t)length;
+    if (in_flight == 0) {
+        start_transfer();
+    }
+    restore_interrupts(irq_status);
+    return true;
+}
+
+size_t UartTx::space() const {
+    return buffer.size() - (head - tail);
+}
+
+bool UartTx::is_busy() const {
+    return head != tail;
+}
+
+// Send the longest contiguous run of queued bytes. Called with interrupts disabled or from interrupt context.
+void UartTx::start_transfer() {
+    uint32_t offset = tail & mask;
+    uint32_t length = head - tail;
+    if (length == 0) {
+        in_flight = 0;
+        return;
+    }
+    if (length > buffer.size() - offset) {
+        length = buffer.size() - offset;  // Stop at the end of the buffer; the rest follows from the start
+    }
+    in_flight = length;
+    dma_channel_set_read_addr(dma_channel, &buffer[offset], false);
+    dma_channel_set_trans_count(dma_channel, length, true);
+}
+
+// The DMA has written the last byte of a transfer to the TX FIFO: free its space and send the next run
+void UartTx::on_transfer_complete() {
+    tail = tail + in_flight;
+    sent_count = sent_count + in_flight;
+    start_transfer();
+}
+
+// Shared DMA_IRQ_0 handler: only acknowledge the channels that belong to a UART queue
+void UartTx::dma_irq_handler() {
+    for (uint channel = 0; channel < NUM_DMA_CHANNELS; ++channel) {
+        if (dma_owners[channel] != nullptr && dma_channel_get_irq0_status(channel)) {
+            dma_channel_acknowledge_irq0(channel);
+            dma_owners[channel]->on_transfer_complete();
+        }
+    }
+}
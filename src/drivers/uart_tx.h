@@ -0,0 +1,51 @@
+#ifndef UART_TX_H
+#define UART_TX_H
+
+#include "hardware/uart.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Transmit queue for a UART. Bytes are copied into a ring buffer and sent in the background by DMA, so writing
+// never waits for the line. Each write() is all or nothing: a message that does not fit is dropped whole (and
+// counted), so a framed packet is never cut short. Callers that would rather wait can check space() first.
+class UartTx {
+public:
+    // `capacity` is rounded up to a power of two
+    UartTx(uart_inst_t* uart, size_t capacity);
+    ~UartTx();
+
+    // Queue `length` bytes. Returns false, sending nothing, if there is not room for all of them. Must only be
+    // called from one place at a time (it is the ring's only producer), and not from interrupt context.
+    bool write(const uint8_t* data, size_t length);
+
+    // Free space in the queue, in bytes
+    size_t space() const;
+
+    // True while there are bytes waiting or being sent
+    bool is_busy() const;
+
+    // Counters: bytes accepted by write(), bytes the DMA has finished sending, and bytes dropped because the
+    // queue was full
+    uint32_t bytes_queued() const { return queued_count; }
+    uint32_t bytes_sent() const { return sent_count; }
+    uint32_t bytes_dropped() const { return dropped_count; }
+
+private:
+    uart_inst_t* uart;
+    std::vector<uint8_t> buffer;
+    uint32_t mask;                 // buffer.size() - 1
+    volatile uint32_t head;        // Bytes ever written (only written by write())
+    volatile uint32_t tail;        // Bytes ever sent (only written when a transfer completes)
+    volatile uint32_t in_flight;   // Length of the DMA transfer running, or 0 if idle
+    int dma_channel;               // Feeds the UART TX FIFO, or -1 to send with the CPU
+    uint32_t queued_count;
+    volatile uint32_t sent_count;
+    uint32_t dropped_count;
+
+    void start_transfer();
+    void on_transfer_complete();
+    static void dma_irq_handler();
+};
+
+#endif // UART_TX_H
@@ -0,0 +1,21 @@
+#include "band_energy.h"
+
+void band_energy_q15(const int16_t *spectrum, const uint16_t *edges, size_t num_bands, uint64_t *energy)
+{
+    for (size_t band = 0; band < num_bands; ++band) {
+        uint64_t sum = 0;
+        const int16_t *bin = spectrum + 2 * edges[band];
+        const int16_t *end = spectrum + 2 * edges[band + 1];
+
+        while (bin < end) {
+            int32_t re = bin[0];
+            int32_t im = bin[1];
+            // Each square is at most 2^30, so the sum of two fits in 32 unsigned bits
+            uint32_t power = (uint32_t)(re * re) + (uint32_t)(im * im);
+            sum += power;
+            bin += 2;
+        }
+
+        energy[band] = sum;
+    }
+}
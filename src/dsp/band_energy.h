@@ -0,0 +1,114 @@
+#ifndef BAND_ENERGY_H
+#define BAND_ENERGY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+
+/*! \brief Band energies are sums of Q15 bin powers (re^2 + im^2) in a 64-bit accumulator.
+ *
+ * This is the old floating point energy, `sum(arm_cmplx_mag_squared_q15(bin)) / 32768.0f`,
+ * as a fixed point number with 32 fractional bits (and without the 17-bit truncation that
+ * `arm_cmplx_mag_squared_q15` applies per bin). The accumulator cannot overflow for any
+ * supported FFT size.
+ */
+#define BAND_ENERGY_ONE (4294967296.0)
+
+/*! \brief Convert an energy level written as a real number into band energy units. */
+constexpr uint64_t band_energy_from_real(double energy)
+{
+    return (uint64_t)(energy * BAND_ENERGY_ONE);
+}
+
+/*! \brief The `n`th root of `x` (x > 0), by Newton's method, for use in constant expressions. */
+constexpr double constexpr_nth_root(double x, unsigned int n)
+{
+    // Bernoulli's inequality makes this an upper bound for x >= 1, so Newton's method converges from above
+    double root = x > 1.0 ? 1.0 + (x - 1.0) / n : 1.0;
+    for (int iteration = 0; iteration < 200; ++iteration) {
+        double power = 1.0;
+        for (unsigned int i = 1; i < n; ++i) {
+            power *= root;
+        }
+        double next = root - (power * root - x) / (n * power);
+        if (next == root) {
+            break;
+        }
+        root = next;
+    }
+    return root;
+}
+
+/*! \brief Generate logarithmically spaced FFT bin edges for a set of bands.
+ *
+ * Band `k` covers bins `edges[k]` up to (but not including) `edges[k + 1]`. The edges are
+ * spaced geometrically from `low_hz` to `high_hz`, rounded to the nearest bin, and pushed
+ * apart where necessary so that every band contains at least one bin. The top edge is
+ * limited to the Nyquist bin (`fft_size / 2`), which is not included.
+ *
+ * \tparam NUM_BANDS Number of bands (e.g. one per LED).
+ * \param fft_size FFT length in samples.
+ * \param sample_rate Sample rate in Hz.
+ * \param low_hz Lower edge of the first band.
+ * \param high_hz Upper edge of the last band.
+ */
+template <size_t NUM_BANDS>
+constexpr std::array<uint16_t, NUM_BANDS + 1> make_log_band_edges(size_t fft_size, double sample_rate,
+                                                                   double low_hz, double high_hz)
+{
+    std::array<uint16_t, NUM_BANDS + 1> edges {};
+    const double bin_hz = sample_rate / fft_size;
+    const double top_bin = (double)(fft_size / 2);
+    double low_bin = low_hz / bin_hz;
+    double high_bin = high_hz / bin_hz;
+    if (low_bin < 1.0) {
+        low_bin = 1.0; // Never include DC
+    }
+    if (high_bin > top_bin) {
+        high_bin = top_bin;
+    }
+
+    const double ratio = constexpr_nth_root(high_bin / low_bin, NUM_BANDS);
+    double edge = low_bin;
+    for (size_t k = 0; k <= NUM_BANDS; ++k) {
+        uint16_t bin = (uint16_t)(edge + 0.5);
+        if (k == NUM_BANDS) {
+            bin = (uint16_t)(high_bin + 0.5);
+        }
+        if (k > 0 && bin <= edges[k - 1]) {
+            bin = edges[k - 1] + 1;
+        }
+        edges[k] = bin;
+        edge *= ratio;
+    }
+    return edges;
+}
+
+/*! \brief True if every band has at least one bin and the bands end at or below the Nyquist bin.
+ *
+ * Use this in a `static_assert` on generated edges: it fails when there are more bands than bins.
+ */
+template <size_t NUM_EDGES>
+constexpr bool band_edges_valid(const std::array<uint16_t, NUM_EDGES> &edges, size_t fft_size)
+{
+    for (size_t k = 1; k < NUM_EDGES; ++k) {
+        if (edges[k] <= edges[k - 1]) {
+            return false;
+        }
+    }
+    return edges[0] > 0 && edges[NUM_EDGES - 1] <= fft_size / 2;
+}
+
+/*! \brief Sum the power of the FFT bins in each band, using integer arithmetic only.
+ *
+ * Only the bins between the first and last edge are visited, so the magnitude of bins that
+ * are not mapped to any band is never computed.
+ *
+ * \param spectrum Interleaved Q15 complex FFT output (as produced by `arm_rfft_q15`).
+ * \param edges `num_bands + 1` ascending bin edges.
+ * \param num_bands Number of bands.
+ * \param energy Output: the energy of each band, in band energy units.
+ */
+void band_energy_q15(const int16_t *spectrum, const uint16_t *edges, size_t num_bands, uint64_t *energy);
+
+#endif // BAND_ENERGY_H
@@ -0,0 +1,80 @@
+#include "goertzel.h"
+#include "window.h"
+
+void goertzel_init(GoertzelBand *band, double cycles_per_sample, uint32_t block_length, uint32_t window_length)
+{
+    double coefficient = 2.0 * constexpr_cos(2.0 * CONSTEXPR_PI * cycles_per_sample);
+    band->coefficient = (int32_t)(coefficient * (double)(1 << GOERTZEL_COEFFICIENT_SHIFT) +
+                                  (coefficient < 0 ? -0.5 : 0.5));
+    band->block_length = block_length > 0 ? block_length : 1;
+    band->window_step = (uint32_t)(((uint64_t)window_length << 16) / band->block_length);
+    goertzel_reset(band);
+}
+
+void goertzel_reset(GoertzelBand *band)
+{
+    band->position = 0;
+    band->window_phase = 0;
+    band->s1 = 0;
+    band->s2 = 0;
+    band->power_sum = 0;
+    band->blocks = 0;
+}
+
+void goertzel_process(GoertzelBand *band, const int16_t *samples, size_t length, const int16_t *window)
+{
+    // Keep the state in locals so that it stays in registers over the loop
+    const int64_t coefficient = band->coefficient;
+    const uint32_t window_step = band->window_step;
+    int32_t s1 = band->s1;
+    int32_t s2 = band->s2;
+    uint32_t position = band->position;
+    uint32_t window_phase = band->window_phase;
+
+    for (size_t i = 0; i < length; ++i) {
+        int32_t windowed = ((int32_t)samples[i] * window[window_phase >> 16]) >> 15;
+        window_phase += window_step;
+        int32_t s0 = windowed + (int32_t)((coefficient * s1) >> GOERTZEL_COEFFICIENT_SHIFT) - s2;
+        s2 = s1;
+        s1 = s0;
+
+        if (++position == band->block_length) {
+            // |X|^2 = s1^2 + s2^2 - 2 cos(w) s1 s2 (the terms are below 2^56, so this cannot overflow)
+            int64_t power = (int64_t)s1 * s1 + (int64_t)s2 * s2 -
+                            ((coefficient * s1) >> GOERTZEL_COEFFICIENT_SHIFT) * s2;
+            band->power_sum += power > 0 ? (uint64_t)power : 0;
+            band->blocks++;
+            s1 = 0;
+            s2 = 0;
+            position = 0;
+            window_phase = 0;
+        }
+    }
+
+    band->s1 = s1;
+    band->s2 = s2;
+    band->position = position;
+    band->window_phase = window_phase;
+}
+
+bool goertzel_take_power(GoertzelBand *band, uint64_t *power)
+{
+    if (band->blocks == 0) {
+        return false;
+    }
+    *power = band->power_sum / band->blocks;
+    band->power_sum = 0;
+    band->blocks = 0;
+    return true;
+}
+
+void goertzel_remove_dc(int32_t *dc, const uint16_t *raw, int16_t *out, size_t length)
+{
+    int32_t level = *dc;
+    for (size_t i = 0; i < length; ++i) {
+        int32_t sample = (int32_t)raw[i] << GOERTZEL_DC_FRACTION_BITS;
+        level += (sample - level) >> GOERTZEL_DC_SHIFT;
+        out[i] = (int16_t)((sample - level) >> GOERTZEL_DC_FRACTION_BITS);
+    }
+    *dc = level;
+}
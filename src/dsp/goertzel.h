@@ -0,0 +1,76 @@
+#ifndef GOERTZEL_H
+#define GOERTZEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Fractional bits of the resonator coefficient 2 * cos(w), which lies between -2 and 2
+#define GOERTZEL_COEFFICIENT_SHIFT 29
+
+// The DC tracker follows the input with a time constant of 2^GOERTZEL_DC_SHIFT samples (23 ms at 44.1 kHz)
+#define GOERTZEL_DC_SHIFT 10
+
+// Fractional bits of the DC tracker's level, in raw ADC codes
+#define GOERTZEL_DC_FRACTION_BITS 8
+
+/*! \brief A Goertzel resonator that measures the power at one frequency over windowed blocks of samples.
+ *
+ * The resonator runs `s[n] = w[n] x[n] + 2 cos(w) s[n-1] - s[n-2]` on every sample, where
+ * `w[n]` is a window stretched over the block. At the end of each block of `block_length`
+ * samples the power of the windowed DFT term is added to `power_sum` and the resonator
+ * restarts. Block powers are in (raw ADC codes)^2.
+ */
+struct GoertzelBand {
+    int32_t coefficient;   /*!< 2 * cos(w), with GOERTZEL_COEFFICIENT_SHIFT fractional bits */
+    uint32_t block_length; /*!< Samples per block */
+    uint32_t position;     /*!< Samples of the current block seen so far */
+    uint32_t window_step;  /*!< Window table entries per sample, with 16 fractional bits */
+    uint32_t window_phase; /*!< Position in the window table, with 16 fractional bits */
+    int32_t s1, s2;        /*!< Resonator state: the last two outputs */
+    uint64_t power_sum;    /*!< Sum of the powers of the blocks completed since the last take */
+    uint32_t blocks;       /*!< Number of blocks in `power_sum` */
+};
+
+/*! \brief Set up a resonator.
+ *
+ * \param band The resonator.
+ * \param cycles_per_sample Frequency to measure, as a fraction of the sample rate (0 to 0.5).
+ * \param block_length Samples per block, at most `window_length`. With a Hann window the response
+ *        falls to nothing two cycles per block either side of the frequency; the state stays within
+ *        32 bits for blocks of up to 2048 samples of 12-bit input.
+ * \param window_length Length of the window table passed to `goertzel_process`.
+ */
+void goertzel_init(GoertzelBand *band, double cycles_per_sample, uint32_t block_length, uint32_t window_length);
+
+/*! \brief Restart the resonator and forget the completed blocks. */
+void goertzel_reset(GoertzelBand *band);
+
+/*! \brief Run the resonator over DC-free samples.
+ *
+ * \param band The resonator.
+ * \param samples Samples in raw ADC codes with the DC removed (see `goertzel_remove_dc`).
+ * \param length Number of samples.
+ * \param window Q15 window table of the length given to `goertzel_init`, stretched over each block.
+ */
+void goertzel_process(GoertzelBand *band, const int16_t *samples, size_t length, const int16_t *window);
+
+/*! \brief Take the mean power of the blocks completed since the last call.
+ *
+ * \param band The resonator.
+ * \param power Output: the mean block power, in (raw ADC codes)^2. Unchanged if no block completed.
+ * \return false if no block has completed since the last call.
+ */
+bool goertzel_take_power(GoertzelBand *band, uint64_t *power);
+
+/*! \brief Remove DC from raw ADC samples with a first order high-pass filter.
+ *
+ * The DC level is tracked sample by sample, so unlike a per-frame mean it never steps.
+ *
+ * \param dc The tracked DC level in raw ADC codes, with GOERTZEL_DC_FRACTION_BITS fractional bits.
+ * \param raw Raw 12-bit ADC samples.
+ * \param out DC-free samples in raw ADC codes.
+ * \param length Number of samples.
+ */
+void goertzel_remove_dc(int32_t *dc, const uint16_t *raw, int16_t *out, size_t length);
+
+#endif // GOERTZEL_H
@@ -0,0 +1,196 @@
+#ifndef GOERTZEL_ANALYZER_H
+#define GOERTZEL_ANALYZER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include "drivers/microphone.h"
+#include "dsp/goertzel.h"
+#include "dsp/pre_fft.h"
+#include "dsp/band_energy.h"
+#include "dsp/window.h"
+#include "utils/trace.h"
+
+/*! \brief Smallest Goertzel block, which limits how wide (and how fast) the top bands can be. */
+#define GOERTZEL_MIN_BLOCK_LENGTH 4
+
+/*! \brief Streaming band analyzer with one Goertzel resonator per band, as a low-latency
+ * alternative to `SpectrumAnalyzer`.
+ *
+ * Audio arrives one hop at a time, exactly as for `SpectrumAnalyzer`, and the two classes
+ * can be swapped for one another. Instead of transforming a whole frame, each band runs a
+ * resonator tuned to its centre over Hann windowed blocks of `2 * FFT_N / band width in bins`
+ * samples (at most `FFT_N`), so that the window's response falls to nothing about one band
+ * width either side of the centre (and is 6 dB down at the band edges). Narrow low bands
+ * therefore still need long blocks, but the wide high bands respond within a fraction of a
+ * millisecond, and a new set of band energies is available after every hop rather than after
+ * a full FFT frame has been collected. The work is spread evenly over the samples and there
+ * is no transform step.
+ *
+ * Energies are reported in the same units as `SpectrumAnalyzer` (see band_energy.h), so the
+ * same thresholds apply: the power `|X|^2` of a block of `N` raw samples is scaled by
+ * `G / N^2`, where `G = 2^(2 * PRE_FFT_GAIN_SHIFT) * 3/2` makes a tone at the band centre give
+ * the same energy as from the FFT path (noise across a band comes out about 1.3 dB lower).
+ * Each band's energy is the mean of the blocks it completed during the latest hop, or its
+ * previous energy if its block is longer than a hop.
+ *
+ * \tparam FFT_N Frequency resolution the band edges are expressed in (bins of `FFT_N` samples).
+ * \tparam HOP Samples between successive outputs.
+ * \tparam NUM_BANDS Number of output bands.
+ * \tparam CAPTURE_BUFFERS Number of hop-sized DMA capture buffers (at least 2).
+ */
+template <size_t FFT_N, size_t HOP, size_t NUM_BANDS, size_t CAPTURE_BUFFERS = 4>
+class GoertzelAnalyzer
+{
+public:
+    static_assert(FFT_N >= 2 * GOERTZEL_MIN_BLOCK_LENGTH && FFT_N <= 2048,
+                  "Band edges must be in bins of 8 to 2048 samples");
+    static_assert(HOP > 0 && HOP % 2 == 0, "Hop must be even so that capture buffers stay word aligned");
+    static_assert(CAPTURE_BUFFERS >= 2, "Streaming needs at least two capture buffers");
+
+    using BandEdges = std::array<uint16_t, NUM_BANDS + 1>;
+    using BandEnergy = std::array<uint64_t, NUM_BANDS>;
+
+    static constexpr size_t fft_size = FFT_N;
+    static constexpr size_t hop_size = HOP;
+    static constexpr size_t num_bands = NUM_BANDS;
+
+    /*! \brief Scale from block power to band energy units, times the block length squared. */
+    static constexpr uint64_t energy_gain = (1ull << (2 * PRE_FFT_GAIN_SHIFT)) * 3 / 2;
+
+    /*! \brief Create an analyzer for the given band layout.
+     *
+     * \param band_edges Bin edges for each band, e.g. from `make_log_band_edges<NUM_BANDS>(FFT_N, ...)`.
+     * \param initial_dc DC estimate used at the start, in raw ADC codes.
+     */
+    GoertzelAnalyzer(const BandEdges &band_edges, int32_t initial_dc)
+        : edges(band_edges), initial_dc(initial_dc), frames(0)
+    {
+        for (size_t band = 0; band < NUM_BANDS; ++band) {
+            uint32_t width = edges[band + 1] - edges[band];
+            uint32_t length = (2 * FFT_N + width / 2) / width;
+            if (length < GOERTZEL_MIN_BLOCK_LENGTH) {
+                length = GOERTZEL_MIN_BLOCK_LENGTH;
+            } else if (length > FFT_N) {
+                length = FFT_N;
+            }
+            double centre = (edges[band] + edges[band + 1]) / 2.0;
+            goertzel_init(&bands[band], centre / FFT_N, length, FFT_N);
+        }
+        reset();
+    }
+
+    /*! \brief Forget all history, e.g. before (re)starting capture. */
+    void reset()
+    {
+        dc = initial_dc << GOERTZEL_DC_FRACTION_BITS;
+        for (GoertzelBand &band : bands) {
+            goertzel_reset(&band);
+        }
+        started = 0;
+        energy.fill(0);
+    }
+
+    /*! \brief Start streaming the microphone into this analyzer's capture buffers.
+     *
+     * \param mic An initialised microphone.
+     * \return false if streaming could not be started.
+     */
+    bool start_capture(microphone &mic)
+    {
+        reset();
+        return mic.start_streaming(capture_buffers, HOP, CAPTURE_BUFFERS);
+    }
+
+    /*! \brief Wait for the next hop from the microphone and analyse it.
+     *
+     * \param mic The microphone passed to `start_capture`.
+     * \return true if new band energies are available (false until every band has completed a block).
+     */
+    bool analyse_next_hop(microphone &mic)
+    {
+        const uint16_t *samples = mic.acquire_buffer();
+        if (samples == nullptr) {
+            return false;
+        }
+        bool analysed = analyse_hop(samples);
+        mic.release_buffer();
+        return analysed;
+    }
+
+    /*! \brief Analyse every hop the microphone has captured so far, without waiting.
+     *
+     * \param mic The microphone passed to `start_capture`.
+     * \return true if at least one new set of band energies is available.
+     */
+    bool try_analyse_next_hops(microphone &mic)
+    {
+        bool analysed = false;
+        const uint16_t *samples;
+        while ((samples = mic.try_acquire_buffer()) != nullptr) {
+            analysed |= analyse_hop(samples);
+            mic.release_buffer();
+        }
+        return analysed;
+    }
+
+    /*! \brief Run one hop of raw ADC samples through every band's resonator.
+     *
+     * \param samples `HOP` raw 12-bit ADC samples.
+     * \return true if new band energies are available (false until every band has completed a block).
+     */
+    bool analyse_hop(const uint16_t *samples)
+    {
+        {
+            TRACE_SPAN("mic dc");
+            goertzel_remove_dc(&dc, samples, conditioned, HOP);
+        }
+        {
+            TRACE_SPAN("mic goertzel");
+            for (size_t band = 0; band < NUM_BANDS; ++band) {
+                goertzel_process(&bands[band], conditioned, HOP, window.data());
+                uint64_t power;
+                if (goertzel_take_power(&bands[band], &power)) {
+                    uint64_t length = bands[band].block_length;
+                    energy[band] = power * energy_gain / (length * length);
+                    started |= 1u << band;
+                }
+            }
+        }
+        if (started != (1u << NUM_BANDS) - 1) {
+            return false;
+        }
+        frames++;
+        return true;
+    }
+
+    /*! \brief Energy in each band from the latest hop (see band_energy.h for the units). */
+    const BandEnergy &band_energy() const { return energy; }
+
+    /*! \brief Bin edges of the bands. */
+    const BandEdges &band_edges() const { return edges; }
+
+    /*! \brief Samples per block of each band's resonator. */
+    uint32_t block_length(size_t band) const { return bands[band].block_length; }
+
+    /*! \brief Number of hops that produced band energies since construction. */
+    uint32_t frame_count() const { return frames; }
+
+    /*! \brief Hann window stretched over each band's blocks, generated at compile time. */
+    alignas(4) static constexpr std::array<int16_t, FFT_N> window = make_hann_window_q15<FFT_N>();
+
+private:
+    static_assert(NUM_BANDS < 32, "The bands that have started are tracked in a 32-bit mask");
+
+    BandEdges edges;                         /*!< Bin edges of each band */
+    int32_t initial_dc;                      /*!< DC estimate at the start */
+    uint32_t frames;                         /*!< Hops that produced band energies */
+    uint32_t started;                        /*!< Bands that have completed at least one block */
+    int32_t dc;                              /*!< Tracked DC level (see goertzel_remove_dc) */
+    alignas(4) uint16_t capture_buffers[CAPTURE_BUFFERS * HOP]; /*!< DMA capture buffers, one hop each */
+    std::array<GoertzelBand, NUM_BANDS> bands; /*!< One resonator per band */
+    int16_t conditioned[HOP];                /*!< The latest hop with DC removed */
+    BandEnergy energy;                       /*!< Energy in each band */
+};
+
+#endif // GOERTZEL_ANALYZER_H
@@ -0,0 +1,78 @@
+#include "pre_fft.h"
+#include <string.h>
+
+// Let the compiler know a pointer is word aligned, so that 32-bit copies become single loads/stores
+#if defined(__GNUC__)
+    #define ASSUME_WORD_ALIGNED(p) __builtin_assume_aligned((p), 4)
+#else
+    #define ASSUME_WORD_ALIGNED(p) (p)
+#endif
+
+// Saturate to the Q15 range
+static inline int32_t saturate_q15(int32_t value)
+{
+    if (value > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (value < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return value;
+}
+
+// Remove DC, amplify, and window one sample (Q15 multiply as done by arm_mult_q15)
+static inline int16_t condition_sample(int32_t sample, int32_t dc, int16_t coefficient)
+{
+    int32_t amplified = saturate_q15((sample - dc) * (1 << PRE_FFT_GAIN_SHIFT));
+    return (int16_t)saturate_q15((amplified * coefficient) >> 15);
+}
+
+static inline bool is_word_aligned(const void *p)
+{
+    return ((uintptr_t)p & 3) == 0;
+}
+
+void pre_fft_init(PreFftState *state, int32_t initial_dc, uint8_t dc_smoothing_shift)
+{
+    state->dc = initial_dc;
+    state->dc_smoothing_shift = dc_smoothing_shift;
+}
+
+void pre_fft_process(PreFftState *state, const uint16_t *raw, const int16_t *window, int16_t *out, size_t length)
+{
+    if (length == 0) {
+        return;
+    }
+
+    const int32_t dc = state->dc;
+    uint32_t sum = 0;
+    size_t i = 0;
+
+    if (is_word_aligned(raw) && is_word_aligned(window) && is_word_aligned(out)) {
+        // Two samples per iteration: one load of raw data, one load of coefficients, one store
+        for (; i + 1 < length; i += 2) {
+            uint32_t samples, coefficients;
+            memcpy(&samples, ASSUME_WORD_ALIGNED(raw + i), sizeof(samples));
+            memcpy(&coefficients, ASSUME_WORD_ALIGNED(window + i), sizeof(coefficients));
+
+            uint32_t low = samples & 0xFFFF;
+            uint32_t high = samples >> 16;
+            sum += low + high;
+
+            uint16_t out_low = (uint16_t)condition_sample((int32_t)low, dc, (int16_t)(coefficients & 0xFFFF));
+            uint16_t out_high = (uint16_t)condition_sample((int32_t)high, dc, (int16_t)(coefficients >> 16));
+            uint32_t packed = out_low | ((uint32_t)out_high << 16);
+            memcpy(ASSUME_WORD_ALIGNED(out + i), &packed, sizeof(packed));
+        }
+    }
+
+    // Unaligned buffers, or the last sample of an odd-length frame
+    for (; i < length; ++i) {
+        sum += raw[i];
+        out[i] = condition_sample(raw[i], dc, window[i]);
+    }
+
+    // Track the DC level for the next frame
+    int32_t mean = (int32_t)(sum / length);
+    state->dc = dc + ((mean - dc) >> state->dc_smoothing_shift);
+}
@@ -0,0 +1,42 @@
+#ifndef PRE_FFT_H
+#define PRE_FFT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Left shift applied to the DC-free 12-bit ADC samples to amplify them into the Q15 range
+#define PRE_FFT_GAIN_SHIFT 5
+
+/*! \brief State carried between frames by the pre-FFT kernel. */
+struct PreFftState {
+    int32_t dc;                 /*!< Running DC estimate, in raw ADC codes */
+    uint8_t dc_smoothing_shift; /*!< 0: use the previous frame's mean; n: move 1/2^n of the way towards it */
+};
+
+/*! \brief Reset the pre-FFT state.
+ *
+ * \param state The state to initialise.
+ * \param initial_dc DC estimate for the first frame (normally the ADC mid-point).
+ * \param dc_smoothing_shift How slowly the DC estimate follows the frame means (0 = no smoothing).
+ */
+void pre_fft_init(PreFftState *state, int32_t initial_dc, uint8_t dc_smoothing_shift);
+
+/*! \brief Convert raw ADC samples into a windowed Q15 frame in a single pass.
+ *
+ * Each sample is read once: the running DC estimate is subtracted, the result is amplified by
+ * PRE_FFT_GAIN_SHIFT with saturation, and multiplied by the window with the same rounding and
+ * saturation as `arm_mult_q15`. The frame mean is accumulated in the same pass and used to
+ * update the DC estimate for the next frame.
+ *
+ * Samples are processed in pairs with 32-bit loads and stores when `raw`, `window` and `out`
+ * are all 4-byte aligned, which halves the memory accesses on the Cortex-M0+.
+ *
+ * \param state DC tracking state, updated with this frame's mean.
+ * \param raw Raw 12-bit ADC samples.
+ * \param window Q15 window coefficients.
+ * \param out The windowed Q15 frame.
+ * \param length Number of samples.
+ */
+void pre_fft_process(PreFftState *state, const uint16_t *raw, const int16_t *window, int16_t *out, size_t length);
+
+#endif // PRE_FFT_H
@@ -0,0 +1,56 @@
+#ifndef SLIDING_WINDOW_H
+#define SLIDING_WINDOW_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*! \brief Keeps the most recent `WINDOW_SIZE` samples of a stream for overlapped (STFT) analysis.
+ *
+ * Samples are appended in blocks of any size (typically one hop, i.e. one capture buffer).
+ * The ring is stored twice over, so the latest window is always available as one contiguous
+ * array without copying: each new sample costs two stores instead of shifting the whole
+ * window along by one hop.
+ *
+ * \tparam WINDOW_SIZE The number of samples in each analysis frame.
+ */
+template <size_t WINDOW_SIZE>
+class SlidingWindow
+{
+public:
+    SlidingWindow() : head(0), filled(0) {}
+
+    /*! \brief Append samples to the stream, discarding the oldest ones.
+     *
+     * \param samples The new samples, oldest first.
+     * \param count The number of samples.
+     */
+    void push(const uint16_t *samples, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            ring[head] = samples[i];
+            ring[head + WINDOW_SIZE] = samples[i];
+            head = (head + 1 == WINDOW_SIZE) ? 0 : head + 1;
+        }
+        filled = (filled + count > WINDOW_SIZE) ? WINDOW_SIZE : filled + count;
+    }
+
+    /*! \brief True once at least `WINDOW_SIZE` samples have been pushed. */
+    bool full() const { return filled == WINDOW_SIZE; }
+
+    /*! \brief The latest `WINDOW_SIZE` samples, oldest first. Valid until the next push. */
+    const uint16_t *frame() const { return &ring[head]; }
+
+    /*! \brief Forget all samples, e.g. after a gap in the input. */
+    void reset()
+    {
+        head = 0;
+        filled = 0;
+    }
+
+private:
+    alignas(4) uint16_t ring[2 * WINDOW_SIZE]; /*!< Samples, stored twice so any window is contiguous */
+    size_t head;                    /*!< Index of the oldest sample (and the next one to replace) */
+    size_t filled;                  /*!< Number of valid samples, up to WINDOW_SIZE */
+};
+
+#endif // SLIDING_WINDOW_H
@@ -0,0 +1,177 @@
+#ifndef SPECTRUM_ANALYZER_H
+#define SPECTRUM_ANALYZER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include "arm_math.h"
+#include "drivers/microphone.h"
+#include "dsp/sliding_window.h"
+#include "dsp/pre_fft.h"
+#include "dsp/band_energy.h"
+#include "dsp/window.h"
+#include "utils/trace.h"
+
+/*! \brief Streaming audio spectrum analyzer: capture, window, FFT and band energy stages.
+ *
+ * Audio arrives one hop at a time (normally straight from the microphone's DMA capture
+ * buffers). Every hop is appended to a sliding window of the latest `FFT_N` samples, which
+ * is DC-corrected and Hann windowed in one pass, transformed with `arm_rfft_q15`, and
+ * reduced to one energy value per band.
+ *
+ * All sizes are compile-time constants, so the window table is generated by the compiler
+ * and only the tables for the chosen FFT length end up in flash. The FFT length must match
+ * the CMSIS-DSP tables enabled in CMakeLists.txt (the FFT_SIZE cache variable).
+ *
+ * The analyzer holds several kilobytes of buffers, so instances should be static.
+ *
+ * \tparam FFT_N FFT length: 256, 512, 1024 or 2048 samples.
+ * \tparam HOP Samples between successive frames (FFT_N / 4 gives 75% overlap).
+ * \tparam NUM_BANDS Number of output bands.
+ * \tparam CAPTURE_BUFFERS Number of hop-sized DMA capture buffers (at least 2).
+ */
+template <size_t FFT_N, size_t HOP, size_t NUM_BANDS, size_t CAPTURE_BUFFERS = 4>
+class SpectrumAnalyzer
+{
+public:
+    static_assert(FFT_N == 256 || FFT_N == 512 || FFT_N == 1024 || FFT_N == 2048,
+                  "FFT length must be 256, 512, 1024 or 2048");
+    static_assert(HOP > 0 && HOP <= FFT_N, "Hop must be between 1 sample and one frame");
+    static_assert(HOP % 2 == 0, "Hop must be even so that frames stay word aligned");
+    static_assert(CAPTURE_BUFFERS >= 2, "Streaming needs at least two capture buffers");
+
+    using BandEdges = std::array<uint16_t, NUM_BANDS + 1>;
+    using BandEnergy = std::array<uint64_t, NUM_BANDS>;
+
+    static constexpr size_t fft_size = FFT_N;
+    static constexpr size_t hop_size = HOP;
+    static constexpr size_t num_bands = NUM_BANDS;
+
+    /*! \brief Create an analyzer for the given band layout.
+     *
+     * \param band_edges Bin edges for each band, e.g. from `make_log_band_edges<NUM_BANDS>(FFT_N, ...)`.
+     * \param initial_dc DC estimate used for the first frame, in raw ADC codes.
+     */
+    SpectrumAnalyzer(const BandEdges &band_edges, int32_t initial_dc)
+        : edges(band_edges), initial_dc(initial_dc), frames(0)
+    {
+        reset();
+    }
+
+    /*! \brief Forget all history, e.g. before (re)starting capture. */
+    void reset()
+    {
+        history.reset();
+        pre_fft_init(&pre_fft, initial_dc, 0);
+        arm_rfft_init_q15(&fft, FFT_N, 0, 1);
+        energy.fill(0);
+    }
+
+    /*! \brief Start streaming the microphone into this analyzer's capture buffers.
+     *
+     * \param mic An initialised microphone.
+     * \return false if streaming could not be started.
+     */
+    bool start_capture(microphone &mic)
+    {
+        reset();
+        return mic.start_streaming(capture_buffers, HOP, CAPTURE_BUFFERS);
+    }
+
+    /*! \brief Wait for the next hop from the microphone and analyse it.
+     *
+     * \param mic The microphone passed to `start_capture`.
+     * \return true if a new frame was analysed (false until the first full frame has been captured).
+     */
+    bool analyse_next_hop(microphone &mic)
+    {
+        const uint16_t *samples = mic.acquire_buffer();
+        if (samples == nullptr) {
+            return false;
+        }
+        bool analysed = analyse_hop(samples);
+        mic.release_buffer();
+        return analysed;
+    }
+
+    /*! \brief Analyse every hop the microphone has captured so far, without waiting.
+     *
+     * \param mic The microphone passed to `start_capture`.
+     * \return true if at least one new frame was analysed.
+     */
+    bool try_analyse_next_hops(microphone &mic)
+    {
+        bool analysed = false;
+        const uint16_t *samples;
+        while ((samples = mic.try_acquire_buffer()) != nullptr) {
+            analysed |= analyse_hop(samples);
+            mic.release_buffer();
+        }
+        return analysed;
+    }
+
+    /*! \brief Append one hop of raw ADC samples and analyse the resulting frame.
+     *
+     * \param samples `HOP` raw 12-bit ADC samples.
+     * \return true if a new frame was analysed (false until the first full frame has been captured).
+     */
+    bool analyse_hop(const uint16_t *samples)
+    {
+        {
+            TRACE_SPAN("mic hop");
+            history.push(samples, HOP);
+        }
+        if (!history.full()) {
+            return false;
+        }
+
+        // Remove DC, amplify and window in a single pass
+        {
+            TRACE_SPAN("mic dc+window");
+            pre_fft_process(&pre_fft, history.frame(), window.data(), windowed, FFT_N);
+        }
+
+        // Transform (this overwrites `windowed`, which is only scratch from here on)
+        {
+            TRACE_SPAN("mic fft");
+            arm_rfft_q15(&fft, windowed, spectrum_buffer);
+        }
+
+        // Reduce to band energies
+        {
+            TRACE_SPAN("mic bands");
+            band_energy_q15(spectrum_buffer, edges.data(), NUM_BANDS, energy.data());
+        }
+        frames++;
+        return true;
+    }
+
+    /*! \brief Energy in each band from the latest frame (see band_energy.h for the units). */
+    const BandEnergy &band_energy() const { return energy; }
+
+    /*! \brief Interleaved complex spectrum of the latest frame (`FFT_N / 2` bins used). */
+    const q15_t *spectrum() const { return spectrum_buffer; }
+
+    /*! \brief Bin edges of the bands. */
+    const BandEdges &band_edges() const { return edges; }
+
+    /*! \brief Number of frames analysed since construction. */
+    uint32_t frame_count() const { return frames; }
+
+    /*! \brief Hann window coefficients, generated at compile time (word aligned for the fast pre-FFT path). */
+    alignas(4) static constexpr std::array<int16_t, FFT_N> window = make_hann_window_q15<FFT_N>();
+
+private:
+    BandEdges edges;                         /*!< Bin edges of each band */
+    int32_t initial_dc;                      /*!< DC estimate for the first frame */
+    uint32_t frames;                         /*!< Frames analysed */
+    alignas(4) uint16_t capture_buffers[CAPTURE_BUFFERS * HOP]; /*!< DMA capture buffers, one hop each */
+    SlidingWindow<FFT_N> history;            /*!< The latest FFT_N samples */
+    PreFftState pre_fft;                     /*!< Running DC estimate */
+    arm_rfft_instance_q15 fft;               /*!< CMSIS-DSP real FFT instance */
+    alignas(4) q15_t windowed[FFT_N];        /*!< Windowed frame (FFT input and scratch) */
+    q15_t spectrum_buffer[2 * FFT_N];        /*!< FFT output */
+    BandEnergy energy;                       /*!< Energy in each band */
+};
+
+#endif // SPECTRUM_ANALYZER_H
@@ -0,0 +1,57 @@
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+
+#define CONSTEXPR_PI 3.14159265358979323846
+
+/*! \brief Cosine for use in constant expressions (Taylor series after range reduction). */
+constexpr double constexpr_cos(double x)
+{
+    // Reduce to [-pi, pi]
+    const double two_pi = 2.0 * CONSTEXPR_PI;
+    long turns = (long)(x / two_pi);
+    x -= (double)turns * two_pi;
+    if (x > CONSTEXPR_PI) {
+        x -= two_pi;
+    } else if (x < -CONSTEXPR_PI) {
+        x += two_pi;
+    }
+
+    // Sum the series until the terms no longer change the result
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 40; ++n) {
+        term *= -x * x / ((2.0 * n - 1.0) * (2.0 * n));
+        double next = sum + term;
+        if (next == sum) {
+            break;
+        }
+        sum = next;
+    }
+    return sum;
+}
+
+/*! \brief Generate a symmetric Hann window in Q15 format at compile time.
+ *
+ * Coefficient i is 0.5 * (1 - cos(2 * pi * i / (N - 1))), rounded to Q15 and limited to
+ * 32767. This reproduces the table previously generated with MATLAB `hann(N)` exactly.
+ *
+ * \tparam N Window length in samples.
+ */
+template <size_t N>
+constexpr std::array<int16_t, N> make_hann_window_q15()
+{
+    static_assert(N >= 2, "A window needs at least two samples");
+    std::array<int16_t, N> window {};
+    for (size_t i = 0; i < N; ++i) {
+        double value = 0.5 * (1.0 - constexpr_cos(2.0 * CONSTEXPR_PI * (double)i / (double)(N - 1)));
+        long q15 = (long)(value * 32768.0 + 0.5);
+        window[i] = (int16_t)(q15 > 32767 ? 32767 : q15);
+    }
+    return window;
+}
+
+#endif // WINDOW_H
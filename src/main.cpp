@@ -13,23 +13,50 @@
 #include "drivers/lis3dh.h"     
 #include "drivers/accelerometer.h"     
 #include "drivers/microphone.h"        
+#include "drivers/logging/logging.h"
 
 #include "tasks/led_task.h"             // TASK HEADERS
 #include "tasks/accelerometer_task.h" 
 #include "tasks/microphone_task.h" 
 #include "tasks/bluetooth_task.h"
 #include "tasks/task_manager.h"  
+#include "tasks/scheduler.h"
+#include "utils/trace.h"
 
 #include "board.h" // Include board-specific configurations
 
 // Global variable to track the current task
 volatile Tasks current_task = LED_TASK;
 
+// The LED strip, shared by all tasks
+LEDs led_strip(LED_PIN, NUM_LEDS, pio0, 0);  // PIO0 and State Machine 0
+
+// Runs every task's step function on its own period
+static Scheduler scheduler;
+
 // Function to handle button presses (interrupt handler)
 void button_callback(uint gpio, uint32_t events) {
     // Change task when button is pressed
     current_task = (Tasks)((current_task + 1) % NUM_TASKS);  // Increment the task and wrap around
-    printf("Button pressed, switching to task %d\n", current_task);
+    LOG_INFO("Button pressed, switching to task %d", current_task);
+}
+
+// Print logged messages while the scheduler has nothing to run, one at a time so that the next deadline is kept
+static void flush_log(uint64_t next_deadline_us) {
+    while (time_us_64() < next_deadline_us && logFlush(1) > 0) {
+    }
+}
+
+// Periodically report how well the tasks are keeping to their deadlines
+static void print_scheduler_stats(void *context) {
+    scheduler.print_stats();
+    microphone_task_print_stats();
+    printf("LED frames sent: %u, skipped: %u\n", (unsigned)led_strip.framesSent(), (unsigned)led_strip.framesSkipped());
+    trace_print_stats();
+#ifdef TEST_HARNESS
+    mock_i2c_print_stats();     // Simulated I2C bus utilisation and LIS3DH sensor-path latency
+    mock_ws2812_print_stats();  // Latched LED frames as the mock WS2812 strip saw them
+#endif
 }
 
 int main() {
@@ -40,30 +67,20 @@ int main() {
     gpio_set_dir(BUTTON_PIN, GPIO_IN);                    // Set button pin as input
     gpio_set_irq_enabled_with_callback(BUTTON_PIN, GPIO_IRQ_EDGE_FALL, true, &button_callback);  // Interrupt on falling edge (button press)
 
-    // Main loop
-    while (true) {
-        switch (current_task) {
-            case LED_TASK:
-                run_led_task();  // Call the modularized LED task function
-                break;
-
-            case ACCELEROMETER_TASK: {
-                run_accelerometer_task();
-                break;
-            }
-
-            case MICROPHONE_TASK: {
-                run_microphone_task();  
-                break;
-            }
-
-            case BLUETOOTH_TASK:
-                run_bluetooth_task(); 
-                break;
-
-            default:
-                break;
-        }
+    // Initialise the tasks. A task whose hardware fails to initialise is left out; the others still run.
+    scheduler.add_task("led", LED_TASK_PERIOD_US, led_task_step);
+    if (accelerometer_task_init()) {
+        scheduler.add_task("accelerometer", ACCELEROMETER_TASK_PERIOD_US, accelerometer_task_step);
+    }
+    if (microphone_task_init()) {
+        scheduler.add_task("microphone", MICROPHONE_TASK_PERIOD_US, microphone_task_step);
     }
+    bluetooth_task_init();
+    scheduler.add_task("bluetooth", BLUETOOTH_TASK_PERIOD_US, bluetooth_task_step);
+    scheduler.add_task("stats", SCHEDULER_STATS_PERIOD_US, print_scheduler_stats);
+
+    // Main loop: run each task's step on its deadlines, print the log in the spare time, and sleep in between
+    scheduler.set_idle_function(flush_log);
+    scheduler.run();
     return 0;
 }
\ No newline at end of file
@@ -2,69 +2,153 @@
 #include <stdio.h>
 #include <stdint.h>
 #include "pico/stdlib.h"
+#include "pico/time.h"
 #include "accelerometer_task.h"
 #include "hardware/gpio.h"
 #include "drivers/leds.h"
 #include "drivers/lis3dh.h"
+#include "drivers/logging/logging.h"
+#include "utils/spsc_ring.h"
+#include "utils/trace.h"
 #include "task_manager.h"
 #include "board.h"
 
-void run_accelerometer_task() {
-    // Initialize PIO and state machine for controlling LEDs
-    LEDs ledStrip(LED_PIN, NUM_LEDS, pio0, 0);
+// The LIS3DH accelerometer, shared with the Bluetooth task through accelerometer_task_latest()
+static LIS3DH lis3dh(I2C_PORT, LIS3DH_I2C_ADDRESS, I2C_SDA_PIN, I2C_SCL_PIN);
 
-    // Create an instance of the LIS3DH accelerometer class
-    LIS3DH lis3dh(I2C_PORT, LIS3DH_I2C_ADDRESS, I2C_SDA_PIN, I2C_SCL_PIN);
-    if (!lis3dh.init()) {
+// Latest reading
+static LIS3DHAcceleration latest;
+static bool have_reading = false;
+
+// Every sample, queued for the Bluetooth task to stream
+static SpscRing<LIS3DHAcceleration, ACCELEROMETER_STREAM_QUEUE_LENGTH> stream_queue;
+static uint64_t newest_sample_us = 0;   // When the newest queued sample was collected
+static uint32_t samples_dropped = 0;    // Samples the stream queue had no room for
+
+bool accelerometer_task_init() {
+    // Tilt changes slowly, so a low data rate is enough and keeps the FIFO reads short
+    LIS3DHConfig config;
+    config.data_rate = LIS3DH_DATA_RATE;
+    config.range = LIS3DH_RANGE;
+    config.mode = LIS3DH_MODE;
+    if (!lis3dh.init(I2C_BAUDRATE, config)) {
         printf("LIS3DH initialization failed!\n");
-        return;  // Exit the function if initialization failed
+        return false;
+    }
+    // Let the sensor buffer samples between steps, so each step collects them all in one burst
+    if (!lis3dh.enable_fifo_stream(LIS3DH_FIFO_WATERMARK)) {
+        printf("LIS3DH FIFO could not be enabled!\n");
+        return false;
     }
     printf("LIS3DH initialized.\n");
+    return true;
+}
 
-    float x_g, y_g, z_g;
+bool accelerometer_task_latest(LIS3DHAcceleration* acceleration) {
+    if (!have_reading) {
+        return false;
+    }
+    *acceleration = latest;
+    return true;
+}
 
-    // Loop for the accelerometer task
-    while (true) {
-        // Read acceleration data
-        if (!lis3dh.read_acceleration_g(&x_g, &y_g, &z_g)) {
-            printf("Failed to read acceleration data\n");
-            continue;
-        }
+int accelerometer_task_take_samples(LIS3DHAcceleration* samples, int max_samples, uint64_t* newest_us) {
+    int count = 0;
+    while (count < max_samples && stream_queue.pop(samples[count])) {
+        count++;
+    }
+    // The samples still queued are newer than the ones taken
+    *newest_us = newest_sample_us - (uint64_t)stream_queue.size() * accelerometer_task_sample_interval_us();
+    return count;
+}
 
-        // Print the acceleration values to the terminal
-        printf("X: %.3f g, Y: %.3f g, Z: %.3f g\n", x_g, y_g, z_g);
+uint32_t accelerometer_task_sample_interval_us() {
+    uint32_t rate = lis3dh.data_rate_hz();
+    return rate == 0 ? 0 : 1000000 / rate;
+}
 
-        // Map the X, Y, and Z axis tilt to LED positions
-        int led_x = (int)((x_g + 1) * 2);  // Map x from -1g to 1g onto LEDs 0-3
-        int led_y = 4 + (int)((y_g + 1) * 2);  // Map y from -1g to 1g onto LEDs 4-7
-        int led_z = 8 + (int)((z_g + 1) * 2);  // Map z from -1g to 1g onto LEDs 8-11
+uint32_t accelerometer_task_samples_dropped() {
+    return samples_dropped;
+}
 
-        // Ensure the indices are within bounds
-        led_x = led_x < 0 ? 0 : (led_x >= 4 ? 3 : led_x);
-        led_y = led_y < 4 ? 4 : (led_y >= 8 ? 7 : led_y);
-        led_z = led_z < 8 ? 8 : (led_z >= 12 ? 11 : led_z);
+void accelerometer_show_tilt(LEDs& ledStrip, const LIS3DHAcceleration& acceleration) {
+    // Map the X, Y, and Z axis tilt to LED positions (integer division truncates like the float casts did)
+    int led_x = (acceleration.x_mg + 1000) * 2 / 1000;  // Map x from -1g to 1g onto LEDs 0-3
+    int led_y = 4 + (acceleration.y_mg + 1000) * 2 / 1000;  // Map y from -1g to 1g onto LEDs 4-7
+    int led_z = 8 + (acceleration.z_mg + 1000) * 2 / 1000;  // Map z from -1g to 1g onto LEDs 8-11
 
-        printf("Mapped LED positions: led_x = %d, led_y = %d, led_z = %d\n", led_x, led_y, led_z);
+    // Ensure the indices are within bounds
+    led_x = led_x < 0 ? 0 : (led_x >= 4 ? 3 : led_x);
+    led_y = led_y < 4 ? 4 : (led_y >= 8 ? 7 : led_y);
+    led_z = led_z < 8 ? 8 : (led_z >= 12 ? 11 : led_z);
 
-        // Clear the LED strip
-        ledStrip.clear();
-        sleep_ms(1);
+    // Start a new frame with all LEDs off
+    ledStrip.clear();
 
-        // Set the appropriate LEDs to indicate tilt for each axis
-        ledStrip.setColor(led_x, 255, 0, 0);  // X axis tilt in red
-        ledStrip.setColor(led_y, 0, 255, 0);  // Y axis tilt in green
-        ledStrip.setColor(led_z, 0, 0, 255);  // Z axis tilt in blue
+    // Set the appropriate LEDs to indicate tilt for each axis
+    ledStrip.setColor(led_x, 255, 0, 0);  // X axis tilt in red
+    ledStrip.setColor(led_y, 0, 255, 0);  // Y axis tilt in green
+    ledStrip.setColor(led_z, 0, 0, 255);  // Z axis tilt in blue
 
-        // Update the LED strip to show the new state
-        ledStrip.update();
-        printf("LEDs updated: led_x = %d, led_y = %d, led_z = %d\n", led_x, led_y, led_z);  // Debug output
+    // Send the new state to the LED strip (skipped if nothing changed)
+    ledStrip.commit();
+}
 
-        // Add a delay after the update to ensure LEDs remain visible
-        sleep_ms(100);  // Adjust the delay as needed to give enough time for the LEDs to be visible
+void accelerometer_task_step(void* context) {
+    // Drain the samples the FIFO has collected. The read runs by DMA in the background while the other tasks use
+    // the CPU, so each step takes the batch read during the previous period and starts the next one (if the last
+    // read is still in flight, its batch is taken next step). Only fall back to a blocking read if DMA is
+    // unavailable altogether: one in the middle of an asynchronous read would deliver its samples ahead of the
+    // batch still in flight.
+    LIS3DHSample samples[LIS3DH_FIFO_DEPTH];
+    int count;
+    {
+        TRACE_SPAN("accel read");
+        if (lis3dh.async_available()) {
+            count = lis3dh.collect_fifo(samples, LIS3DH_FIFO_DEPTH);
+            lis3dh.start_fifo_read();
+        } else {
+            count = lis3dh.read_fifo(samples, LIS3DH_FIFO_DEPTH);
+        }
+    }
+    if (count < 0) {
+        LOG_WARNING("Failed to read acceleration data");
+        return;  // Try again next period
+    }
+    if (count == 0) {
+        return;  // No new samples yet
+    }
 
-        // If task was switched, break out of the loop
-        if (current_task != ACCELEROMETER_TASK) {
-            break;
+    // Convert the batch to milli-g and average it, which also smooths out vibration
+    {
+        TRACE_SPAN("accel convert");
+        LIS3DHAcceleration accelerations[LIS3DH_FIFO_DEPTH];
+        lis3dh.convert_to_mg(samples, accelerations, count);
+        for (int i = 0; i < count; ++i) {
+            if (!stream_queue.push(accelerations[i])) {
+                samples_dropped++;
+            }
         }
+        newest_sample_us = time_us_64();
+        int32_t sum_x = 0, sum_y = 0, sum_z = 0;
+        for (int i = 0; i < count; ++i) {
+            sum_x += accelerations[i].x_mg;
+            sum_y += accelerations[i].y_mg;
+            sum_z += accelerations[i].z_mg;
+        }
+        latest.x_mg = (int16_t)(sum_x / count);
+        latest.y_mg = (int16_t)(sum_y / count);
+        latest.z_mg = (int16_t)(sum_z / count);
+        have_reading = true;
+    }
+
+    // Only print and draw while this task owns the LED strip
+    if (current_task != ACCELEROMETER_TASK) {
+        return;
     }
+
+    // Print the acceleration values to the terminal
+    LOG_INFO("X: %d mg, Y: %d mg, Z: %d mg", latest.x_mg, latest.y_mg, latest.z_mg);
+
+    accelerometer_show_tilt(led_strip, latest);
 }
@@ -5,6 +5,27 @@
 #include "drivers/lis3dh.h"
 #include "drivers/leds.h"
 
-void run_accelerometer_task();
+// Initialise the accelerometer. Returns false if the LIS3DH could not be found.
+bool accelerometer_task_init();
+
+// Step function for the accelerometer task, run by the scheduler every ACCELEROMETER_TASK_PERIOD_US.
+// Reads the accelerometer and, while this task is selected, shows the tilt on the LEDs.
+void accelerometer_task_step(void* context);
+
+// Copy out the latest reading (in milli-g). Returns false if there has not been a successful reading yet.
+bool accelerometer_task_latest(LIS3DHAcceleration* acceleration);
+
+// Take up to `max_samples` of the samples queued for streaming, oldest first, and set `newest_us` to the time the
+// last one taken was collected. Returns how many were taken.
+int accelerometer_task_take_samples(LIS3DHAcceleration* samples, int max_samples, uint64_t* newest_us);
+
+// Time between samples at the accelerometer's data rate (0 if it is powered down)
+uint32_t accelerometer_task_sample_interval_us();
+
+// Samples lost because the stream queue was full
+uint32_t accelerometer_task_samples_dropped();
+
+// Light one LED per axis to show the tilt: LEDs 0-3 for X (red), 4-7 for Y (green) and 8-11 for Z (blue)
+void accelerometer_show_tilt(LEDs& ledStrip, const LIS3DHAcceleration& acceleration);
 
 #endif // ACCELEROMETER_TASK_H
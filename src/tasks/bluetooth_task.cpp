@@ -9,6 +9,10 @@
 #include "accelerometer_task.h"  // Include the accelerometer task
 #include "drivers/leds.h"
 #include "drivers/lis3dh.h"
+#include "drivers/uart_tx.h"
+#include "drivers/logging/logging.h"
+#include "utils/telemetry.h"
+#include "utils/trace.h"
 #include "task_manager.h"
 #include "board.h"
 
@@ -18,6 +22,12 @@
 #define UART_TX_PIN 8
 #define UART_RX_PIN 9
 
+// Packets of samples for the Bluetooth link
+static TelemetryEncoder telemetry;
+
+// Packets waiting to be sent, drained by DMA so the tasks never wait for the link
+static UartTx bluetooth_tx(UART_ID, BLUETOOTH_TX_BUFFER_SIZE);
+
 // Function to initialize UART for Bluetooth communication
 void init_bluetooth_uart() {
     // Initialize UART with the desired baud rate
@@ -29,68 +39,54 @@ void init_bluetooth_uart() {
 }
 
 
-// Function to run the Bluetooth task
-void run_bluetooth_task() {
+// Initialise the Bluetooth task
+void bluetooth_task_init() {
     // Initialize UART for Bluetooth communication
     init_bluetooth_uart();
+}
 
-    float x_g, y_g, z_g;
-    char buffer[100];  // Buffer to hold the formatted string for UART transmission
-
-    // Initialize PIO and state machine for controlling LEDs
-    PIO pio = pio0;    // Use PIO0
-    uint sm = 0;       // Use state machine 0
-    LEDs ledStrip(LED_PIN, NUM_LEDS, pio, sm);
-
-    // Create an instance of the LIS3DH accelerometer class
-    LIS3DH lis3dh(I2C_PORT, LIS3DH_I2C_ADDRESS, I2C_SDA_PIN, I2C_SCL_PIN);
-
-    // Loop for the Bluetooth task
-    while (true) {
-        // Read acceleration data from the accelerometer
-        if (!lis3dh.read_acceleration_g(&x_g, &y_g, &z_g)) {
-            printf("Failed to read acceleration data\n");
-            continue;
+// Step of the Bluetooth task: streams every accelerometer sample taken since the last step to the Bluetooth module,
+// as binary telemetry packets (see utils/telemetry.h)
+void bluetooth_task_step(void* context) {
+    LIS3DHAcceleration samples[TELEMETRY_MAX_RECORDS_SIZE / sizeof(LIS3DHAcceleration)];
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    uint32_t interval_us = accelerometer_task_sample_interval_us();
+    int samples_sent = 0;
+    size_t bytes_sent = 0;
+
+    // One packet per batch that fits, until the queue is empty. While the link is backed up, samples stay in the
+    // accelerometer task's queue (which drops the newest once it is full) rather than being packed and discarded.
+    {
+        TRACE_SPAN("bt pack");
+        while (bluetooth_tx.space() >= TELEMETRY_MAX_FRAME) {
+            uint64_t newest_us;
+            int count = accelerometer_task_take_samples(samples, sizeof(samples) / sizeof(samples[0]), &newest_us);
+            if (count == 0) {
+                break;
+            }
+            telemetry.begin(TELEMETRY_ACCELERATION, sizeof(LIS3DHAcceleration));
+            for (int i = 0; i < count; ++i) {
+                telemetry.add(&samples[i]);
+            }
+            size_t length = telemetry.finish((uint32_t)newest_us, interval_us, frame);
+            bluetooth_tx.write(frame, length);
+            samples_sent += count;
+            bytes_sent += length;
         }
+    }
 
-        // Format the accelerometer data as a string
-        snprintf(buffer, sizeof(buffer), "X: %.3f g, Y: %.3f g, Z: %.3f g\n", x_g, y_g, z_g);
-
-        // Send the formatted string over UART to the Bluetooth module
-        uart_puts(UART_ID, buffer);
-
-        // Print the data to the terminal for debugging purposes
-        printf("Sent over Bluetooth: %s", buffer);
-
-        // Map the accelerometer data to the LED display
-        int led_x = (int)((x_g + 1) * 2);  // Map x from -1g to 1g onto LEDs 0-3
-        int led_y = 4 + (int)((y_g + 1) * 2);  // Map y from -1g to 1g onto LEDs 4-7
-        int led_z = 8 + (int)((z_g + 1) * 2);  // Map z from -1g to 1g onto LEDs 8-11
-
-        // Ensure the indices are within bounds
-        led_x = led_x < 0 ? 0 : (led_x >= 4 ? 3 : led_x);
-        led_y = led_y < 4 ? 4 : (led_y >= 8 ? 7 : led_y);
-        led_z = led_z < 8 ? 8 : (led_z >= 12 ? 11 : led_z);
-
-        // Clear the LED strip
-        ledStrip.clear();
-        sleep_ms(1);
-
-        // Set the appropriate LEDs to indicate tilt for each axis
-        ledStrip.setColor(led_x, 255, 0, 0);  // X axis tilt in red
-        ledStrip.setColor(led_y, 0, 255, 0);  // Y axis tilt in green
-        ledStrip.setColor(led_z, 0, 0, 255);  // Z axis tilt in blue
-
-        // Update the LED strip to show the new state
-        ledStrip.update();
+    // Only print and draw while this task owns the LED strip
+    if (current_task != BLUETOOTH_TASK) {
+        return;
+    }
 
-        // Add a delay to ensure data is readable on the Bluetooth terminal
-        sleep_ms(500);  // Adjust the delay as needed
+    // Print what was sent to the terminal for debugging purposes
+    LOG_INFO("Queued %d samples for Bluetooth in %u bytes (%u bytes sent, %u samples dropped)",
+        samples_sent, (uint32_t)bytes_sent, bluetooth_tx.bytes_sent(), accelerometer_task_samples_dropped());
 
-        // Check if the task has been switched; if so, break out of the loop
-        if (current_task != BLUETOOTH_TASK) {
-            break;
-        }
+    // Map the latest accelerometer reading to the LED display
+    LIS3DHAcceleration acceleration;
+    if (accelerometer_task_latest(&acceleration)) {
+        accelerometer_show_tilt(led_strip, acceleration);
     }
 }
-
@@ -7,7 +7,11 @@
 #include "drivers/lis3dh.h"  // Include the LIS3DH accelerometer class
 #include "drivers/leds.h"    // Include the LEDs control class
 
-// Function declaration with parameters
-void run_bluetooth_task();
+// Initialise the UART connected to the Bluetooth module
+void bluetooth_task_init();
+
+// Step function for the Bluetooth task, run by the scheduler every BLUETOOTH_TASK_PERIOD_US. Streams the
+// accelerometer samples taken since the last step as binary telemetry packets.
+void bluetooth_task_step(void* context);
 
 #endif // BLUETOOTH_TASK_H
@@ -3,81 +3,53 @@
 #include "led_task.h"
 #include "task_manager.h"
 #include "board.h"
+#include "drivers/led_color.h"
+#include "drivers/logging/logging.h"
+#include "utils/trace.h"
 #include <stdio.h>
 
-// Convert hue to RGB values
-void hueToRGB(uint hue, uint8_t* red, uint8_t* green, uint8_t* blue) {
-    float s = 1.0;  // Maximum saturation
-    float v = 200.0;  // Maximum brightness 255
-    float h = hue / 60.0;
-    int i = (int)h;
-    float f = h - (float)i;
-    float p = v * (1 - s);
-    float q = v * (1 - s * f);
-    float t = v * (1 - s * (1 - f));
-
-    switch (i) {
-    case 0:
-        *red = v, *green = t, *blue = p;
-        break;
-    case 1:
-        *red = q, *green = v, *blue = p;
-        break;
-    case 2:
-        *red = p, *green = v, *blue = t;
-        break;
-    case 3:
-        *red = p, *green = q, *blue = v;
-        break;
-    case 4:
-        *red = t, *green = p, *blue = v;
-        break;
-    case 5:
-    default:
-        *red = v, *green = p, *blue = q;
-        break;
-    }
+// Colour wheel at a brightness of 200 (out of 255), generated at compile time
+static constexpr std::array<RGBColor, HUE_WHEEL_STEPS> hue_wheel = make_hue_wheel(200.0);
 
-    *red = (uint8_t)*red;
-    *green = (uint8_t)*green;
-    *blue = (uint8_t)*blue;
+// Convert hue (in degrees, wrapping at 360) to RGB values
+void hueToRGB(uint hue, uint8_t* red, uint8_t* green, uint8_t* blue) {
+    const RGBColor &color = hue_wheel[hue % HUE_WHEEL_STEPS];
+    *red = color.red;
+    *green = color.green;
+    *blue = color.blue;
 }
 
-// Static LED strip instance for this file only
-static LEDs ledStrip(LED_PIN, NUM_LEDS, pio0, 0);  // PIO0 and State Machine 0
+// Step of the LED task (snake animation): moves the snake along by one LED
+void led_task_step(void *context) {
+    static uint hue = 0;  // Static to maintain the colour between steps
+    static int head = 0;  // Position of the snake
 
-// Function to run the LED task (snake animation)
-void run_led_task() {
-    static uint hue = 0;  // Make the hue variable static to maintain its state between function calls
-
-    // Task: Snake animation
-    for (int i = 0; i < NUM_LEDS; ++i) {
-        // Clear all LEDs
-        ledStrip.clear();
+    // Only draw while this task owns the LED strip
+    if (current_task != LED_TASK) {
+        return;
+    }
+    TRACE_SPAN("led snake");
 
-        // Set the colors of the snake
-        for (int j = 0; j < SNAKE_LENGTH; ++j) {
-            int led_index = (i + j) % NUM_LEDS;
-            // Calculate RGB from Hue
-            uint8_t red, green, blue;
-            hueToRGB(hue + j * 30, &red, &green, &blue);  // Gradually change the hue along the snake
+    // Start a new frame with all LEDs off
+    led_strip.clear();
 
-            // Print RGB values to debug
-            printf("LED %d: RGB(%u, %u, %u)\n", led_index, red, green, blue);
+    // Set the colors of the snake
+    for (int j = 0; j < SNAKE_LENGTH; ++j) {
+        int led_index = (head + j) % NUM_LEDS;
+        // Calculate RGB from Hue
+        uint8_t red, green, blue;
+        hueToRGB(hue + j * 30, &red, &green, &blue);  // Gradually change the hue along the snake
 
-            ledStrip.setColor(led_index, red, green, blue);
-        }
+        // Print RGB values to debug
+        LOG_INFO("LED %d: RGB(%u, %u, %u)", led_index, red, green, blue);
 
-        // Update LEDs to show the set colors
-        ledStrip.update();
-        sleep_ms(50);  // Update rate controls the speed of the snake
+        led_strip.setColor(led_index, red, green, blue);
+    }
 
-        // Increment hue for the next cycle to change colors
-        hue = (hue + 1) % 360;
+    // Send the new frame to the LEDs. The step period (LED_TASK_PERIOD_US) controls the speed of the snake.
+    led_strip.commit();
 
-        // If task was switched, break out of the loop
-        if (current_task != LED_TASK) {
-            break;
-        }
-    }
+    // Move the snake and change colour for the next step
+    head = (head + 1) % NUM_LEDS;
+    hue = (hue + 1) % 360;
 }
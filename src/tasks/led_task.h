@@ -11,7 +11,10 @@
 #define NUM_LEDS 12
 #define SNAKE_LENGTH 4 // Length of the "snake" led pattern
 
-// Function prototype for running the LED task
-void run_led_task();
+// Convert hue (in degrees, wrapping at 360) to RGB values at the snake's brightness
+void hueToRGB(uint hue, uint8_t* red, uint8_t* green, uint8_t* blue);
+
+// Step function for the LED task (snake animation), run by the scheduler every LED_TASK_PERIOD_US
+void led_task_step(void *context);
 
 #endif // LED_TASK_H
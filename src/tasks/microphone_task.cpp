@@ -7,143 +7,251 @@
 #include "task_manager.h"
 #include "drivers/microphone.h" 
 #include "drivers/leds.h"     
+#include "drivers/logging/logging.h"
+#if MIC_ANALYZER_GOERTZEL
+#include "dsp/goertzel_analyzer.h"
+#else
+#include "dsp/spectrum_analyzer.h"
+#endif
+#include "utils/spsc_ring.h"
+#include "utils/trace.h"
 #include "board.h"
-
-// Define constants and buffer sizes
-#define SAMPLE_SIZE 1024
+#if MIC_DUAL_CORE
+#include "pico/multicore.h"
+#endif
 
 // Define LED parameters
 #define LED_PIN 14              // Pin where the LED data line is connected
 #define NUM_LEDS 12             // Number of LEDs in the strip
 
-// Define LED bin boundaries (adjust based on your project)
-const uint16_t led_bins[13] = {6, 8, 11, 16, 24, 35, 51, 75, 110, 161, 237, 349, 513}; // From Matlab code
-const float32_t threshold = 0.0001f;
+// LED bin boundaries: one logarithmically spaced band per LED, from LED_BAND_LOW_HZ up to Nyquist. The default layout
+// keeps the edges from the Matlab code (whose last edge, 513, read one bin past the spectrum); other FFT sizes and LED
+// counts have theirs generated.
+#if FFT_SIZE == 1024 && NUM_LEDS == 12
+constexpr std::array<uint16_t, NUM_LEDS + 1> led_bins = {6, 8, 11, 16, 24, 35, 51, 75, 110, 161, 237, 349, 512};
+#else
+constexpr auto led_bins = make_log_band_edges<NUM_LEDS>(FFT_SIZE, MIC_SAMPLE_RATE, LED_BAND_LOW_HZ, MIC_SAMPLE_RATE / 2.0);
+#endif
+static_assert(band_edges_valid(led_bins, FFT_SIZE), "Too many LEDs for the FFT resolution");
+
+// Energy an LED band must exceed to light up, with a higher threshold for the top band
+constexpr uint64_t threshold = band_energy_from_real(0.0001);
+constexpr uint64_t top_band_threshold = threshold * 500;
 
+// Capture and band energy stages for the LED display: window, FFT and bin sums, or one Goertzel resonator per band
+#if MIC_ANALYZER_GOERTZEL
+using MicrophoneAnalyzer = GoertzelAnalyzer<FFT_SIZE, STFT_HOP_SIZE, NUM_LEDS, MIC_CAPTURE_BUFFERS>;
+#else
+using MicrophoneAnalyzer = SpectrumAnalyzer<FFT_SIZE, STFT_HOP_SIZE, NUM_LEDS, MIC_CAPTURE_BUFFERS>;
+#endif
+static MicrophoneAnalyzer analyzer(led_bins, DC_OFFSET);
 
-// Global buffers and variables
-static int16_t time_domain_signal[SAMPLE_SIZE];       // Buffer to store Q15 samples for FFT
-q15_t windowed_signal[SAMPLE_SIZE];          // Buffer for the windowed signal
-q15_t fft_out[SAMPLE_SIZE * 2];              // Complex output (real + imaginary)
-q15_t magnitude_squared[SAMPLE_SIZE / 2];    // Store half the FFT result
+// The microphone, streaming continuously once the task has been initialised
+static microphone mic;
 
-// Global variable containing the Hanning window coefficients in Q15 format
-const int16_t hanning_window[SAMPLE_SIZE] = {
-    /* Insert the Q15 formatted Hanning window coefficients generated from MATLAB */
-    0, 0, 1, 3, 5, 8, 11, 15, 20, 25, 31, 37, 44, 52, 61, 69, 79, 89, 100, 111, 123, 136, 149, 163, 178, 193, 208, 225, 242, 259, 277, 296, 315, 335, 356, 377, 399, 421, 444, 468, 492, 517, 542, 568, 595, 622, 650, 678, 707, 736, 767, 797, 829, 860, 893, 926, 960, 994, 1029, 1064, 1100, 1137, 1174, 1211, 1250, 1288, 1328, 1368, 1408, 1449, 1491, 1533, 1576, 1619, 1663, 1708, 1753, 1798, 1844, 1891, 1938, 1986, 2034, 2083, 2133, 2182, 2233, 2284, 2335, 2387, 2440, 2493, 2547, 2601, 2656, 2711, 2766, 2823, 2879, 2937, 2994, 3053, 3111, 3171, 3230, 3291, 3351, 3413, 3474, 3536, 3599, 3662, 3726, 3790, 3855, 3920, 3985, 4051, 4118, 4185, 4252, 4320, 4388, 4457, 4526, 4596, 4666, 4737, 4808, 4879, 4951, 5023, 5096, 5169, 5243, 5317, 5391, 5466, 5541, 5617, 5693, 5769, 5846, 5923, 6001, 6079, 6158, 6236, 6316, 6395, 6475, 6555, 6636, 6717, 6799, 6880, 6962, 7045, 7128, 7211, 7295, 7379, 7463, 7547, 7632, 7717, 7803, 7889, 7975, 8062, 8148, 8236, 8323, 8411, 8499, 8587, 8676, 8765, 8854, 8944, 9033, 9123, 9214, 9304, 9395, 9486, 9578, 9670, 9761, 9854, 9946, 10039, 10132, 10225, 10318, 10412, 10505, 10599, 10694, 10788, 10883, 10978, 11073, 11168, 11264, 11359, 11455, 11551, 11648, 11744, 11841, 11937, 12034, 12131, 12229, 12326, 12424, 12521, 12619, 12717, 12815, 12914, 13012, 13111, 13209, 13308, 13407, 13506, 13605, 13704, 13804, 13903, 14003, 14102, 14202, 14302, 14401, 14501, 14601, 14701, 14802, 14902, 15002, 15102, 15203, 15303, 15403, 15504, 15604, 15705, 15806, 15906, 16007, 16107, 16208, 16309, 16409, 16510, 16610, 16711, 16812, 16912, 17013, 17113, 17214, 17314, 17415, 17515, 17616, 17716, 17816, 17916, 18017, 18117, 18217, 18317, 18416, 18516, 18616, 18716, 18815, 18915, 19014, 19113, 19213, 19312, 19411, 19509, 19608, 19707, 19805, 19904, 20002, 20100, 20198, 20296, 20393, 20491, 20588, 20685, 20782, 20879, 20976, 21072, 21169, 21265, 21361, 21457, 21552, 21647, 21743, 21838, 21932, 22027, 22121, 22216, 22309, 22403, 22497, 22590, 22683, 22776, 22868, 22961, 23053, 23144, 23236, 23327, 23418, 23509, 23599, 23690, 23780, 23869, 23959, 24048, 24136, 24225, 24313, 24401, 24489, 24576, 24663, 24750, 24836, 24922, 25008, 25093, 25178, 25263, 25347, 25431, 25515, 25599, 25682, 25764, 25847, 25929, 26010, 26091, 26172, 26253, 26333, 26413, 26492, 26571, 26650, 26728, 26806, 26883, 26960, 27037, 27113, 27189, 27265, 27340, 27414, 27488, 27562, 27636, 27708, 27781, 27853, 27925, 27996, 28067, 28137, 28207, 28276, 28345, 28414, 28482, 28550, 28617, 28683, 28750, 28815, 28881, 28946, 29010, 29074, 29137, 29200, 29263, 29325, 29386, 29447, 29508, 29568, 29627, 29686, 29745, 29803, 29860, 29917, 29974, 30029, 30085, 30140, 30194, 30248, 30301, 30354, 30407, 30458, 30510, 30560, 30611, 30660, 30709, 30758, 30806, 30853, 30900, 30947, 30993, 31038, 31083, 31127, 31170, 31213, 31256, 31298, 31339, 31380, 31420, 31460, 31499, 31538, 31576, 31613, 31650, 31686, 31722, 31757, 31791, 31825, 31859, 31891, 31924, 31955, 31986, 32017, 32046, 32076, 32104, 32132, 32160, 32187, 32213, 32239, 32264, 32288, 32312, 32335, 32358, 32380, 32402, 32422, 32443, 32462, 32481, 32500, 32518, 32535, 32551, 32567, 32583, 32598, 32612, 32625, 32638, 32651, 32662, 32673, 32684, 32694, 32703, 32712, 32720, 32727, 32734, 32740, 32746, 32751, 32755, 32759, 32762, 32764, 32766, 32767, 32767, 32767, 32767, 32766, 32764, 32762, 32759, 32755, 32751, 32746, 32740, 32734, 32727, 32720, 32712, 32703, 32694, 32684, 32673, 32662, 32651, 32638, 32625, 32612, 32598, 32583, 32567, 32551, 32535, 32518, 32500, 32481, 32462, 32443, 32422, 32402, 32380, 32358, 32335, 32312, 32288, 32264, 32239, 32213, 32187, 32160, 32132, 32104, 32076, 32046, 32017, 31986, 31955, 31924, 31891, 31859, 31825, 31791, 31757, 31722, 31686, 31650, 31613, 31576, 31538, 31499, 31460, 31420, 31380, 31339, 31298, 31256, 31213, 31170, 31127, 31083, 31038, 30993, 30947, 30900, 30853, 30806, 30758, 30709, 30660, 30611, 30560, 30510, 30458, 30407, 30354, 30301, 30248, 30194, 30140, 30085, 30029, 29974, 29917, 29860, 29803, 29745, 29686, 29627, 29568, 29508, 29447, 29386, 29325, 29263, 29200, 29137, 29074, 29010, 28946, 28881, 28815, 28750, 28683, 28617, 28550, 28482, 28414, 28345, 28276, 28207, 28137, 28067, 27996, 27925, 27853, 27781, 27708, 27636, 27562, 27488, 27414, 27340, 27265, 27189, 27113, 27037, 26960, 26883, 26806, 26728, 26650, 26571, 26492, 26413, 26333, 26253, 26172, 26091, 26010, 25929, 25847, 25764, 25682, 25599, 25515, 25431, 25347, 25263, 25178, 25093, 25008, 24922, 24836, 24750, 24663, 24576, 24489, 24401, 24313, 24225, 24136, 24048, 23959, 23869, 23780, 23690, 23599, 23509, 23418, 23327, 23236, 23144, 23053, 22961, 22868, 22776, 22683, 22590, 22497, 22403, 22309, 22216, 22121, 22027, 21932, 21838, 21743, 21647, 21552, 21457, 21361, 21265, 21169, 21072, 20976, 20879, 20782, 20685, 20588, 20491, 20393, 20296, 20198, 20100, 20002, 19904, 19805, 19707, 19608, 19509, 19411, 19312, 19213, 19113, 19014, 18915, 18815, 18716, 18616, 18516, 18416, 18317, 18217, 18117, 18017, 17916, 17816, 17716, 17616, 17515, 17415, 17314, 17214, 17113, 17013, 16912, 16812, 16711, 16610, 16510, 16409, 16309, 16208, 16107, 16007, 15906, 15806, 15705, 15604, 15504, 15403, 15303, 15203, 15102, 15002, 14902, 14802, 14701, 14601, 14501, 14401, 14302, 14202, 14102, 14003, 13903, 13804, 13704, 13605, 13506, 13407, 13308, 13209, 13111, 13012, 12914, 12815, 12717, 12619, 12521, 12424, 12326, 12229, 12131, 12034, 11937, 11841, 11744, 11648, 11551, 11455, 11359, 11264, 11168, 11073, 10978, 10883, 10788, 10694, 10599, 10505, 10412, 10318, 10225, 10132, 10039, 9946, 9854, 9761, 9670, 9578, 9486, 9395, 9304, 9214, 9123, 9033, 8944, 8854, 8765, 8676, 8587, 8499, 8411, 8323, 8236, 8148, 8062, 7975, 7889, 7803, 7717, 7632, 7547, 7463, 7379, 7295, 7211, 7128, 7045, 6962, 6880, 6799, 6717, 6636, 6555, 6475, 6395, 6316, 6236, 6158, 6079, 6001, 5923, 5846, 5769, 5693, 5617, 5541, 5466, 5391, 5317, 5243, 5169, 5096, 5023, 4951, 4879, 4808, 4737, 4666, 4596, 4526, 4457, 4388, 4320, 4252, 4185, 4118, 4051, 3985, 3920, 3855, 3790, 3726, 3662, 3599, 3536, 3474, 3413, 3351, 3291, 3230, 3171, 3111, 3053, 2994, 2937, 2879, 2823, 2766, 2711, 2656, 2601, 2547, 2493, 2440, 2387, 2335, 2284, 2233, 2182, 2133, 2083, 2034, 1986, 1938, 1891, 1844, 1798, 1753, 1708, 1663, 1619, 1576, 1533, 1491, 1449, 1408, 1368, 1328, 1288, 1250, 1211, 1174, 1137, 1100, 1064, 1029, 994, 960, 926, 893, 860, 829, 797, 767, 736, 707, 678, 650, 622, 595, 568, 542, 517, 492, 468, 444, 421, 399, 377, 356, 335, 315, 296, 277, 259, 242, 225, 208, 193, 178, 163, 149, 136, 123, 111, 100, 89, 79, 69, 61, 52, 44, 37, 31, 25, 20, 15, 11, 8, 5, 3, 1, 0, 0 
+// Band energies are passed to the display as 32-bit values in units of 2^BAND_FRAME_SHIFT band energy units,
+// saturating at UINT32_MAX (far above any threshold). This keeps a frame small enough to copy between cores cheaply.
+#define BAND_FRAME_SHIFT 8
+
+// One analysed frame, reduced to what the LED display needs
+struct BandEnergyFrame {
+    uint32_t sequence;           // Frame number (from the analyzer's frame count)
+    uint32_t energy[NUM_LEDS];   // Energy in each LED band, in compact units
 };
 
-/*! \brief Function to run the microphone task, reading samples from the microphone and performing FFT.
+// The LED thresholds in the same compact units
+constexpr std::array<uint32_t, NUM_LEDS> make_compact_thresholds()
+{
+    std::array<uint32_t, NUM_LEDS> compact {};
+    for (size_t led = 0; led < NUM_LEDS; ++led) {
+        compact[led] = (uint32_t)((led == NUM_LEDS - 1 ? top_band_threshold : threshold) >> BAND_FRAME_SHIFT);
+    }
+    return compact;
+}
+constexpr auto led_compact_thresholds = make_compact_thresholds();
+
+// Reduce the analyzer's latest frame to a BandEnergyFrame
+static void pack_band_frame(BandEnergyFrame &frame)
+{
+    const MicrophoneAnalyzer::BandEnergy &energy = analyzer.band_energy();
+    frame.sequence = analyzer.frame_count();
+    for (size_t led = 0; led < NUM_LEDS; ++led) {
+        uint64_t compact = energy[led] >> BAND_FRAME_SHIFT;
+        frame.energy[led] = compact > UINT32_MAX ? UINT32_MAX : (uint32_t)compact;
+    }
+}
+
+#if MIC_DUAL_CORE
+// Frames travelling from core 1 (capture and analysis) to core 0 (display)
+static SpscRing<BandEnergyFrame, MIC_FRAME_QUEUE_LENGTH> band_frames;
+static volatile uint32_t frames_dropped = 0;   // Frames core 0 was too slow to take (written by core 1 only)
+static volatile int core1_state = 0;           // 0 while starting, 1 once streaming, -1 if streaming failed
+
+/*! \brief Entry point for core 1, which owns audio capture and analysis.
  *
- * This function initializes the microphone, reads audio samples, converts them to Q15 format,
- * performs FFT, and computes the magnitude squared of the FFT result.
+ * Core 1 waits for each hop from the DMA, analyses it and publishes the band energies to
+ * core 0. The DMA interrupt is taken on this core (DMA_IRQ_1), so it never disturbs the LED,
+ * I2C or UART work on core 0.
  */
-int run_microphone_task()
+static void microphone_core1_main()
 {
-    // Create a local static buffer to store microphone samples (ADC values)
-    static int16_t microphone_sample_buffer[SAMPLE_SIZE];
-    
-    // Create an instance of the `microphone` class
-    microphone mic;
+    mic.init(MIC_GPIO_PIN, MIC_SAMPLE_RATE);
+    if (!analyzer.start_capture(mic)) {
+        core1_state = -1;
+        return;
+    }
+    core1_state = 1;
+
+    BandEnergyFrame frame;
+    while (true) {
+        // Nothing is published until the first full frame has been captured
+        if (!analyzer.analyse_next_hop(mic)) {
+            continue;
+        }
+        pack_band_frame(frame);
+        if (!band_frames.push(frame)) {
+            frames_dropped = frames_dropped + 1;
+        }
+    }
+}
+#endif
 
+/*! \brief Initialise the microphone task.
+ *
+ * This function initializes the microphone and starts streaming audio samples into the
+ * spectrum analyzer. With MIC_DUAL_CORE, capture and analysis are started on core 1 and
+ * their results are read back from a lock-free queue; otherwise they run on this core
+ * within the task's step.
+ *
+ * The audio is analysed as a short-time Fourier transform: the microphone streams one hop
+ * (STFT_HOP_SIZE samples) per capture buffer, and each hop is appended to a sliding window of
+ * the latest FFT_SIZE samples which is then transformed. Consecutive frames overlap by
+ * FFT_SIZE - STFT_HOP_SIZE samples, so the display updates once per hop and no input is
+ * skipped as long as the analysis keeps up. With MIC_ANALYZER_GOERTZEL, each hop instead runs
+ * through one Goertzel resonator per band, and the display updates once per (shorter) hop.
+ *
+ * \return false if streaming could not be started.
+ */
+bool microphone_task_init()
+{
+#if MIC_DUAL_CORE
+    multicore_launch_core1(microphone_core1_main);
+    while (core1_state == 0) {
+        tight_loop_contents();
+    }
+    if (core1_state < 0) {
+        printf("Microphone streaming failed to start!\n");
+        return false;
+    }
+    return true;
+#else
     // Initialize the microphone
-    mic.init(26); // Initialize the microphone with the correct GPIO pin
+    mic.init(MIC_GPIO_PIN, MIC_SAMPLE_RATE); // Initialize the microphone with the correct GPIO pin
 
-    // Create an instance of the `LEDs` class with the required parameters
-    PIO pio = pio0;   // Use PIO0 for LED control
-    uint sm = 0;      // Use state machine 0 for PIO
-    LEDs myLEDs(LED_PIN, NUM_LEDS, pio, sm); // Initialize LEDs with required arguments
+    // Start continuous capture into the analyzer
+    if (!analyzer.start_capture(mic)) {
+        printf("Microphone streaming failed to start!\n");
+        return false;
+    }
+    return true;
+#endif
+}
 
-    // FFT instance and parameters
-    arm_rfft_instance_q15 fft_instance;
-    arm_rfft_init_q15(&fft_instance, SAMPLE_SIZE, 0, 1); // Initialize FFT for a 1024-point FFT
+// Fetch the newest analysed frame, discarding any older ones. Returns false if there is nothing new.
+static bool next_band_frame(BandEnergyFrame &frame)
+{
+#if MIC_DUAL_CORE
+    bool received = false;
+    while (band_frames.pop(frame)) {
+        received = true;
+    }
+    return received;
+#else
+    if (!analyzer.try_analyse_next_hops(mic)) {
+        return false;
+    }
+    pack_band_frame(frame);
+    return true;
+#endif
+}
 
-    while (true)
+// Light each LED whose frequency band has enough energy (nothing is sent until the strip is committed)
+static void draw_band_frame(const BandEnergyFrame &frame)
+{
+    // LED logic: Iterate over the LEDs
+    for (int led = 0; led < NUM_LEDS; led++)
     {
-        // Read from the microphone (blocking until buffer is filled)
-        mic.read_blocking(microphone_sample_buffer, SAMPLE_SIZE);
+        // Debug: Print energy for the current LED bin
+        LOG_VERBOSE("LED %d Energy: %u", led, (unsigned)frame.energy[led]);
 
-        // Calculate the DC bias and shift to fit into Q15 format
-        int32_t dc_bias = 0;
-        for (int i = 0; i < SAMPLE_SIZE; i++) {
-            dc_bias += microphone_sample_buffer[i];
-        }
-        dc_bias = dc_bias / SAMPLE_SIZE;
-
-        for (int i = 0; i < SAMPLE_SIZE; i++) {
-            // Subtract the DC bias and apply aggressive scaling to amplify the signal
-            // time_domain_signal[i] = (int16_t)((microphone_sample_buffer[i] - dc_bias) * 2); // Scale by 2 for increased amplitude
-            time_domain_signal[i] = (int16_t)(microphone_sample_buffer[i] - dc_bias); // Scale by 2 for increased amplitude
-
-            // Debug: Print the adjusted time domain values
-            if (i < 10) printf("Adjusted Time Domain: %d\n", time_domain_signal[i]);
-            
-            // Further amplify the signal (left shift to fit Q15 format)
-            time_domain_signal[i] = (int16_t)(time_domain_signal[i] << 5);
+        // Compare against the threshold for this band
+        if (frame.energy[led] > led_compact_thresholds[led])
+        {
+            // Turn on the LED with red color
+            LOG_VERBOSE("LED %d ON (Red)", led);
+            led_strip.setColor(led, 255, 0, 0);  // Set LED to red with maximum brightness
         }
-
-        // Apply Hanning window
-        for (int i = 0; i < SAMPLE_SIZE; ++i)
+        else
         {
-            windowed_signal[i] = (int16_t)(((int32_t)time_domain_signal[i] * hanning_window[i]) >> 15);
-            if (i < 10) printf("Windowed Signal: %d\n", windowed_signal[i]); // Print first 10 values for debugging
+            // Turn off the LED if the energy is below threshold
+            LOG_VERBOSE("LED %d OFF", led);
+            led_strip.setColor(led, 0, 0, 0); // Turn off the LED
         }
+    }
+}
 
-        // Perform FFT on the windowed signal
-        arm_rfft_q15(&fft_instance, windowed_signal, fft_out);
-
-        // Calculate magnitude squared of FFT results
-        arm_cmplx_mag_squared_q15(fft_out, magnitude_squared, SAMPLE_SIZE / 2);
+/*! \brief Step of the microphone task, run by the scheduler every MICROPHONE_TASK_PERIOD_US.
+ *
+ * Takes the newest analysed frame and, while this task is selected, lights each LED whose
+ * frequency band has enough energy.
+ */
+void microphone_task_step(void *context)
+{
+    BandEnergyFrame frame;
+    if (!next_band_frame(frame)) {
+        return;
+    }
 
-        // Debug: Print magnitude squared values (first 10)
-        printf("Magnitude Squared Values:\n");
-        for (int i = 0; i < 10; i++) { // Print first 10 values for brevity
-            printf("%d, ", magnitude_squared[i]);
-        }
-        printf("\n");
+    // Only draw while this task owns the LED strip
+    if (current_task != MICROPHONE_TASK) {
+        return;
+    }
+    TRACE_SPAN("mic leds");
+    draw_band_frame(frame);
 
-        // LED logic: Iterate over the LEDs (0 to 12)
-        for (int led = 0; led < 12; led++)
-        {
-            float32_t energy = 0.0f;
-            // Sum the energy over the bins assigned to this LED
-            for (int i = led_bins[led]; i < led_bins[led + 1]; i++)
-            {
-                energy += (float32_t)magnitude_squared[i] / 32768.0f;
-            }
-
-            // Debug: Print energy for the current LED bin
-            printf("LED %d Energy: %f\n", led, energy);
-
-            // Apply a dynamic threshold for LED activation
-            float32_t dynamic_threshold = (led == 11) ? threshold * 500 : threshold; // Increase threshold for higher frequencies
-            if (energy > dynamic_threshold)
-            {
-                // Turn on the LED with red color
-                printf("LED %d ON (Red)\n", led);
-                myLEDs.setColor(led, 255, 0, 0);  // Set LED to red with maximum brightness
-            }
-            else
-            {
-                // Turn off the LED if the energy is below threshold
-                printf("LED %d OFF\n", led);
-                myLEDs.setColor(led, 0, 0, 0); // Turn off the LED
-            }
-        }
+    // Apply the LED changes to update the visual display (nothing is sent if no LED changed)
+    led_strip.commit();
+}
 
-        // Apply the LED changes to update the visual display
-        myLEDs.update();
+/*! \brief Print the capture statistics: buffers lost because analysis fell behind, and (in dual
+ * core mode) analysed frames dropped because the display fell behind.
+ */
+void microphone_task_print_stats()
+{
+#if MIC_DUAL_CORE
+    printf("Microphone capture overruns: %u, frames analysed: %u, frames dropped: %u\n", (unsigned)mic.overrun_count(),
+           (unsigned)analyzer.frame_count(), (unsigned)frames_dropped);
+#else
+    printf("Microphone capture overruns: %u, frames analysed: %u\n", (unsigned)mic.overrun_count(),
+           (unsigned)analyzer.frame_count());
+#endif
+}
 
-        // Check if the task has been switched; if so, exit the function
-        if (current_task != MICROPHONE_TASK)
-        {
-            printf("Task switched, exiting microphone task... (current task = %d)\n", current_task);
-            break;
-        }
+#ifdef TEST_HARNESS
+void microphone_task_replay_reset()
+{
+    analyzer.reset();
+    led_strip.clear();
+}
 
-        // Add a small delay to prevent the loop from overwhelming the CPU
-        sleep_ms(50);
+bool microphone_task_replay_hop(const uint16_t *samples)
+{
+    if (!analyzer.analyse_hop(samples)) {
+        return false;
     }
-
-    return 1;
+    BandEnergyFrame frame;
+    pack_band_frame(frame);
+    draw_band_frame(frame);
+    return true;
 }
+#endif
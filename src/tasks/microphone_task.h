@@ -6,8 +6,22 @@
 #include "pico/stdlib.h"
 #include "drivers/microphone.h"
 
-extern volatile bool stop_task;
+// Initialise the microphone and start streaming. Returns false if streaming could not be started.
+bool microphone_task_init();
 
-int run_microphone_task();
+// Step function for the microphone task, run by the scheduler every MICROPHONE_TASK_PERIOD_US
+void microphone_task_step(void *context);
+
+// Print the microphone capture statistics
+void microphone_task_print_stats();
+
+#ifdef TEST_HARNESS
+// Test harness only: offline replay, used instead of microphone_task_init() and the scheduler. Reset the analysis,
+// then feed it one hop (STFT_HOP_SIZE raw ADC samples) at a time; each hop goes through the same analysis (FFT or
+// Goertzel) as captured audio, and once a full frame has been analysed the LEDs are drawn as the task's
+// step would (but not committed). Returns true if the LEDs were drawn.
+void microphone_task_replay_reset();
+bool microphone_task_replay_hop(const uint16_t *samples);
+#endif
 
 #endif
\ No newline at end of file
@@ -0,0 +1,160 @@
+// scheduler.cpp
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#include "scheduler.h"
+
+Scheduler::Scheduler() : _num_tasks(0), _started(false), _idle(nullptr) {
+}
+
+// add_task(): Registers a step function to be run every `period_us` microseconds
+int Scheduler::add_task(const char *name, uint32_t period_us, TaskStepFunction step, void *context) {
+    if (_num_tasks >= SCHEDULER_MAX_TASKS || period_us == 0 || step == nullptr) {
+        return -1;
+    }
+
+    Task &task = _tasks[_num_tasks];
+    task.name = name;
+    task.period_us = period_us;
+    task.step = step;
+    task.context = context;
+    task.deadline_us = _started ? time_us_64() : 0;
+    task.enabled = true;
+    task.stats = TaskStats();
+    return _num_tasks++;
+}
+
+void Scheduler::set_enabled(int task_id, bool enabled) {
+    if (task_id < 0 || (uint)task_id >= _num_tasks) {
+        return;
+    }
+    Task &task = _tasks[task_id];
+    if (enabled && !task.enabled) {
+        task.deadline_us = time_us_64();
+    }
+    task.enabled = enabled;
+}
+
+bool Scheduler::is_enabled(int task_id) const {
+    return task_id >= 0 && (uint)task_id < _num_tasks && _tasks[task_id].enabled;
+}
+
+void Scheduler::start() {
+    uint64_t now = time_us_64();
+    for (uint i = 0; i < _num_tasks; ++i) {
+        _tasks[i].deadline_us = now;
+    }
+    _started = true;
+}
+
+// run_pending(): Runs due tasks one at a time, always picking the earliest deadline. The clock is re-read after
+// every step so that a task released while another was running is picked up in the same call.
+uint Scheduler::run_pending() {
+    uint steps = 0;
+    while (true) {
+        uint64_t now = time_us_64();
+        Task *next = nullptr;
+        for (uint i = 0; i < _num_tasks; ++i) {
+            Task &task = _tasks[i];
+            if (task.enabled && task.deadline_us <= now && (next == nullptr || task.deadline_us < next->deadline_us)) {
+                next = &task;
+            }
+        }
+        if (next == nullptr) {
+            return steps;
+        }
+        _run_task(*next, now);
+        steps++;
+    }
+}
+
+uint64_t Scheduler::next_deadline() const {
+    uint64_t earliest = UINT64_MAX;
+    for (uint i = 0; i < _num_tasks; ++i) {
+        if (_tasks[i].enabled && _tasks[i].deadline_us < earliest) {
+            earliest = _tasks[i].deadline_us;
+        }
+    }
+    return earliest;
+}
+
+// run(): The main loop. Steps are run on their deadlines, the idle function runs in the time left over, and the
+// CPU sleeps for the rest.
+void Scheduler::run() {
+    if (!_started) {
+        start();
+    }
+    while (true) {
+        run_pending();
+
+        uint64_t deadline = next_deadline();
+        if (_idle != nullptr && deadline > time_us_64()) {
+            _idle(deadline);
+        }
+        uint64_t now = time_us_64();
+        if (deadline == UINT64_MAX) {
+            sleep_ms(1);  // Nothing enabled: wait for a task to be enabled from an interrupt
+        } else if (deadline > now) {
+            sleep_us(deadline - now);
+        }
+    }
+}
+
+// _run_task(): Runs one release of a task and moves its deadline on by one period
+void Scheduler::_run_task(Task &task, uint64_t now) {
+    TaskStats &stats = task.stats;
+    uint32_t jitter = (uint32_t)(now - task.deadline_us);
+    stats.total_jitter_us += jitter;
+    if (jitter > stats.max_jitter_us) {
+        stats.max_jitter_us = jitter;
+    }
+
+    task.step(task.context);
+
+    uint64_t finish = time_us_64();
+    uint32_t run_time = (uint32_t)(finish - now);
+    stats.runs++;
+    stats.total_run_us += run_time;
+    if (run_time > stats.max_run_us) {
+        stats.max_run_us = run_time;
+    }
+
+    // Deadlines are absolute, so lateness in one period is not carried into the next
+    task.deadline_us += task.period_us;
+    if (finish > task.deadline_us) {
+        stats.overruns++;
+
+        // Drop any releases that have already passed rather than running them back to back
+        uint64_t missed = (finish - task.deadline_us) / task.period_us;
+        task.deadline_us += missed * task.period_us;
+        stats.skipped += (uint32_t)missed;
+    }
+}
+
+const TaskStats &Scheduler::stats(int task_id) const {
+    return _tasks[task_id].stats;
+}
+
+const char *Scheduler::task_name(int task_id) const {
+    return _tasks[task_id].name;
+}
+
+void Scheduler::reset_stats() {
+    for (uint i = 0; i < _num_tasks; ++i) {
+        _tasks[i].stats = TaskStats();
+    }
+}
+
+void Scheduler::print_stats() const {
+    printf("%-14s %8s %8s %6s %8s %8s %8s %8s\n", "task", "period", "runs", "over", "skipped", "jit avg", "jit max",
+           "run max");
+    for (uint i = 0; i < _num_tasks; ++i) {
+        const Task &task = _tasks[i];
+        const TaskStats &stats = task.stats;
+        uint32_t mean_jitter = stats.runs ? (uint32_t)(stats.total_jitter_us / stats.runs) : 0;
+        printf("%-14s %8u %8u %6u %8u %8u %8u %8u%s\n", task.name, (unsigned)task.period_us, (unsigned)stats.runs,
+               (unsigned)stats.overruns, (unsigned)stats.skipped, (unsigned)mean_jitter,
+               (unsigned)stats.max_jitter_us, (unsigned)stats.max_run_us, task.enabled ? "" : " (disabled)");
+    }
+}
@@ -0,0 +1,88 @@
+// scheduler.h
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+// Maximum number of tasks that can be registered with one scheduler
+#define SCHEDULER_MAX_TASKS 8
+
+// A task's step function. It does one period's worth of work and returns; it must never block for long,
+// because every other task waits for it to finish.
+typedef void (*TaskStepFunction)(void *context);
+
+// Background work done while no task is due (e.g. flushing the log). It should return by `next_deadline_us`
+// (from time_us_64()), or UINT64_MAX if no task is enabled; any time it takes beyond that delays the tasks.
+typedef void (*IdleFunction)(uint64_t next_deadline_us);
+
+// Timing statistics for one task, in microseconds
+struct TaskStats {
+    uint32_t runs;            // Number of times the step function has run
+    uint32_t overruns;        // Runs that finished after the task's next deadline
+    uint32_t skipped;         // Whole periods dropped because the task was too late to catch up
+    uint32_t max_jitter_us;   // Largest delay between a deadline and the step actually starting
+    uint64_t total_jitter_us; // Sum of the start delays (divide by runs for the mean)
+    uint32_t max_run_us;      // Longest step
+    uint64_t total_run_us;    // Sum of the step durations
+};
+
+// Cooperative scheduler. Each task has a period and a step function that is released on absolute deadlines
+// (start time + n * period), so the rate does not drift with the time the step takes. When several tasks are
+// due, the one with the earliest deadline runs first. A task that falls more than a whole period behind
+// skips the missed releases instead of running them back to back.
+class Scheduler {
+public:
+    Scheduler();
+
+    // Register a task. Returns its id, or -1 if the table is full or the period is zero.
+    // The first release is at the next call to start() (or immediately, if the scheduler is already running).
+    int add_task(const char *name, uint32_t period_us, TaskStepFunction step, void *context = nullptr);
+
+    // Enable or disable a task. A re-enabled task is released immediately and then every period from then on.
+    void set_enabled(int task_id, bool enabled);
+    bool is_enabled(int task_id) const;
+
+    // Set every task's first deadline to now
+    void start();
+
+    // Run every task that is due (earliest deadline first) and return the number of steps run
+    uint run_pending();
+
+    // Time (from time_us_64()) of the earliest deadline among the enabled tasks, or UINT64_MAX if there are none
+    uint64_t next_deadline() const;
+
+    // Set the function run() calls when it has time to spare before the next deadline (nullptr for none)
+    void set_idle_function(IdleFunction idle) { _idle = idle; }
+
+    // Run forever, sleeping between deadlines
+    void run();
+
+    const TaskStats &stats(int task_id) const;
+    const char *task_name(int task_id) const;
+    uint task_count() const { return _num_tasks; }
+    void reset_stats();
+
+    // Print a table of the statistics for every task
+    void print_stats() const;
+
+private:
+    struct Task {
+        const char *name;
+        uint32_t period_us;
+        TaskStepFunction step;
+        void *context;
+        uint64_t deadline_us;  // Absolute time of the next release
+        bool enabled;
+        TaskStats stats;
+    };
+
+    Task _tasks[SCHEDULER_MAX_TASKS];
+    uint _num_tasks;
+    bool _started;
+    IdleFunction _idle;
+
+    void _run_task(Task &task, uint64_t now);
+};
+
+#endif // SCHEDULER_H
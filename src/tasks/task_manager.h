@@ -2,6 +2,8 @@
 #ifndef TASK_MANAGER_H
 #define TASK_MANAGER_H
 
+#include "drivers/leds.h"
+
 // Task identifiers
 enum Tasks {
     LED_TASK,
@@ -11,7 +13,11 @@ enum Tasks {
     NUM_TASKS
 };
 
-// Global variable to track the current task
+// Global variable to track the current task. All tasks run side by side under the scheduler; this selects
+// the one that draws on the LED strip.
 extern volatile Tasks current_task;
 
+// The LED strip, shared by all tasks
+extern LEDs led_strip;
+
 #endif // TASK_MANAGER_H
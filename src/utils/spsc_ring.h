@@ -0,0 +1,86 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Keep the producer's and consumer's indices on separate cache lines on the host. The RP2040 has no data
+// cache, so there is nothing to gain there but RAM to lose.
+#ifdef TEST_HARNESS
+#define SPSC_RING_INDEX_ALIGNMENT 64
+#else
+#define SPSC_RING_INDEX_ALIGNMENT 4
+#endif
+
+/*! \brief Lock-free ring buffer for one producer and one consumer.
+ *
+ * Items are copied in by `push` and out by `pop`. The producer only ever writes `head` and the
+ * consumer only ever writes `tail`, so the two sides can run concurrently (on different cores,
+ * or in an interrupt handler and the main loop) with no locks and no read-modify-write atomics,
+ * which the RP2040's Cortex-M0+ does not have. Each side publishes its index with a release
+ * store after it has finished with the slot, and the other side reads it with an acquire load.
+ *
+ * The indices are free-running 32-bit counters, so the ring can hold all `CAPACITY` slots and
+ * `head - tail` is the number of items stored even after the counters wrap.
+ *
+ * \tparam T Item type. It is copied with plain assignment, so it should be small and trivially copyable.
+ * \tparam CAPACITY Number of slots (a power of two).
+ */
+template <typename T, size_t CAPACITY>
+class SpscRing
+{
+public:
+    static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of two");
+
+    SpscRing() : head(0), tail(0) {}
+
+    /*! \brief Producer only: append an item.
+     *
+     * \return false (and the item is dropped) if the ring is full.
+     */
+    bool push(const T &item)
+    {
+        uint32_t write = head.load(std::memory_order_relaxed);
+        if (write - tail.load(std::memory_order_acquire) == CAPACITY) {
+            return false;
+        }
+        slots[write & (CAPACITY - 1)] = item;
+        head.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*! \brief Consumer only: remove the oldest item.
+     *
+     * \return false if the ring is empty.
+     */
+    bool pop(T &item)
+    {
+        uint32_t read = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == read) {
+            return false;
+        }
+        item = slots[read & (CAPACITY - 1)];
+        tail.store(read + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*! \brief Number of items stored. Exact from either side; only a snapshot from anywhere else. */
+    size_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    /*! \brief True if there is nothing to pop. */
+    bool empty() const { return size() == 0; }
+
+    /*! \brief Number of slots. */
+    static constexpr size_t capacity() { return CAPACITY; }
+
+private:
+    alignas(SPSC_RING_INDEX_ALIGNMENT) std::atomic<uint32_t> head; /*!< Items pushed (written by the producer only) */
+    alignas(SPSC_RING_INDEX_ALIGNMENT) std::atomic<uint32_t> tail; /*!< Items popped (written by the consumer only) */
+    T slots[CAPACITY];                                             /*!< Item storage */
+};
+
+#endif // SPSC_RING_H
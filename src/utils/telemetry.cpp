@@ -0,0 +1,191 @@
+#include "telemetry.h"
+
+#include <string.h>
+
+static void put_u16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint16_t telemetry_crc16(const uint8_t *data, size_t length, uint16_t crc)
+{
+    // Bitwise rather than table driven: packets are small, and this keeps 512 bytes of flash free
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t telemetry_cobs_encode(const uint8_t *input, size_t length, uint8_t *output)
+{
+    size_t code_index = 0; // Where the length code of the current block goes
+    size_t out = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; ++i) {
+        if (input[i] != 0) {
+            output[out++] = input[i];
+            code++;
+        }
+        if (input[i] == 0 || code == 0xFF) {
+            // End the block: at a zero (which the code replaces), or when it reaches the maximum length
+            output[code_index] = code;
+            code_index = out++;
+            code = 1;
+        }
+    }
+    output[code_index] = code;
+    output[out++] = 0;
+    return out;
+}
+
+size_t telemetry_cobs_decode(uint8_t *data, size_t length)
+{
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < length) {
+        uint8_t code = data[in++];
+        if (code == 0 || in + code - 1 > length) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; ++i) {
+            data[out++] = data[in++];
+        }
+        // A block shorter than the maximum stands for a zero, except at the very end
+        if (code != 0xFF && in < length) {
+            data[out++] = 0;
+        }
+    }
+    return out;
+}
+
+TelemetryEncoder::TelemetryEncoder() : payload{}, length(TELEMETRY_HEADER_SIZE), sequence(0) {}
+
+void TelemetryEncoder::begin(uint8_t type, uint8_t record_size)
+{
+    payload[0] = type;
+    payload[1] = record_size;
+    payload[2] = 0;
+    length = TELEMETRY_HEADER_SIZE;
+}
+
+bool TelemetryEncoder::add(const void *record)
+{
+    if (space() == 0) {
+        return false;
+    }
+    memcpy(&payload[length], record, payload[1]);
+    length += payload[1];
+    payload[2]++;
+    return true;
+}
+
+size_t TelemetryEncoder::space() const
+{
+    size_t record_size = payload[1];
+    if (record_size == 0) {
+        return 0;
+    }
+    size_t room = (TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_RECORDS_SIZE - length) / record_size;
+    size_t count_room = 255 - payload[2];
+    return room < count_room ? room : count_room;
+}
+
+size_t TelemetryEncoder::finish(uint32_t timestamp_us, uint32_t interval_us, uint8_t *frame)
+{
+    put_u16(&payload[3], sequence++);
+    put_u32(&payload[5], timestamp_us);
+    put_u32(&payload[9], interval_us);
+    put_u16(&payload[length], telemetry_crc16(payload, length));
+    size_t written = telemetry_cobs_encode(payload, length + TELEMETRY_CRC_SIZE, frame);
+
+    // Start an empty packet of the same type, ready for the next batch
+    begin(payload[0], payload[1]);
+    return written;
+}
+
+TelemetryDecoder::TelemetryDecoder()
+    : frame{}, length(0), overflowed(false), have_sequence(false), last_header{}, packet_count(0),
+      crc_error_count(0), framing_error_count(0), lost_count(0)
+{
+}
+
+bool TelemetryDecoder::push(uint8_t byte)
+{
+    if (byte != 0) {
+        if (length < sizeof(frame)) {
+            frame[length++] = byte;
+        } else {
+            overflowed = true;
+        }
+        return false;
+    }
+
+    // A delimiter: decode what came before it (back-to-back delimiters are just idle fill)
+    bool ok = false;
+    if (overflowed) {
+        framing_error_count++;
+    } else if (length > 0) {
+        ok = decode_frame();
+    }
+    length = 0;
+    overflowed = false;
+    return ok;
+}
+
+bool TelemetryDecoder::decode_frame()
+{
+    size_t decoded = telemetry_cobs_decode(frame, length);
+    if (decoded < TELEMETRY_HEADER_SIZE + TELEMETRY_CRC_SIZE) {
+        framing_error_count++;
+        return false;
+    }
+
+    size_t body = decoded - TELEMETRY_CRC_SIZE;
+    if (telemetry_crc16(frame, body) != get_u16(&frame[body])) {
+        crc_error_count++;
+        return false;
+    }
+
+    TelemetryHeader header;
+    header.type = frame[0];
+    header.record_size = frame[1];
+    header.count = frame[2];
+    header.sequence = get_u16(&frame[3]);
+    header.timestamp_us = get_u32(&frame[5]);
+    header.interval_us = get_u32(&frame[9]);
+    if (TELEMETRY_HEADER_SIZE + (size_t)header.record_size * header.count != body) {
+        framing_error_count++;
+        return false;
+    }
+
+    if (have_sequence) {
+        lost_count += (uint16_t)(header.sequence - last_header.sequence - 1);
+    }
+    have_sequence = true;
+    last_header = header;
+    packet_count++;
+    return true;
+}
@@ -0,0 +1,148 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*! \brief Binary telemetry packets for the Bluetooth UART link.
+ *
+ * A packet carries a batch of fixed-size records of one type. Its payload is a 13-byte header
+ * followed by the records, then a CRC-16/CCITT-FALSE of everything before it:
+ *
+ * | Offset | Size | Field                                                              |
+ * | ------ | ---- | ------------------------------------------------------------------ |
+ * | 0      | 1    | Record type (TelemetryType)                                        |
+ * | 1      | 1    | Record size in bytes                                               |
+ * | 2      | 1    | Number of records                                                  |
+ * | 3      | 2    | Sequence number, incremented for every packet sent                 |
+ * | 5      | 4    | Timestamp of the newest record (microseconds since boot, wrapping)  |
+ * | 9      | 4    | Interval between records in microseconds (0 if irregular)          |
+ * | 13     | n    | Records, oldest first                                              |
+ * | 13 + n | 2    | CRC                                                                |
+ *
+ * Multi-byte fields are little-endian. Records are copied as they are in memory, which is also
+ * little-endian on the RP2040 and on the hosts that decode them.
+ *
+ * On the wire, each packet is COBS encoded (so it contains no zero bytes) and followed by a single
+ * zero byte, which lets a receiver resynchronise at the next packet after any corruption or loss.
+ */
+enum TelemetryType {
+    TELEMETRY_ACCELERATION = 1, /*!< LIS3DHAcceleration records: X, Y, Z in milli-g (int16 each) */
+    TELEMETRY_BAND_ENERGY = 2   /*!< One uint32 energy per LED band, in the microphone task's compact units */
+};
+
+#define TELEMETRY_HEADER_SIZE 13
+#define TELEMETRY_CRC_SIZE 2
+#define TELEMETRY_MAX_RECORDS_SIZE 240 /*!< Record bytes one packet can carry */
+#define TELEMETRY_MAX_PAYLOAD (TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_RECORDS_SIZE + TELEMETRY_CRC_SIZE)
+/*! \brief Largest encoded packet: COBS adds a byte per 254 and the delimiter one more. */
+#define TELEMETRY_MAX_FRAME (TELEMETRY_MAX_PAYLOAD + TELEMETRY_MAX_PAYLOAD / 254 + 2)
+
+/*! \brief Header fields of a packet. */
+struct TelemetryHeader {
+    uint8_t type;
+    uint8_t record_size;
+    uint8_t count;
+    uint16_t sequence;
+    uint32_t timestamp_us;
+    uint32_t interval_us;
+};
+
+/*! \brief CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF). */
+uint16_t telemetry_crc16(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF);
+
+/*! \brief COBS encode `length` bytes, appending the zero delimiter.
+ *
+ * \param output Room for at least `length + length / 254 + 2` bytes.
+ * \return Bytes written, including the delimiter.
+ */
+size_t telemetry_cobs_encode(const uint8_t *input, size_t length, uint8_t *output);
+
+/*! \brief Decode one COBS block (without its delimiter) in place.
+ *
+ * \return The decoded length, or 0 if the block is malformed.
+ */
+size_t telemetry_cobs_decode(uint8_t *data, size_t length);
+
+/*! \brief Builds packets of records and frames them for sending.
+ *
+ * Records are added one at a time; `finish` then writes the framed packet and starts the sequence
+ * number for the next one.
+ */
+class TelemetryEncoder
+{
+public:
+    TelemetryEncoder();
+
+    /*! \brief Start a packet of `record_size`-byte records of `type`. Any unfinished packet is discarded. */
+    void begin(uint8_t type, uint8_t record_size);
+
+    /*! \brief Append one record.
+     *
+     * \return false (and the record is not added) if the packet is full.
+     */
+    bool add(const void *record);
+
+    /*! \brief Records that still fit in the packet. */
+    size_t space() const;
+
+    /*! \brief Records in the packet so far. */
+    uint8_t count() const { return payload[2]; }
+
+    /*! \brief Close the packet and write it, framed, to `frame` (at least TELEMETRY_MAX_FRAME bytes).
+     *
+     * \param timestamp_us Time the newest record was taken.
+     * \param interval_us Time between records, or 0 if they are not evenly spaced.
+     * \return Bytes written, including the delimiter.
+     */
+    size_t finish(uint32_t timestamp_us, uint32_t interval_us, uint8_t *frame);
+
+    /*! \brief Sequence number the next packet will carry. */
+    uint16_t next_sequence() const { return sequence; }
+
+private:
+    uint8_t payload[TELEMETRY_MAX_PAYLOAD]; /*!< Header and records of the packet being built */
+    size_t length;                          /*!< Bytes of `payload` used */
+    uint16_t sequence;
+};
+
+/*! \brief Reassembles packets from a byte stream and checks them.
+ *
+ * Feed every received byte to `push`. Damaged packets are dropped and counted, and the decoder
+ * resynchronises at the next delimiter. Sequence gaps between good packets are counted as lost.
+ */
+class TelemetryDecoder
+{
+public:
+    TelemetryDecoder();
+
+    /*! \brief Take one byte from the link.
+     *
+     * \return true when the byte completes a valid packet, which stays available through
+     *         `header` and `records` until the next call.
+     */
+    bool push(uint8_t byte);
+
+    const TelemetryHeader &header() const { return last_header; }
+    const uint8_t *records() const { return frame + TELEMETRY_HEADER_SIZE; }
+
+    uint32_t packets() const { return packet_count; }       /*!< Valid packets decoded */
+    uint32_t crc_errors() const { return crc_error_count; } /*!< Packets dropped for a bad CRC */
+    uint32_t framing_errors() const { return framing_error_count; } /*!< Malformed, truncated or oversized frames */
+    uint32_t lost() const { return lost_count; }            /*!< Packets missing from the sequence */
+
+private:
+    uint8_t frame[TELEMETRY_MAX_FRAME]; /*!< Bytes received since the last delimiter */
+    size_t length;
+    bool overflowed;                    /*!< The current frame is too long to be a packet */
+    bool have_sequence;
+    TelemetryHeader last_header;
+    uint32_t packet_count;
+    uint32_t crc_error_count;
+    uint32_t framing_error_count;
+    uint32_t lost_count;
+
+    bool decode_frame();
+};
+
+#endif // TELEMETRY_H
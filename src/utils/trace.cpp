@@ -0,0 +1,142 @@
+#include "trace.h"
+
+#include <stdio.h>
+#include <atomic>
+#include "pico/platform.h"
+#include "hardware/sync.h"
+
+#define TRACE_NUM_CORES 2
+
+// Spans that have recorded, by the core that first recorded them. Each core only appends to its own list (with
+// interrupts disabled), so the lists need no lock; the count is published after the entry it covers.
+static TraceSpan *spans[TRACE_NUM_CORES][TRACE_MAX_SPANS];
+static std::atomic<uint32_t> span_counts[TRACE_NUM_CORES];
+
+static void register_span(TraceSpan *span)
+{
+    unsigned int core = get_core_num();
+    uint32_t interrupts = save_and_disable_interrupts();
+    uint32_t count = span_counts[core].load(std::memory_order_relaxed);
+    if (count < TRACE_MAX_SPANS) {
+        spans[core][count] = span;
+        span_counts[core].store(count + 1, std::memory_order_release);
+    }
+    restore_interrupts(interrupts);
+}
+
+static_assert(TRACE_SUB_BUCKETS == 4, "bucket_index() takes two bits below the leading one");
+
+// Histogram bucket for a duration: exact up to TRACE_EXACT_BUCKETS, then TRACE_SUB_BUCKETS per power of two
+static unsigned int bucket_index(uint32_t duration_us)
+{
+    if (duration_us < TRACE_EXACT_BUCKETS) {
+        return duration_us;
+    }
+    unsigned int exponent = 31 - __builtin_clz(duration_us); // At least 3
+    if (exponent > TRACE_MAX_EXPONENT) {
+        return TRACE_NUM_BUCKETS - 1;
+    }
+    unsigned int sub_bucket = (duration_us >> (exponent - 2)) & (TRACE_SUB_BUCKETS - 1);
+    return TRACE_EXACT_BUCKETS + (exponent - 3) * TRACE_SUB_BUCKETS + sub_bucket;
+}
+
+// Longest duration that falls in a bucket
+static uint32_t bucket_upper_bound(unsigned int index)
+{
+    if (index < TRACE_EXACT_BUCKETS) {
+        return index;
+    }
+    if (index == TRACE_NUM_BUCKETS - 1) {
+        return UINT32_MAX;
+    }
+    unsigned int exponent = 3 + (index - TRACE_EXACT_BUCKETS) / TRACE_SUB_BUCKETS;
+    unsigned int sub_bucket = (index - TRACE_EXACT_BUCKETS) % TRACE_SUB_BUCKETS;
+    return ((TRACE_SUB_BUCKETS + sub_bucket + 1) << (exponent - 2)) - 1;
+}
+
+void TraceSpan::record(uint32_t duration_us)
+{
+    if (!registered) {
+        registered = true;
+        register_span(this);
+    }
+    sample_count++;
+    total_us += duration_us;
+    if (duration_us < min_us) {
+        min_us = duration_us;
+    }
+    if (duration_us > max_us) {
+        max_us = duration_us;
+    }
+    buckets[bucket_index(duration_us)]++;
+}
+
+void TraceSpan::reset()
+{
+    sample_count = 0;
+    min_us = UINT32_MAX;
+    max_us = 0;
+    total_us = 0;
+    for (uint32_t &bucket : buckets) {
+        bucket = 0;
+    }
+}
+
+uint32_t TraceSpan::percentile(unsigned int percent) const
+{
+    if (sample_count == 0) {
+        return 0;
+    }
+    // The smallest bucket holding at least `percent` of the runs, rounded up
+    uint64_t target = ((uint64_t)sample_count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < TRACE_NUM_BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= target && seen > 0) {
+            uint32_t bound = bucket_upper_bound(i);
+            return bound > max_us ? max_us : (bound < min() ? min() : bound);
+        }
+    }
+    return max_us;
+}
+
+size_t trace_span_count()
+{
+    size_t total = 0;
+    for (int core = 0; core < TRACE_NUM_CORES; ++core) {
+        total += span_counts[core].load(std::memory_order_acquire);
+    }
+    return total;
+}
+
+TraceSpan *trace_span(size_t index)
+{
+    for (int core = 0; core < TRACE_NUM_CORES; ++core) {
+        size_t count = span_counts[core].load(std::memory_order_acquire);
+        if (index < count) {
+            return spans[core][index];
+        }
+        index -= count;
+    }
+    return nullptr;
+}
+
+void trace_print_stats()
+{
+    printf("%-18s %8s %7s %7s %7s %7s %7s %7s\n", "span (us)", "count", "min", "p50", "p90", "p99", "max", "mean");
+    size_t count = trace_span_count();
+    for (size_t i = 0; i < count; ++i) {
+        const TraceSpan *span = trace_span(i);
+        printf("%-18s %8u %7u %7u %7u %7u %7u %7u\n", span->name(), (unsigned)span->count(), (unsigned)span->min(),
+               (unsigned)span->percentile(50), (unsigned)span->percentile(90), (unsigned)span->percentile(99),
+               (unsigned)span->max(), (unsigned)span->mean());
+    }
+}
+
+void trace_reset()
+{
+    size_t count = trace_span_count();
+    for (size_t i = 0; i < count; ++i) {
+        trace_span(i)->reset();
+    }
+}
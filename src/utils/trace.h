@@ -0,0 +1,122 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#ifdef TEST_HARNESS
+#include <chrono>
+#else
+#include "hardware/timer.h"
+#endif
+
+/*! \brief Set to 0 to compile every TRACE_SPAN out. */
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+#define TRACE_MAX_SPANS 16        /*!< Spans per core that trace_print_stats() can list */
+#define TRACE_EXACT_BUCKETS 8     /*!< Durations below this many microseconds get a bucket each */
+#define TRACE_SUB_BUCKETS 4       /*!< Buckets per power of two above that (durations are within 25%) */
+#define TRACE_MAX_EXPONENT 23     /*!< Durations of 2^24 us (about 17 s) or more share the last bucket */
+#define TRACE_NUM_BUCKETS (TRACE_EXACT_BUCKETS + (TRACE_MAX_EXPONENT - 2) * TRACE_SUB_BUCKETS)
+
+/*! \brief Microsecond timestamp for tracing, wrapping every 71 minutes.
+ *
+ * On the RP2040 this reads the free-running hardware timer, which takes a few cycles. The test harness uses
+ * the host's steady clock rather than the mock clock, so spans measure real computation even when the mock
+ * clock is virtual.
+ */
+inline uint32_t trace_now_us()
+{
+#ifdef TEST_HARNESS
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    return time_us_32();
+#endif
+}
+
+/*! \brief Timing statistics for one traced stage.
+ *
+ * Every duration is counted in a fixed log-linear histogram (exact below TRACE_EXACT_BUCKETS us, then
+ * TRACE_SUB_BUCKETS buckets per power of two), alongside the exact minimum, maximum and total, so recording
+ * takes constant time and no memory is allocated. Percentiles are read from the histogram.
+ *
+ * A span is listed by trace_print_stats() from the first time it records. Each span should only be
+ * recorded from one core, and not from both an interrupt handler and the main program: the counters are
+ * updated without locks to keep tracing cheap.
+ */
+class TraceSpan
+{
+public:
+    constexpr explicit TraceSpan(const char *name)
+        : span_name(name), registered(false), sample_count(0), min_us(UINT32_MAX), max_us(0), total_us(0), buckets{}
+    {
+    }
+
+    /*! \brief Count one run of the stage that took `duration_us`. */
+    void record(uint32_t duration_us);
+
+    /*! \brief Forget everything recorded so far. */
+    void reset();
+
+    const char *name() const { return span_name; }
+    uint32_t count() const { return sample_count; }
+    uint32_t min() const { return sample_count ? min_us : 0; }
+    uint32_t max() const { return max_us; }
+    uint32_t mean() const { return sample_count ? (uint32_t)(total_us / sample_count) : 0; }
+
+    /*! \brief Duration that `percent` percent of the runs took no longer than (to within one bucket). */
+    uint32_t percentile(unsigned int percent) const;
+
+private:
+    const char *span_name;
+    bool registered;              /*!< Listed for trace_print_stats() */
+    uint32_t sample_count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t buckets[TRACE_NUM_BUCKETS];
+};
+
+/*! \brief Times its own lifetime into a span. Use TRACE_SPAN rather than creating one directly. */
+class TraceScope
+{
+public:
+    explicit TraceScope(TraceSpan &span) : span(span), start_us(trace_now_us()) {}
+    ~TraceScope() { span.record(trace_now_us() - start_us); }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    TraceSpan &span;
+    uint32_t start_us;
+};
+
+#define TRACE_JOIN_(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN_(a, b)
+
+/*! \brief Time from here to the end of the enclosing scope as the span `name` (a string literal).
+ *
+ * Each use has its own statically allocated span, so two uses with the same name are listed separately.
+ */
+#if TRACE_ENABLED
+#define TRACE_SPAN(name)                                                \
+    static TraceSpan TRACE_JOIN(trace_span_, __LINE__)(name);           \
+    TraceScope TRACE_JOIN(trace_scope_, __LINE__)(TRACE_JOIN(trace_span_, __LINE__))
+#else
+#define TRACE_SPAN(name) do { } while (0)
+#endif
+
+/*! \brief Print a table of every span's statistics (in microseconds) to stdout. */
+void trace_print_stats();
+
+/*! \brief Reset every span's statistics. Spans being recorded on the other core may keep a run or two. */
+void trace_reset();
+
+/*! \brief Number of spans that have recorded so far, and the span at `index` (listed core 0 first). */
+size_t trace_span_count();
+TraceSpan *trace_span(size_t index);
+
+#endif // TRACE_H
@@ -0,0 +1,545 @@
+// benchmarks.cpp
+// Host microbenchmarks for the DSP, LED, accelerometer and telemetry hot paths. Each benchmark runs its kernel for
+// at least --min-time-ms per repetition and reports the median of five repetitions as CSV on stdout:
+//
+//   benchmark,size,items,iterations,ns_per_iteration,ns_per_item
+//
+// `size` is the input size the kernel was given (samples, LEDs, bins, ...) and `items` the units of work one
+// iteration does, so ns_per_item can be compared across sizes. Save the output of a known-good build and pass it
+// back with --compare to fail (exit code 1) when any benchmark has slowed down by more than --tolerance percent.
+//
+// Options: --filter <text>  only run benchmarks whose name contains <text>
+//          --min-time-ms <n>  time per repetition (default 50)
+//          --compare <baseline.csv> [--tolerance <percent>]  check for regressions (default tolerance 15%)
+//
+// A second table compares the band energies of the microphone's two analyzers (FFT and Goertzel) for tones and
+// noise, as signal,band,hz,fft_energy,goertzel_energy,difference_db; --compare ignores it.
+//
+// Host timings do not predict RP2040 timings, but they do show whether a change made a kernel faster or slower.
+// Build the harness with optimisation (e.g. CMAKE_BUILD_TYPE=Release) for meaningful numbers.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "tasks/task_manager.h"
+#include "board.h"
+#include "tasks/led_task.h"
+#include "drivers/leds.h"
+#include "drivers/led_color.h"
+#include "drivers/lis3dh.h"
+#include "dsp/pre_fft.h"
+#include "dsp/window.h"
+#include "dsp/band_energy.h"
+#include "dsp/spectrum_analyzer.h"
+#include "dsp/goertzel_analyzer.h"
+#include "utils/spsc_ring.h"
+#include "utils/telemetry.h"
+#include "unit/pre_fft_reference.h"
+#if BENCHMARK_HAVE_CMSIS_DSP
+#include "arm_math.h"
+#endif
+
+// The globals the LED task shares with main.cpp
+volatile Tasks current_task = LED_TASK;
+LEDs led_strip(LED_PIN, NUM_LEDS, pio0, 0);
+
+// Stop the compiler from discarding a result, or from assuming memory is unchanged between iterations
+template <typename T>
+static inline void keep(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static const void *volatile sink;
+    sink = &value;
+#endif
+}
+
+struct Result {
+    std::string name;
+    size_t size;
+    size_t items;
+    uint64_t iterations;
+    double ns_per_iteration;
+    double ns_per_item() const { return ns_per_iteration / (items ? items : 1); }
+};
+
+static const char *filter = nullptr;
+static double min_time_ns = 50e6;
+static std::vector<Result> results;
+
+// Time `body` (one iteration, doing `items` units of work on an input of `size`) and record the result
+template <typename Body>
+static void run(const char *name, size_t size, size_t items, Body body)
+{
+    if (filter != nullptr && strstr(name, filter) == nullptr) {
+        return;
+    }
+    using clock = std::chrono::steady_clock;
+
+    // Find an iteration count that takes at least the minimum time
+    uint64_t iterations = 1;
+    while (true) {
+        clock::time_point start = clock::now();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            body();
+        }
+        double elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        if (elapsed >= min_time_ns || iterations >= (1ull << 40)) {
+            break;
+        }
+        iterations *= elapsed > 0 ? std::max<uint64_t>(2, std::min<uint64_t>(100, (uint64_t)(min_time_ns / elapsed) + 1)) : 100;
+    }
+
+    // Take the median of several repetitions, which ignores the odd interruption by the host
+    const int repetitions = 5;
+    double times[repetitions];
+    for (double &time : times) {
+        clock::time_point start = clock::now();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            body();
+        }
+        time = std::chrono::duration<double, std::nano>(clock::now() - start).count() / iterations;
+    }
+    std::sort(times, times + repetitions);
+
+    Result result = {name, size, items, iterations, times[repetitions / 2]};
+    printf("%s,%zu,%zu,%llu,%.2f,%.3f\n", name, size, items, (unsigned long long)iterations, result.ns_per_iteration,
+           result.ns_per_item());
+    fflush(stdout);
+    results.push_back(result);
+}
+
+// Deterministic pseudo-random test data
+static uint32_t random_state = 12345;
+static uint32_t next_random()
+{
+    random_state = random_state * 1664525u + 1013904223u;
+    return random_state >> 8;
+}
+
+// --- LED colour
+
+// The floating point colour wheel calculation that the compile-time table replaced (see led_color.h)
+static RGBColor hue_to_rgb_float(unsigned int hue, float value)
+{
+    float h = (hue % 360) / 60.0f;
+    int i = (int)h;
+    float f = h - (float)i;
+    float p = 0;
+    float q = value * (1 - f);
+    float t = value * f;
+    switch (i) {
+    case 0: return {(uint8_t)value, (uint8_t)t, (uint8_t)p};
+    case 1: return {(uint8_t)q, (uint8_t)value, (uint8_t)p};
+    case 2: return {(uint8_t)p, (uint8_t)value, (uint8_t)t};
+    case 3: return {(uint8_t)p, (uint8_t)q, (uint8_t)value};
+    case 4: return {(uint8_t)t, (uint8_t)p, (uint8_t)value};
+    default: return {(uint8_t)value, (uint8_t)p, (uint8_t)q};
+    }
+}
+
+static void benchmark_led_colour()
+{
+    run("hue_to_rgb/table", 360, 360, [] {
+        for (unsigned int hue = 0; hue < 360; ++hue) {
+            uint8_t red, green, blue;
+            hueToRGB(hue, &red, &green, &blue);
+            keep(red);
+            keep(green);
+            keep(blue);
+        }
+    });
+    volatile float brightness = 200.0f;
+    run("hue_to_rgb/float", 360, 360, [&] {
+        float value = brightness;
+        for (unsigned int hue = 0; hue < 360; ++hue) {
+            RGBColor colour = hue_to_rgb_float(hue, value);
+            keep(colour);
+        }
+    });
+
+    for (unsigned int num_leds : {12u, 60u, 144u}) {
+        LEDs strip(LED_PIN, num_leds, pio0, 1);
+        uint8_t level = 0;
+        run("leds/set_color", num_leds, num_leds, [&] {
+            for (unsigned int led = 0; led < num_leds; ++led) {
+                strip.setColor(led, level, (uint8_t)(level + 85), (uint8_t)(level + 170));
+            }
+            level++;
+            keep(strip);
+        });
+    }
+}
+
+// --- Microphone DSP
+
+template <size_t N>
+static void benchmark_dsp_size()
+{
+    static constexpr std::array<int16_t, N> window = make_hann_window_q15<N>();
+    alignas(4) static uint16_t raw[N];
+    alignas(4) static int16_t windowed[N];
+    for (size_t i = 0; i < N; ++i) {
+        raw[i] = (uint16_t)(DC_OFFSET + (int)(next_random() % 1024) - 512);
+    }
+
+    PreFftState state;
+    pre_fft_init(&state, DC_OFFSET, 0);
+    run("pre_fft/fused", N, N, [&] {
+        pre_fft_process(&state, raw, window.data(), windowed, N);
+        keep(windowed);
+    });
+    if constexpr (N <= PRE_FFT_REFERENCE_SAMPLE_SIZE) {
+        // The original driver offset loop and the task's separate passes
+        static int16_t offset[N];
+        run("pre_fft/reference", N, N, [&] {
+            old_read_blocking_offset(raw, offset, N);
+            keep(old_pre_fft_passes(offset, window.data(), windowed, N));
+            keep(windowed);
+        });
+    }
+
+    // A spectrum of N / 2 complex bins (plus Nyquist), as arm_rfft_q15 leaves it
+    alignas(4) static int16_t spectrum[2 * N];
+    for (size_t i = 0; i < 2 * N; ++i) {
+        spectrum[i] = (int16_t)(next_random() % 2048) - 1024;
+    }
+    const auto edges = make_log_band_edges<NUM_LEDS>(N, MIC_SAMPLE_RATE, LED_BAND_LOW_HZ, MIC_SAMPLE_RATE / 2.0);
+    uint64_t energy[NUM_LEDS];
+    size_t bins = edges[NUM_LEDS] - edges[0];
+    run("band_energy_q15", N, bins, [&] {
+        band_energy_q15(spectrum, edges.data(), NUM_LEDS, energy);
+        keep(energy);
+    });
+
+#if BENCHMARK_HAVE_CMSIS_DSP
+    arm_rfft_instance_q15 fft;
+    arm_rfft_init_q15(&fft, N, 0, 1);
+    alignas(4) static q15_t input[N];
+    alignas(4) static q15_t output[2 * N];
+    run("arm_rfft_q15", N, N, [&] {
+        memcpy(input, windowed, sizeof(input));  // The transform overwrites its input
+        arm_rfft_q15(&fft, input, output);
+        keep(output);
+    });
+    alignas(4) static q15_t magnitudes[N / 2];
+    run("arm_cmplx_mag_squared_q15", N, N / 2, [&] {
+        arm_cmplx_mag_squared_q15(spectrum, magnitudes, N / 2);
+        keep(magnitudes);
+    });
+#endif
+}
+
+static void benchmark_dsp()
+{
+    benchmark_dsp_size<256>();
+    benchmark_dsp_size<512>();
+    benchmark_dsp_size<1024>();
+    benchmark_dsp_size<2048>();
+}
+
+// --- Microphone analyzers: the FFT path against one Goertzel resonator per band
+
+#define ANALYZER_FFT_SIZE 1024
+#define ANALYZER_FFT_HOP 256
+#define ANALYZER_GOERTZEL_HOP 128
+#define ANALYZER_SIGNAL_LENGTH 16384
+#define ANALYZER_AMPLITUDE 256
+
+using FftAnalyzer = SpectrumAnalyzer<ANALYZER_FFT_SIZE, ANALYZER_FFT_HOP, NUM_LEDS>;
+using BandAnalyzer = GoertzelAnalyzer<ANALYZER_FFT_SIZE, ANALYZER_GOERTZEL_HOP, NUM_LEDS>;
+static constexpr auto analyzer_edges =
+    make_log_band_edges<NUM_LEDS>(ANALYZER_FFT_SIZE, MIC_SAMPLE_RATE, LED_BAND_LOW_HZ, MIC_SAMPLE_RATE / 2.0);
+static FftAnalyzer fft_analyzer(analyzer_edges, DC_OFFSET);
+static BandAnalyzer goertzel_analyzer(analyzer_edges, DC_OFFSET);
+alignas(4) static uint16_t analyzer_signal[ANALYZER_SIGNAL_LENGTH];
+
+// Fill the test signal with a tone at `hz`, or with white noise if `hz` is 0
+static void make_analyzer_signal(double hz)
+{
+    for (size_t i = 0; i < ANALYZER_SIGNAL_LENGTH; ++i) {
+        double value = hz > 0 ? ANALYZER_AMPLITUDE * sin(2.0 * CONSTEXPR_PI * hz * i / MIC_SAMPLE_RATE)
+                              : (double)(next_random() % (2 * ANALYZER_AMPLITUDE + 1)) - ANALYZER_AMPLITUDE;
+        analyzer_signal[i] = (uint16_t)(DC_OFFSET + (int)lround(value));
+    }
+}
+
+// Mean band energies (as real numbers) from `analyzer` over the second half of the test signal
+template <typename Analyzer>
+static void mean_band_energy(Analyzer &analyzer, double *mean)
+{
+    analyzer.reset();
+    std::fill(mean, mean + NUM_LEDS, 0.0);
+    size_t frames = 0;
+    for (size_t start = 0; start + Analyzer::hop_size <= ANALYZER_SIGNAL_LENGTH; start += Analyzer::hop_size) {
+        if (!analyzer.analyse_hop(analyzer_signal + start) || start < ANALYZER_SIGNAL_LENGTH / 2) {
+            continue;
+        }
+        for (size_t band = 0; band < NUM_LEDS; ++band) {
+            mean[band] += analyzer.band_energy()[band] / BAND_ENERGY_ONE;
+        }
+        frames++;
+    }
+    for (size_t band = 0; band < NUM_LEDS; ++band) {
+        mean[band] /= frames ? frames : 1;
+    }
+}
+
+// Time one output frame of each analyzer. Frames come every hop, and the hops differ, so compare ns_per_item
+// (per sample) for the processor load.
+static void benchmark_analyzers()
+{
+    make_analyzer_signal(0);
+    size_t position = 0;
+#if BENCHMARK_HAVE_CMSIS_DSP
+    fft_analyzer.reset();
+    run("mic_analyzer/fft", ANALYZER_FFT_SIZE, ANALYZER_FFT_HOP, [&] {
+        keep(fft_analyzer.analyse_hop(analyzer_signal + position));
+        keep(fft_analyzer.band_energy());
+        position = (position + ANALYZER_FFT_HOP) % ANALYZER_SIGNAL_LENGTH;
+    });
+#endif
+    goertzel_analyzer.reset();
+    position = 0;
+    run("mic_analyzer/goertzel", ANALYZER_FFT_SIZE, ANALYZER_GOERTZEL_HOP, [&] {
+        keep(goertzel_analyzer.analyse_hop(analyzer_signal + position));
+        keep(goertzel_analyzer.band_energy());
+        position = (position + ANALYZER_GOERTZEL_HOP) % ANALYZER_SIGNAL_LENGTH;
+    });
+}
+
+// Compare the band energies of the two analyzers: for a tone at each band's centre (in that band) and for white
+// noise (in every band). Printed as a second CSV table after the benchmarks.
+static void print_analyzer_accuracy()
+{
+    if (filter != nullptr && strstr("mic_analyzer/accuracy", filter) == nullptr) {
+        return;
+    }
+    printf("\nsignal,band,hz,fft_energy,goertzel_energy,difference_db\n");
+    double fft_energy[NUM_LEDS], goertzel_energy[NUM_LEDS];
+    const double bin_hz = (double)MIC_SAMPLE_RATE / ANALYZER_FFT_SIZE;
+    for (size_t band = 0; band < NUM_LEDS; ++band) {
+        double hz = (analyzer_edges[band] + analyzer_edges[band + 1]) / 2.0 * bin_hz;
+        make_analyzer_signal(hz);
+        mean_band_energy(fft_analyzer, fft_energy);
+        mean_band_energy(goertzel_analyzer, goertzel_energy);
+        printf("tone,%zu,%.0f,%.6g,%.6g,%+.2f\n", band, hz, fft_energy[band], goertzel_energy[band],
+               10.0 * log10(goertzel_energy[band] / fft_energy[band]));
+    }
+    make_analyzer_signal(0);
+    mean_band_energy(fft_analyzer, fft_energy);
+    mean_band_energy(goertzel_analyzer, goertzel_energy);
+    for (size_t band = 0; band < NUM_LEDS; ++band) {
+        double hz = (analyzer_edges[band] + analyzer_edges[band + 1]) / 2.0 * bin_hz;
+        printf("noise,%zu,%.0f,%.6g,%.6g,%+.2f\n", band, hz, fft_energy[band], goertzel_energy[band],
+               10.0 * log10(goertzel_energy[band] / fft_energy[band]));
+    }
+}
+
+// --- Accelerometer
+
+// These time the host only. How many RP2040 cycles per sample the integer conversion saves over the soft-float one
+// has not been measured yet; that needs the firmware timing the two loops on the board.
+static void benchmark_accelerometer()
+{
+    LIS3DH lis3dh(I2C_PORT, LIS3DH_I2C_ADDRESS, I2C_SDA_PIN, I2C_SCL_PIN);
+    for (int count : {1, LIS3DH_FIFO_DEPTH, 256}) {
+        std::vector<LIS3DHSample> samples(count);
+        for (LIS3DHSample &sample : samples) {
+            sample = {(int16_t)(next_random() % 1024 - 512), (int16_t)(next_random() % 1024 - 512),
+                      (int16_t)(next_random() % 1024 - 512)};
+        }
+        std::vector<LIS3DHAcceleration> accelerations(count);
+        run("lis3dh/to_mg_integer", count, count, [&] {
+            lis3dh.convert_to_mg(samples.data(), accelerations.data(), count);
+            keep(accelerations[0]);
+        });
+
+        // The floating point conversion done by read_acceleration_g()
+        std::vector<float> g(3 * count);
+        volatile float g_per_digit_source = lis3dh.sensitivity_mg() * 0.001f;
+        run("lis3dh/to_g_float", count, count, [&] {
+            const float g_per_digit = g_per_digit_source;
+            for (int i = 0; i < count; ++i) {
+                g[3 * i] = samples[i].x * g_per_digit;
+                g[3 * i + 1] = samples[i].y * g_per_digit;
+                g[3 * i + 2] = samples[i].z * g_per_digit;
+            }
+            keep(g[0]);
+        });
+    }
+}
+
+// --- Inter-core queue and telemetry
+
+template <size_t CAPACITY>
+static void benchmark_spsc_ring()
+{
+    static SpscRing<uint32_t, CAPACITY> ring;
+    run("spsc_ring/push_pop", CAPACITY, CAPACITY, [&] {
+        for (uint32_t i = 0; i < CAPACITY; ++i) {
+            ring.push(i);
+        }
+        uint32_t value;
+        while (ring.pop(value)) {
+            keep(value);
+        }
+    });
+
+    // Producer and consumer on different threads, as between the two cores
+    const uint32_t transfers = 1u << 18;
+    run("spsc_ring/two_threads", CAPACITY, transfers, [&] {
+        std::thread producer([&] {
+            for (uint32_t i = 0; i < transfers; ++i) {
+                while (!ring.push(i)) {
+                    std::this_thread::yield(); // Lets a single-CPU host make progress
+                }
+            }
+        });
+        uint32_t received = 0, value;
+        while (received < transfers) {
+            if (ring.pop(value)) {
+                received++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        keep(value);
+    });
+}
+
+static void benchmark_telemetry()
+{
+    const size_t per_packet = TELEMETRY_MAX_RECORDS_SIZE / sizeof(LIS3DHAcceleration);
+    std::vector<LIS3DHAcceleration> samples(per_packet);
+    for (LIS3DHAcceleration &sample : samples) {
+        sample = {(int16_t)(next_random() % 2000 - 1000), (int16_t)(next_random() % 2000 - 1000),
+                  (int16_t)(next_random() % 2000 - 1000)};
+    }
+
+    TelemetryEncoder encoder;
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    size_t frame_length = 0;
+    run("telemetry/encode", per_packet, per_packet, [&] {
+        encoder.begin(TELEMETRY_ACCELERATION, sizeof(LIS3DHAcceleration));
+        for (const LIS3DHAcceleration &sample : samples) {
+            encoder.add(&sample);
+        }
+        frame_length = encoder.finish(0, 40000, frame);
+        keep(frame);
+    });
+
+    // Decode a stream of 16 packets, timed per byte
+    std::vector<uint8_t> stream;
+    for (int packet = 0; packet < 16; ++packet) {
+        encoder.begin(TELEMETRY_ACCELERATION, sizeof(LIS3DHAcceleration));
+        for (const LIS3DHAcceleration &sample : samples) {
+            encoder.add(&sample);
+        }
+        frame_length = encoder.finish(packet * 1000000u, 40000, frame);
+        stream.insert(stream.end(), frame, frame + frame_length);
+    }
+    TelemetryDecoder decoder;
+    run("telemetry/decode", per_packet, stream.size(), [&] {
+        for (uint8_t byte : stream) {
+            keep(decoder.push(byte));
+        }
+    });
+}
+
+// --- Regression check
+
+static bool compare_with_baseline(const char *path, double tolerance_percent)
+{
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+    std::map<std::pair<std::string, size_t>, double> baseline;
+    char line[512];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        char name[256];
+        size_t size, items;
+        unsigned long long iterations;
+        double ns_per_iteration, ns_per_item;
+        if (sscanf(line, "%255[^,],%zu,%zu,%llu,%lf,%lf", name, &size, &items, &iterations, &ns_per_iteration,
+                   &ns_per_item) == 6) {
+            baseline[{name, size}] = ns_per_item;
+        }
+    }
+    fclose(file);
+
+    bool passed = true;
+    for (const Result &result : results) {
+        auto entry = baseline.find({result.name, result.size});
+        if (entry == baseline.end() || entry->second <= 0) {
+            continue;
+        }
+        double change = 100.0 * (result.ns_per_item() - entry->second) / entry->second;
+        if (change > tolerance_percent) {
+            fprintf(stderr, "REGRESSION %s (size %zu): %.3f ns/item, was %.3f (%+.1f%%)\n", result.name.c_str(),
+                    result.size, result.ns_per_item(), entry->second, change);
+            passed = false;
+        }
+    }
+    fprintf(stderr, passed ? "No regressions beyond %.0f%%\n" : "Regressions beyond %.0f%% found\n",
+            tolerance_percent);
+    return passed;
+}
+
+int main(int argc, char **argv)
+{
+    const char *baseline = nullptr;
+    double tolerance = 15.0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc) {
+            min_time_ns = atof(argv[++i]) * 1e6;
+        } else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--filter <text>] [--min-time-ms <n>] [--compare <baseline.csv> "
+                            "[--tolerance <percent>]]\n", argv[0]);
+            return 2;
+        }
+    }
+#ifndef __OPTIMIZE__
+    fprintf(stderr, "Warning: built without optimisation, so the timings say little about the firmware\n");
+#endif
+#if !BENCHMARK_HAVE_CMSIS_DSP
+    fprintf(stderr, "CMSIS-DSP not available: the arm_rfft_q15, arm_cmplx_mag_squared_q15 and mic_analyzer/fft benchmarks are left "
+                    "out\n");
+#endif
+
+    printf("benchmark,size,items,iterations,ns_per_iteration,ns_per_item\n");
+    benchmark_led_colour();
+    benchmark_dsp();
+    benchmark_analyzers();
+    benchmark_accelerometer();
+    benchmark_spsc_ring<8>();
+    benchmark_spsc_ring<256>();
+    benchmark_telemetry();
+    print_analyzer_accuracy();
+
+    if (baseline != nullptr && !compare_with_baseline(baseline, tolerance)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+#include "hardware/pio.h"
+
+extern pio_program_t ws2812_program;
+
+void ws2812_program_init(PIO pio, unsigned int sm, unsigned int offset, unsigned int pin, float freq, bool rgbw);
+
+// Test harness only: print the latched LED frames' rate, interval jitter, latency and size since the last call
+void mock_ws2812_print_stats();
+
+// Test harness only: copy the words of the latest latched frame into `words` (at most `max_words`) and return how
+// many LEDs it had (0 before the first frame)
+uint32_t mock_ws2812_last_frame(uint32_t *words, uint32_t max_words);
@@ -0,0 +1,4 @@
+#pragma once
+
+// Host stand-in for CMSIS-DSP: the application does not use the constant FFT instances
+#include "arm_math.h"
@@ -0,0 +1,95 @@
+#include <math.h>
+#include <complex>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "arm_math.h"
+
+// Twiddle factors for an FFT length, as interleaved cos/sin pairs: e^(-2 pi i k / N) for k < N / 2. The tables are
+// function statics because analyzers are static objects, which may be constructed before this file's globals.
+static const double *twiddles_for_length(uint32_t length)
+{
+    static std::map<uint32_t, std::vector<double>> twiddle_tables;
+    static std::mutex twiddle_mutex;
+    std::lock_guard<std::mutex> guard(twiddle_mutex);
+    std::vector<double> &table = twiddle_tables[length];
+    if (table.empty()) {
+        table.resize(length);
+        for (uint32_t k = 0; k < length / 2; ++k) {
+            double angle = -2.0 * M_PI * k / length;
+            table[2 * k] = cos(angle);
+            table[2 * k + 1] = sin(angle);
+        }
+    }
+    return table.data();
+}
+
+arm_status arm_rfft_init_q15(arm_rfft_instance_q15 *S, uint32_t fftLenReal, uint32_t ifftFlagR, uint32_t bitReverseFlag)
+{
+    if (fftLenReal < 32 || fftLenReal > 8192 || (fftLenReal & (fftLenReal - 1)) != 0 || ifftFlagR != 0) {
+        return ARM_MATH_ARGUMENT_ERROR;
+    }
+    S->fftLenReal = fftLenReal;
+    S->ifftFlagR = (uint8_t)ifftFlagR;
+    S->bitReverseFlagR = (uint8_t)bitReverseFlag;
+    S->pTwiddle = twiddles_for_length(fftLenReal);
+    return ARM_MATH_SUCCESS;
+}
+
+static q15_t round_to_q15(double value)
+{
+    double rounded = floor(value + 0.5);
+    if (rounded > 32767.0) {
+        return 32767;
+    }
+    if (rounded < -32768.0) {
+        return -32768;
+    }
+    return (q15_t)rounded;
+}
+
+void arm_rfft_q15(const arm_rfft_instance_q15 *S, q15_t *pSrc, q15_t *pDst)
+{
+    const uint32_t length = S->fftLenReal;
+    const std::complex<double> *twiddle = reinterpret_cast<const std::complex<double> *>(S->pTwiddle);
+
+    // Iterative radix-2 FFT, with the input in bit-reversed order
+    thread_local std::vector<std::complex<double>> data;
+    data.resize(length);
+    unsigned int bits = 0;
+    while ((1u << bits) < length) {
+        bits++;
+    }
+    for (uint32_t i = 0; i < length; ++i) {
+        uint32_t reversed = 0;
+        for (unsigned int bit = 0; bit < bits; ++bit) {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+        data[reversed] = std::complex<double>(pSrc[i], 0.0);
+    }
+    for (uint32_t span = 1; span < length; span *= 2) {
+        uint32_t stride = length / (2 * span);
+        for (uint32_t start = 0; start < length; start += 2 * span) {
+            for (uint32_t k = 0; k < span; ++k) {
+                std::complex<double> odd = data[start + span + k] * twiddle[k * stride];
+                data[start + span + k] = data[start + k] - odd;
+                data[start + k] += odd;
+            }
+        }
+    }
+
+    for (uint32_t k = 0; k < length; ++k) {
+        pDst[2 * k] = round_to_q15(data[k].real() / length);
+        pDst[2 * k + 1] = round_to_q15(data[k].imag() / length);
+    }
+}
+
+void arm_cmplx_mag_squared_q15(const q15_t *pSrc, q15_t *pDst, uint32_t numSamples)
+{
+    for (uint32_t i = 0; i < numSamples; ++i) {
+        q31_t real = pSrc[2 * i];
+        q31_t imag = pSrc[2 * i + 1];
+        pDst[i] = (q15_t)(((q63_t)(real * real) + (q63_t)(imag * imag)) >> 17);
+    }
+}
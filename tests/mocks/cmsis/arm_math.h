@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host stand-in for the parts of CMSIS-DSP that the application uses, so that the test harness builds without the
+// CMSIS-DSP submodule. CMakeLists.txt only puts this directory on the include path when the real library is not
+// available.
+//
+// The real FFT is fixed point and scales down by 2 at every butterfly stage. This one computes the same transform
+// in double precision and rounds the result, so it has the same scaling (the output is the DFT divided by the
+// length) but can differ from CMSIS-DSP by a few least significant bits, mostly in quiet bins.
+
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+typedef int64_t q63_t;
+typedef float float32_t;
+
+typedef enum {
+    ARM_MATH_SUCCESS = 0,
+    ARM_MATH_ARGUMENT_ERROR = -1
+} arm_status;
+
+// Real FFT instance. The twiddle factors are shared by every instance of the same length.
+typedef struct {
+    uint32_t fftLenReal;
+    uint8_t ifftFlagR;
+    uint8_t bitReverseFlagR;
+    const double *pTwiddle;
+} arm_rfft_instance_q15;
+
+// Only forward transforms (ifftFlagR = 0) of 32 to 8192 points are supported
+arm_status arm_rfft_init_q15(arm_rfft_instance_q15 *S, uint32_t fftLenReal, uint32_t ifftFlagR, uint32_t bitReverseFlag);
+
+// Transform fftLenReal real Q15 samples into fftLenReal interleaved complex bins (the upper half being the complex
+// conjugate of the lower half), scaled by 1 / fftLenReal. Like CMSIS-DSP, pSrc may be used as scratch.
+void arm_rfft_q15(const arm_rfft_instance_q15 *S, q15_t *pSrc, q15_t *pDst);
+
+// Squared magnitude of complex Q15 values, in 3.13 format (bit-exact with CMSIS-DSP)
+void arm_cmplx_mag_squared_q15(const q15_t *pSrc, q15_t *pDst, uint32_t numSamples);
@@ -0,0 +1,62 @@
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include "events.h"
+#include "pico/time.h"
+
+// A callback waiting for the virtual clock
+struct MockEvent {
+    uint64_t due_us;
+    uint64_t sequence;      // Order of queueing, to break ties between callbacks due at the same time
+    std::function<void()> callback;
+
+    bool operator>(const MockEvent &other) const
+    {
+        return due_us != other.due_us ? due_us > other.due_us : sequence > other.sequence;
+    }
+};
+
+static std::mutex queue_mutex;
+static std::priority_queue<MockEvent, std::vector<MockEvent>, std::greater<MockEvent>> event_queue;
+static uint64_t next_sequence = 0;
+
+void mock_run_after_us(uint64_t delay_us, std::function<void()> callback)
+{
+    if (mock_clock_is_virtual()) {
+        uint64_t due_us = time_us_64() + delay_us;
+        std::lock_guard<std::mutex> guard(queue_mutex);
+        event_queue.push(MockEvent{due_us, next_sequence++, std::move(callback)});
+        return;
+    }
+
+    std::thread worker([delay_us, callback]() {
+        std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
+        callback();
+    });
+    worker.detach();
+}
+
+bool mock_events_take_due(uint64_t time_us, uint64_t *due_us, std::function<void()> *callback)
+{
+    std::lock_guard<std::mutex> guard(queue_mutex);
+    if (event_queue.empty() || event_queue.top().due_us > time_us) {
+        return false;
+    }
+    *due_us = event_queue.top().due_us;
+    *callback = event_queue.top().callback;
+    event_queue.pop();
+    return true;
+}
+
+bool mock_events_next_due(uint64_t *due_us)
+{
+    std::lock_guard<std::mutex> guard(queue_mutex);
+    if (event_queue.empty()) {
+        return false;
+    }
+    *due_us = event_queue.top().due_us;
+    return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+
+// Run `callback` once `delay_us` microseconds have elapsed, without blocking the caller. This is used to emulate
+// hardware that completes in the background (e.g. a DMA transfer) and then raises an interrupt. The callback runs on
+// a separate thread, just like an interrupt handler would preempt the main program on the real device.
+//
+// With the virtual clock (see mock_clock_set_virtual), the callback is queued instead, and runs on core 0's thread
+// when the clock is moved past its due time. Callbacks due at the same time run in the order they were queued.
+void mock_run_after_us(uint64_t delay_us, std::function<void()> callback);
+
+// Test harness only: take the earliest queued callback if it is due at or before `time_us`, returning its due time
+// in `due_us`. Returns false if none is due. Used by the virtual clock to run the callbacks in order.
+bool mock_events_take_due(uint64_t time_us, uint64_t *due_us, std::function<void()> *callback);
+
+// Test harness only: due time of the earliest queued callback. Returns false if the queue is empty.
+bool mock_events_next_due(uint64_t *due_us);
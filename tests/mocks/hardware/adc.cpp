@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "hardware/adc.h"
+#include "pico/stdlib.h"
+
+#define MOCK_ADC_CLOCK_HZ 48000000.0f
+#define MOCK_ADC_MID_SCALE 2048
+
+static adc_hw_t mock_adc_hw;
+adc_hw_t *adc_hw = &mock_adc_hw;
+
+// Playback state
+static std::vector<uint16_t> samples;   // 12-bit ADC codes to play back
+static size_t position = 0;
+static bool loop_playback = true;
+static bool loaded = false;
+static std::mutex samples_mutex;
+
+static std::atomic<float> clkdiv(0.0f);
+static std::atomic<bool> running(false);
+static std::atomic<bool> dreq_enabled(false); // Results go to the FIFO and raise DMA requests (see adc_fifo_setup)
+static uint32_t blocking_reads = 0;
+
+// Convert a signed 16-bit PCM sample to a 12-bit ADC code centred on mid-scale
+static uint16_t pcm_to_adc(int16_t pcm)
+{
+    return (uint16_t)((pcm >> 4) + MOCK_ADC_MID_SCALE);
+}
+
+// Read a little-endian integer from a byte buffer
+static uint32_t read_le(const uint8_t *bytes, size_t length)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < length; ++i) {
+        value |= (uint32_t)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+// Fill `samples` with a 1 kHz tone at a quarter of full scale, one second long at the nominal rate
+static void load_test_tone()
+{
+    const float rate = 44100.0f;
+    samples.resize((size_t)rate);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        float phase = 2.0f * (float)M_PI * 1000.0f * (float)i / rate;
+        samples[i] = pcm_to_adc((int16_t)(8192.0f * sinf(phase)));
+    }
+    position = 0;
+    loaded = true;
+}
+
+bool mock_adc_load_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        printf("Debug: ADC could not open %s\n", path);
+        return false;
+    }
+    std::vector<uint8_t> bytes;
+    uint8_t chunk[4096];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        bytes.insert(bytes.end(), chunk, chunk + count);
+    }
+    fclose(file);
+
+    // Default to headerless raw audio, one channel
+    const uint8_t *data = bytes.data();
+    size_t data_length = bytes.size();
+    unsigned int channels = 1;
+
+    if (bytes.size() >= 12 && memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WAVE", 4) == 0) {
+        // Walk the RIFF chunks looking for the format and the audio data
+        bool have_format = false;
+        data_length = 0;
+        size_t offset = 12;
+        while (offset + 8 <= bytes.size()) {
+            const uint8_t *header = bytes.data() + offset;
+            size_t size = read_le(header + 4, 4);
+            size_t available = bytes.size() - offset - 8;
+            if (size > available) {
+                size = available;
+            }
+            if (memcmp(header, "fmt ", 4) == 0 && size >= 16) {
+                unsigned int format = read_le(header + 8, 2);
+                channels = read_le(header + 10, 2);
+                unsigned int rate = read_le(header + 12, 4);
+                unsigned int bits = read_le(header + 22, 2);
+                if (format != 1 || bits != 16 || channels == 0) {
+                    printf("Debug: ADC only supports 16-bit PCM WAV files (%s)\n", path);
+                    return false;
+                }
+                if (rate != (unsigned int)(mock_adc_sample_rate() + 0.5f)) {
+                    printf("Debug: %s is %u Hz, ADC is sampling at %.0f Hz\n", path, rate, mock_adc_sample_rate());
+                }
+                have_format = true;
+            } else if (memcmp(header, "data", 4) == 0) {
+                data = header + 8;
+                data_length = size;
+            }
+            offset += 8 + size + (size & 1); // Chunks are padded to an even length
+        }
+        if (!have_format) {
+            printf("Debug: %s has no format chunk\n", path);
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(samples_mutex);
+    size_t frame_bytes = 2 * channels;
+    samples.resize(data_length / frame_bytes);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = pcm_to_adc((int16_t)read_le(data + i * frame_bytes, 2));
+    }
+    position = 0;
+    loaded = true;
+    printf("Debug: ADC playing %zu samples from %s\n", samples.size(), path);
+    return true;
+}
+
+void mock_adc_set_loop(bool loop)
+{
+    loop_playback = loop;
+}
+
+bool mock_adc_finished()
+{
+    std::lock_guard<std::mutex> guard(samples_mutex);
+    return loaded && !loop_playback && position >= samples.size();
+}
+
+float mock_adc_sample_rate()
+{
+    // One conversion takes 96 ADC clocks, or (1 + div) clocks if that is longer
+    float div = clkdiv.load();
+    return MOCK_ADC_CLOCK_HZ / (div + 1.0f < 96.0f ? 96.0f : div + 1.0f);
+}
+
+bool mock_adc_running()
+{
+    return running.load() && dreq_enabled.load();
+}
+
+uint16_t mock_adc_next_sample()
+{
+    std::lock_guard<std::mutex> guard(samples_mutex);
+    if (samples.empty() || position >= samples.size()) {
+        if (!loop_playback || samples.empty()) {
+            return MOCK_ADC_MID_SCALE;
+        }
+        position = 0;
+    }
+    return samples[position++];
+}
+
+void adc_init()
+{
+    {
+        std::lock_guard<std::mutex> guard(samples_mutex);
+        if (loaded) {
+            return;
+        }
+    }
+    const char *path = getenv("MOCK_ADC_FILE");
+    if (path == nullptr || !mock_adc_load_file(path)) {
+        std::lock_guard<std::mutex> guard(samples_mutex);
+        load_test_tone();
+    }
+}
+
+void adc_gpio_init(unsigned int gpio)
+{
+    printf("Debug: initialised ADC on GPIO pin %u\n", gpio);
+}
+
+void adc_select_input(unsigned int input)
+{
+    printf("Debug: ADC input %u selected\n", input);
+}
+
+void adc_set_clkdiv(float div)
+{
+    clkdiv.store(div);
+}
+
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift)
+{
+    // The DMA paces itself from the sample rate, so only whether requests are raised at all matters here
+    dreq_enabled.store(en && dreq_en);
+}
+
+void adc_run(bool run)
+{
+    running.store(run);
+}
+
+uint16_t adc_fifo_get_blocking()
+{
+    // Pace the reads at roughly the conversion rate, sleeping in blocks to avoid oversleeping on every sample
+    const uint32_t block = 64;
+    if (++blocking_reads % block == 0) {
+        sleep_us((uint32_t)(block * 1000000.0f / mock_adc_sample_rate()));
+    }
+    return mock_adc_next_sample();
+}
+
+void adc_fifo_drain()
+{
+    // Nothing is queued in the mock FIFO: samples are generated when they are read
+}
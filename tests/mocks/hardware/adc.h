@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+// Register block, defined so that drivers can take the address of the FIFO for DMA
+typedef struct {
+    volatile uint32_t fifo;
+} adc_hw_t;
+extern adc_hw_t *adc_hw;
+
+// Functions defined to replicate the real API
+void adc_init();
+void adc_gpio_init(unsigned int gpio);
+void adc_select_input(unsigned int input);
+void adc_set_clkdiv(float clkdiv);
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift);
+void adc_run(bool run);
+uint16_t adc_fifo_get_blocking();
+void adc_fifo_drain();
+
+// Test harness only: the mock ADC plays back audio from a file instead of sampling a pin. Supported formats are
+// 16-bit PCM WAV (the first channel is used) and headerless signed 16-bit little-endian raw audio. If no file is
+// loaded, the file named by the MOCK_ADC_FILE environment variable is used, or else a 1 kHz test tone.
+bool mock_adc_load_file(const char *path);
+
+// Test harness only: whether playback restarts at the end of the file (default) or holds at mid-scale.
+void mock_adc_set_loop(bool loop);
+
+// Test harness only: true once a non-looping file has been played to the end.
+bool mock_adc_finished();
+
+// Test harness only: the conversion rate configured through adc_set_clkdiv(), in samples per second.
+float mock_adc_sample_rate();
+
+// Test harness only: true while the ADC is free-running with its FIFO and DMA requests enabled (see
+// adc_fifo_setup), i.e. generating DMA requests.
+bool mock_adc_running();
+
+// Test harness only: take the next conversion result (12 bits, 0-4095), as the DMA would from the FIFO.
+uint16_t mock_adc_next_sample();
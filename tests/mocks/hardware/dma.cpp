@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+#include <thread>
+
+#include "hardware/dma.h"
+#include "hardware/adc.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/i2c.h"
+#include "hardware/uart.h"
+#include "events.h"
+
+// State of one mock DMA channel
+struct mock_dma_channel {
+    bool claimed = false;
+    dma_channel_config config = {};
+    volatile void *write_addr = nullptr;
+    const volatile void *read_addr = nullptr;
+    uint32_t trans_count = 0;
+    bool busy = false;
+    bool irq_enabled[2] = {false, false}; // INTE0 and INTE1
+    bool irq_status = false;              // Raw interrupt status, shared by both lines as in INTR
+    uint32_t generation = 0; // Incremented on every start and abort, so stale completions can be ignored
+};
+
+static mock_dma_channel channels[NUM_DMA_CHANNELS];
+static std::recursive_mutex dma_mutex;
+
+static void start_transfer(unsigned int channel);
+
+// How long a transfer takes, given the peripheral that paces it
+static uint64_t transfer_duration_us(const mock_dma_channel &ch)
+{
+    switch (ch.config.dreq) {
+        case DREQ_ADC:
+            return (uint64_t)(ch.trans_count * 1000000.0f / mock_adc_sample_rate());
+        case DREQ_PIO0_TX0:
+        case DREQ_PIO0_TX0 + 1:
+        case DREQ_PIO0_TX0 + 2:
+        case DREQ_PIO0_TX3:
+            return (uint64_t)(ch.trans_count * mock_pio_word_period_us(ch.config.dreq - DREQ_PIO0_TX0));
+        case DREQ_UART0_TX:
+        case DREQ_UART1_TX:
+            return (uint64_t)(ch.trans_count * mock_uart_byte_period_us((ch.config.dreq - DREQ_UART0_TX) / 2));
+        case DREQ_I2C0_TX:
+        case DREQ_I2C0_RX:
+        case DREQ_I2C1_TX:
+        case DREQ_I2C1_RX:
+            return (uint64_t)(ch.trans_count * mock_i2c_byte_period_us((ch.config.dreq - DREQ_I2C0_TX) / 2));
+        default:
+            return 0;
+    }
+}
+
+// Move the data for a completed transfer
+static void copy_data(mock_dma_channel &ch)
+{
+    size_t element = (size_t)1 << ch.config.size;
+    uint8_t *write = (uint8_t *)ch.write_addr;
+    const uint8_t *read = (const uint8_t *)ch.read_addr;
+
+    for (uint32_t i = 0; i < ch.trans_count; ++i) {
+        uint32_t value = 0;
+        if (ch.config.dreq == DREQ_ADC) {
+            value = mock_adc_next_sample();
+        } else if (ch.config.dreq == DREQ_I2C0_RX || ch.config.dreq == DREQ_I2C1_RX) {
+            uint8_t byte = 0;
+            mock_i2c_dma_read((ch.config.dreq - DREQ_I2C0_TX) / 2, &byte);
+            value = byte;
+        } else {
+            memcpy(&value, read, element);
+        }
+        if (ch.config.dreq >= DREQ_PIO0_TX0 && ch.config.dreq <= DREQ_PIO0_TX3) {
+            // Writes to a TX FIFO go to the program running on that state machine
+            pio_sm_put_blocking(pio0, ch.config.dreq - DREQ_PIO0_TX0, value);
+        } else if (ch.config.dreq == DREQ_UART0_TX || ch.config.dreq == DREQ_UART1_TX) {
+            // Writes to the data register go out on the line
+            mock_uart_dma_write((ch.config.dreq - DREQ_UART0_TX) / 2, (uint8_t)value);
+        } else if (ch.config.dreq == DREQ_I2C0_TX || ch.config.dreq == DREQ_I2C1_TX) {
+            // Writes to data_cmd queue commands for the I2C controller
+            mock_i2c_dma_write((ch.config.dreq - DREQ_I2C0_TX) / 2, value);
+        } else {
+            memcpy(write, &value, element);
+        }
+        if (ch.config.read_increment) {
+            read += element;
+        }
+        if (ch.config.write_increment) {
+            write += element;
+        }
+    }
+
+    // Like the hardware, the address registers are left pointing after the last transfer
+    ch.write_addr = write;
+    ch.read_addr = read;
+}
+
+// Called when the transfer time has elapsed
+static void complete_transfer(unsigned int channel, uint32_t generation)
+{
+    unsigned int chain_to;
+    bool raise_irq[2];
+    {
+        std::lock_guard<std::recursive_mutex> guard(dma_mutex);
+        mock_dma_channel &ch = channels[channel];
+        if (ch.generation != generation || !ch.busy) {
+            return; // Aborted or restarted in the meantime
+        }
+
+        // The ADC only requests data while it is running, so a stopped ADC stalls the transfer
+        if (ch.config.dreq == DREQ_ADC && !mock_adc_running()) {
+            mock_run_after_us(1000, [channel, generation]() { complete_transfer(channel, generation); });
+            return;
+        }
+
+        // Received I2C data only arrives once the commands for it have been sent, so wait for the bytes
+        if (ch.config.dreq == DREQ_I2C0_RX || ch.config.dreq == DREQ_I2C1_RX) {
+            unsigned int index = (ch.config.dreq - DREQ_I2C0_TX) / 2;
+            if (mock_i2c_dma_rx_level(index) < ch.trans_count) {
+                uint64_t wait_us = (uint64_t)mock_i2c_byte_period_us(index) + 1;
+                mock_run_after_us(wait_us, [channel, generation]() { complete_transfer(channel, generation); });
+                return;
+            }
+        }
+
+        copy_data(ch);
+        ch.busy = false;
+        ch.irq_status = true;
+        raise_irq[0] = ch.irq_enabled[0];
+        raise_irq[1] = ch.irq_enabled[1];
+        chain_to = ch.config.chain_to;
+    }
+
+    // Chaining happens in hardware as soon as the transfer ends, before the interrupt is serviced
+    if (chain_to != channel) {
+        start_transfer(chain_to);
+    }
+    if (raise_irq[0]) {
+        mock_irq_raise(DMA_IRQ_0);
+    }
+    if (raise_irq[1]) {
+        mock_irq_raise(DMA_IRQ_1);
+    }
+}
+
+static void start_transfer(unsigned int channel)
+{
+    std::lock_guard<std::recursive_mutex> guard(dma_mutex);
+    mock_dma_channel &ch = channels[channel];
+    ch.busy = true;
+    uint32_t generation = ++ch.generation;
+    mock_run_after_us(transfer_duration_us(ch), [channel, generation]() { complete_transfer(channel, generation); });
+}
+
+int dma_claim_unused_channel(bool required)
+{
+    std::lock_guard<std::recursive_mutex> guard(dma_mutex);
+    for (int i = 0; i < NUM_DMA_CHANNELS; ++i) {
+        if (!channels[i].claimed) {
+            channels[i].claimed = true;
+            return i;
+        }
+    }
+    if (required) {
+        printf("Error: no DMA channels available\n");
+    }
+    return -1;
+}
+
+void dma_channel_unclaim(unsigned int channel)
+{
+    std::lock_guard<std::recursive_mutex> guard(dma_mutex);
+    channels[channel].claimed = false;
+}
+
+dma_channel_config dma_channel_get_default_config(unsigned int channel)
+{
+    // Same defaults as the SDK: 32-bit, read increment, no write increment, unpaced, chained to itself
+    dma_channel_config c = { DMA_SIZE_32, true, false, DREQ_FORCE, channel };
+    return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size)
+{
+    c->size = size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr)
+{
+    c->read_increment = incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr)
+{
+    c->write_increment = incr;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, unsigned int dreq)
+{
+    c->dreq = dreq;
+}
+
+void channel_config_set_chain_to(dma_channel_config *c, unsigned int chain_to)
+{
+    c->chain_to = chain_to;
+}
+
+void dma_channel_configure(unsigned int channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, unsigned int transfer_count, bool trigger)
+{
+    std::lock_guard<std::recursive_mutex> guard(dma_mutex);
+    mock_dma_channel &ch = channels[channel];
+    ch.config = *config;
+    ch.write_addr = write_addr;
+    ch.read_addr = read_addr;
+    ch.trans_count = transfer_count;
+    if (trigger) {
+        start_transfer(channel);
+    }
+}
+
+void dma_channel_set_read_addr(unsigned int channel, const volatile void *read_addr, bool trigger)
+{
+    std::lock_guard<std::recursive_mutex> guard(dma_mutex);
+    channels[channel].read_addr = read_addr;
+    if (trigger) {
+        start_transfer(channel);
+    }
+}
+
+void dma_channel_set_write_addr(unsigned int channel, volatile void *write_addr, bool trigger)
+{
+    std::lock_guard<std::recursive_mutex> guard(dma_mutex);
+    channels[channel].write_addr = write_addr;
+    if (trigger) {
+        start_transfer(channel);
+    }
+}
+
+void dma_channel_set_trans_count(unsigned int channel, uint32_t trans_count, bool trigger)
+{
+    std::lock_guard<std::recursive_mutex> guard(dma_mutex);
+    channels[channel].trans_count = trans_count;
+    if (trigger) {
+        start_transfer(channel);
+    }
+}
+
+void dma_channel_start(unsigned int channel)
+{
+    start_transfer(channel);
+}
+
+void dma_channel_abort(unsigned int channel)
+{
+    std::lock_guard<std::recursive_mutex> guard(dma_mutex);
+    channels[channel].busy = false;
+    channels[channel].generation++;
+}
+
+bool dma_channel_is_busy(unsigned int channel)
+{
+    std::lock_guard<std::recursive_mutex> guard(dma_mutex);
+    return channels[channel].busy;
+}
+
+void dma_channel_wait_for_finish_blocking(unsigned int channel)
+{
+    while (dma_channel_is_busy(channel)) {
+        std::this_thread::yield();
+    }
+}
+
+void dma_irqn_set_channel_enabled(unsigned int irq_index, unsigned int channel, bool enabled)
+{
+    std::lock_guard<std::recursive_mutex> guard(dma_mutex);
+    channels[channel].irq_enabled[irq_index] = enabled;
+}
+
+bool dma_irqn_get_channel_status(unsigned int irq_index, unsigned int channel)
+{
+    std::lock_guard<std::recursive_mutex> guard(dma_mutex);
+    return channels[channel].irq_status && channels[channel].irq_enabled[irq_index];
+}
+
+void dma_irqn_acknowledge_channel(unsigned int irq_index, unsigned int channel)
+{
+    // As on the RP2040, acknowledging on either line clears the raw status
+    std::lock_guard<std::recursive_mutex> guard(dma_mutex);
+    channels[channel].irq_status = false;
+}
+
+void dma_channel_set_irq0_enabled(unsigned int channel, bool enabled)
+{
+    dma_irqn_set_channel_enabled(0, channel, enabled);
+}
+
+bool dma_channel_get_irq0_status(unsigned int channel)
+{
+    return dma_irqn_get_channel_status(0, channel);
+}
+
+void dma_channel_acknowledge_irq0(unsigned int channel)
+{
+    dma_irqn_acknowledge_channel(0, channel);
+}
+
+void dma_channel_set_irq1_enabled(unsigned int channel, bool enabled)
+{
+    dma_irqn_set_channel_enabled(1, channel, enabled);
+}
+
+bool dma_channel_get_irq1_status(unsigned int channel)
+{
+    return dma_irqn_get_channel_status(1, channel);
+}
+
+void dma_channel_acknowledge_irq1(unsigned int channel)
+{
+    dma_irqn_acknowledge_channel(1, channel);
+}
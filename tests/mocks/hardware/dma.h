@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+
+#define NUM_DMA_CHANNELS 12
+
+// Data request signals used by the drivers (numbering matches the RP2040)
+#define DREQ_PIO0_TX0 0
+#define DREQ_PIO0_TX3 3
+#define DREQ_UART0_TX 20
+#define DREQ_UART0_RX 21
+#define DREQ_UART1_TX 22
+#define DREQ_UART1_RX 23
+#define DREQ_I2C0_TX 32
+#define DREQ_I2C0_RX 33
+#define DREQ_I2C1_TX 34
+#define DREQ_I2C1_RX 35
+#define DREQ_ADC 36
+#define DREQ_FORCE 63
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+// The mock keeps the channel configuration as plain fields rather than a packed CTRL register
+typedef struct {
+    enum dma_channel_transfer_size size;
+    bool read_increment;
+    bool write_increment;
+    unsigned int dreq;
+    unsigned int chain_to;
+} dma_channel_config;
+
+// Functions defined to replicate the real API
+int dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(unsigned int channel);
+dma_channel_config dma_channel_get_default_config(unsigned int channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_dreq(dma_channel_config *c, unsigned int dreq);
+void channel_config_set_chain_to(dma_channel_config *c, unsigned int chain_to);
+void dma_channel_configure(unsigned int channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, unsigned int transfer_count, bool trigger);
+void dma_channel_set_read_addr(unsigned int channel, const volatile void *read_addr, bool trigger);
+void dma_channel_set_write_addr(unsigned int channel, volatile void *write_addr, bool trigger);
+void dma_channel_set_trans_count(unsigned int channel, uint32_t trans_count, bool trigger);
+void dma_channel_start(unsigned int channel);
+void dma_channel_abort(unsigned int channel);
+bool dma_channel_is_busy(unsigned int channel);
+void dma_channel_wait_for_finish_blocking(unsigned int channel);
+void dma_channel_set_irq0_enabled(unsigned int channel, bool enabled);
+bool dma_channel_get_irq0_status(unsigned int channel);
+void dma_channel_acknowledge_irq0(unsigned int channel);
+void dma_channel_set_irq1_enabled(unsigned int channel, bool enabled);
+bool dma_channel_get_irq1_status(unsigned int channel);
+void dma_channel_acknowledge_irq1(unsigned int channel);
+void dma_irqn_set_channel_enabled(unsigned int irq_index, unsigned int channel, bool enabled);
+bool dma_irqn_get_channel_status(unsigned int irq_index, unsigned int channel);
+void dma_irqn_acknowledge_channel(unsigned int irq_index, unsigned int channel);
@@ -1,5 +1,13 @@
 #include <iostream>
 
+#include "hardware/gpio.h"
+
+#define MOCK_GPIO_PINS 30
+
+// Interrupt configuration: one callback shared by every pin, as on the RP2040
+static gpio_irq_callback_t irq_callback = nullptr;
+static uint32_t irq_event_masks[MOCK_GPIO_PINS];
+
 void gpio_init(unsigned int gpio)
 {
     printf("Debug: initialised GPIO pin %u\n", gpio);
@@ -15,3 +23,24 @@ void gpio_put(unsigned int gpio, bool val)
 {
     printf("Debug: GPIO pin %u set to %i\n", gpio, val);
 }
+
+void gpio_set_function(unsigned int gpio, enum gpio_function fn)
+{
+    printf("Debug: GPIO pin %u set to function %d\n", gpio, (int)fn);
+}
+
+void gpio_set_irq_enabled_with_callback(unsigned int gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback)
+{
+    if (gpio < MOCK_GPIO_PINS) {
+        irq_event_masks[gpio] = enabled ? (irq_event_masks[gpio] | event_mask) : (irq_event_masks[gpio] & ~event_mask);
+    }
+    irq_callback = callback;
+    printf("Debug: GPIO pin %u interrupts 0x%x %s\n", gpio, (unsigned)event_mask, enabled ? "enabled" : "disabled");
+}
+
+void mock_gpio_trigger_irq(unsigned int gpio, uint32_t events)
+{
+    if (gpio < MOCK_GPIO_PINS && irq_callback != nullptr && (irq_event_masks[gpio] & events) != 0) {
+        irq_callback(gpio, irq_event_masks[gpio] & events);
+    }
+}
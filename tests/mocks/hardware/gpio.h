@@ -1,8 +1,42 @@
 #pragma once 
 
+#include <stdint.h>
+
 // GPIO functionality
 #define GPIO_OUT 1
 #define GPIO_IN 0
+
+// Pin functions (numbering matches the RP2040)
+enum gpio_function {
+    GPIO_FUNC_XIP = 0,
+    GPIO_FUNC_SPI = 1,
+    GPIO_FUNC_UART = 2,
+    GPIO_FUNC_I2C = 3,
+    GPIO_FUNC_PWM = 4,
+    GPIO_FUNC_SIO = 5,
+    GPIO_FUNC_PIO0 = 6,
+    GPIO_FUNC_PIO1 = 7,
+    GPIO_FUNC_GPCK = 8,
+    GPIO_FUNC_USB = 9,
+    GPIO_FUNC_NULL = 0x1f,
+};
+
 void gpio_init(unsigned int gpio);
 void gpio_set_dir(unsigned int gpio, bool out);
 void gpio_put(unsigned int gpio, bool val);
+void gpio_set_function(unsigned int gpio, enum gpio_function fn);
+
+// Interrupt events (numbering matches the RP2040)
+enum gpio_irq_level {
+    GPIO_IRQ_LEVEL_LOW = 0x1u,
+    GPIO_IRQ_LEVEL_HIGH = 0x2u,
+    GPIO_IRQ_EDGE_FALL = 0x4u,
+    GPIO_IRQ_EDGE_RISE = 0x8u,
+};
+
+typedef void (*gpio_irq_callback_t)(unsigned int gpio, uint32_t event_mask);
+
+void gpio_set_irq_enabled_with_callback(unsigned int gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback);
+
+// Test harness only: raise `events` on a pin, calling the registered callback if any of them are enabled
+void mock_gpio_trigger_irq(unsigned int gpio, uint32_t events);
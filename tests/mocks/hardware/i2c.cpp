@@ -0,0 +1,305 @@
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <stdio.h>
+
+#include "hardware/i2c.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "lis3dh_model.h"
+#include "events.h"
+#include "pico/time.h"
+
+i2c_inst_t i2c0_inst = {0, 0, {}};
+i2c_inst_t i2c1_inst = {1, 0, {}};
+static i2c_inst_t *const instances[2] = {&i2c0_inst, &i2c1_inst};
+
+// Plain arrays, so the buses are usable by drivers constructed during static initialisation
+static MockI2CDevice *devices[2][128];
+static uint32_t transaction_counts[2];
+static uint32_t byte_counts[2];
+static double busy_us[2];                   // Time the bus has spent carrying transactions
+static std::recursive_mutex i2c_mutex;
+
+// Commands written to data_cmd by DMA, waiting for the STOP that ends their transaction
+static std::vector<uint32_t> pending_commands[2];
+static std::deque<uint8_t> received[2];     // Bytes read from the device, waiting to be taken by DMA
+static bool discarding[2];                  // The current transaction was aborted; drop commands up to its STOP
+
+// Connect the devices that are fitted to the board, unless the test harness has already chosen its own
+static void attach_board_devices()
+{
+    static std::once_flag attached;
+    std::call_once(attached, []() {
+        devices[0][0x19] = &mock_lis3dh();
+    });
+}
+
+void mock_i2c_attach(i2c_inst_t *i2c, uint8_t addr, MockI2CDevice *device)
+{
+    attach_board_devices();
+    std::lock_guard<std::recursive_mutex> guard(i2c_mutex);
+    devices[i2c->index][addr & 0x7F] = device;
+}
+
+uint32_t mock_i2c_transaction_count(i2c_inst_t *i2c)
+{
+    std::lock_guard<std::recursive_mutex> guard(i2c_mutex);
+    return transaction_counts[i2c->index];
+}
+
+uint32_t mock_i2c_byte_count(i2c_inst_t *i2c)
+{
+    std::lock_guard<std::recursive_mutex> guard(i2c_mutex);
+    return byte_counts[i2c->index];
+}
+
+uint64_t mock_i2c_busy_us(i2c_inst_t *i2c)
+{
+    std::lock_guard<std::recursive_mutex> guard(i2c_mutex);
+    return (uint64_t)busy_us[i2c->index];
+}
+
+// Time a transfer of `length` data bytes takes on the bus: a start, the address byte and the data (each 9 bits with
+// the acknowledge) and a stop
+static double transfer_us(unsigned int index, size_t length)
+{
+    unsigned int baudrate = instances[index]->baudrate;
+    return baudrate == 0 ? 0.0 : ((1 + length) * 9 + 2) * 1000000.0 / baudrate;
+}
+
+void mock_i2c_print_stats()
+{
+    static uint64_t last_report_us;
+    static uint32_t last_transactions[2], last_bytes[2];
+    static double last_busy_us[2];
+    static uint32_t last_samples_taken, last_samples_overwritten;
+
+    std::lock_guard<std::recursive_mutex> guard(i2c_mutex);
+    uint64_t now = time_us_64();
+    double elapsed_us = (double)(now - last_report_us);
+    for (unsigned int index = 0; index < 2; ++index) {
+        if (instances[index]->baudrate == 0) {
+            continue;
+        }
+        double busy = busy_us[index] - last_busy_us[index];
+        printf("I2C%u: %u transactions, %u bytes, busy %.1f ms (%.1f%%)\n", index,
+               (unsigned)(transaction_counts[index] - last_transactions[index]),
+               (unsigned)(byte_counts[index] - last_bytes[index]), busy / 1000.0,
+               elapsed_us > 0.0 ? 100.0 * busy / elapsed_us : 0.0);
+        last_transactions[index] = transaction_counts[index];
+        last_bytes[index] = byte_counts[index];
+        last_busy_us[index] = busy_us[index];
+    }
+
+    MockLIS3DH &lis3dh = mock_lis3dh();
+    printf("LIS3DH model: %u samples taken, %u read, %u overwritten, latency mean %u us, max %u us\n",
+           (unsigned)(lis3dh.samples_taken() - last_samples_taken), (unsigned)lis3dh.samples_read(),
+           (unsigned)(lis3dh.samples_overwritten() - last_samples_overwritten), (unsigned)lis3dh.latency_mean_us(),
+           (unsigned)lis3dh.latency_max_us());
+    last_samples_taken = lis3dh.samples_taken();
+    last_samples_overwritten = lis3dh.samples_overwritten();
+    lis3dh.reset_latency();
+    last_report_us = now;
+}
+
+unsigned int i2c_init(i2c_inst_t *i2c, unsigned int baudrate)
+{
+    printf("Debug: initialised I2C%u at %u Hz\n", i2c->index, baudrate);
+    i2c->baudrate = baudrate;
+    return baudrate;
+}
+
+void i2c_deinit(i2c_inst_t *i2c)
+{
+    i2c->baudrate = 0;
+}
+
+// Account for a blocking transfer's time on the bus, and take that long (on the mock clock) to return
+static void busy_wait_for_transfer(unsigned int index, size_t length)
+{
+    double duration_us = transfer_us(index, length);
+    busy_us[index] += duration_us;
+    mock_clock_sleep_us((uint64_t)(duration_us + 0.5));
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+    attach_board_devices();
+    std::lock_guard<std::recursive_mutex> guard(i2c_mutex);
+    transaction_counts[i2c->index]++;
+    MockI2CDevice *device = devices[i2c->index][addr & 0x7F];
+    if (i2c->baudrate == 0 || device == nullptr || !device->write(src, len, nostop)) {
+        return PICO_ERROR_GENERIC;
+    }
+    byte_counts[i2c->index] += len;
+    busy_wait_for_transfer(i2c->index, len);
+    return (int)len;
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+    attach_board_devices();
+    std::lock_guard<std::recursive_mutex> guard(i2c_mutex);
+    transaction_counts[i2c->index]++;
+    MockI2CDevice *device = devices[i2c->index][addr & 0x7F];
+    if (i2c->baudrate == 0 || device == nullptr || !device->read(dst, len, nostop)) {
+        return PICO_ERROR_GENERIC;
+    }
+    byte_counts[i2c->index] += len;
+    busy_wait_for_transfer(i2c->index, len);
+    return (int)len;
+}
+
+MockI2CRegisterDevice::MockI2CRegisterDevice(uint8_t auto_increment_flag)
+    : registers{}, auto_increment_flag(auto_increment_flag), selected(0), auto_increment(true)
+{
+}
+
+bool MockI2CRegisterDevice::write(const uint8_t *data, size_t length, bool nostop)
+{
+    on_transaction();
+    if (length == 0) {
+        return true;
+    }
+
+    // The first byte selects the register
+    if (auto_increment_flag != 0) {
+        selected = data[0] & ~auto_increment_flag;
+        auto_increment = (data[0] & auto_increment_flag) != 0;
+    } else {
+        selected = data[0];
+        auto_increment = true;
+    }
+
+    for (size_t i = 1; i < length; ++i) {
+        on_write(selected, data[i]);
+        if (auto_increment) {
+            selected = next_register(selected);
+        }
+    }
+    return true;
+}
+
+bool MockI2CRegisterDevice::read(uint8_t *data, size_t length, bool nostop)
+{
+    on_transaction();
+    for (size_t i = 0; i < length; ++i) {
+        data[i] = on_read(selected);
+        if (auto_increment) {
+            selected = next_register(selected);
+        }
+    }
+    return true;
+}
+
+unsigned int i2c_hw_index(i2c_inst_t *i2c)
+{
+    return i2c->index;
+}
+
+i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c)
+{
+    return &i2c->hw;
+}
+
+unsigned int i2c_get_dreq(i2c_inst_t *i2c, bool is_tx)
+{
+    return DREQ_I2C0_TX + 2 * i2c->index + (is_tx ? 0 : 1);
+}
+
+float mock_i2c_byte_period_us(unsigned int index)
+{
+    unsigned int baudrate = instances[index]->baudrate;
+    return baudrate == 0 ? 0.0f : 9 * 1000000.0f / baudrate;
+}
+
+// Run one direction's worth of queued commands against the device. Returns false if the device NAKed.
+static bool run_segment(unsigned int index, MockI2CDevice *device, const std::vector<uint32_t> &segment, bool stop)
+{
+    transaction_counts[index]++;
+    if (instances[index]->baudrate == 0 || device == nullptr) {
+        return false;
+    }
+    if (segment[0] & I2C_IC_DATA_CMD_CMD_BITS) {
+        std::vector<uint8_t> data(segment.size());
+        if (!device->read(data.data(), data.size(), !stop)) {
+            return false;
+        }
+        received[index].insert(received[index].end(), data.begin(), data.end());
+    } else {
+        std::vector<uint8_t> data;
+        for (uint32_t command : segment) {
+            data.push_back((uint8_t)command);
+        }
+        if (!device->write(data.data(), data.size(), !stop)) {
+            return false;
+        }
+    }
+    byte_counts[index] += segment.size();
+    busy_us[index] += transfer_us(index, segment.size());
+    return true;
+}
+
+void mock_i2c_dma_write(unsigned int index, uint32_t command)
+{
+    attach_board_devices();
+    bool aborted = false;
+    {
+        std::lock_guard<std::recursive_mutex> guard(i2c_mutex);
+        i2c_hw_t &hw = instances[index]->hw;
+        bool stop = (command & I2C_IC_DATA_CMD_STOP_BITS) != 0;
+        if (discarding[index]) {
+            discarding[index] = !stop;
+            return;
+        }
+        if (pending_commands[index].empty()) {
+            hw.raw_intr_stat = hw.raw_intr_stat & ~I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS; // A new transaction starts without an abort
+        }
+        pending_commands[index].push_back(command);
+        if (!stop) {
+            return;
+        }
+
+        // Split the transaction where the direction changes (a repeated start) and run each part in turn
+        MockI2CDevice *device = devices[index][hw.tar & 0x7F];
+        std::vector<uint32_t> &commands = pending_commands[index];
+        size_t start = 0;
+        for (size_t i = 1; i <= commands.size() && !aborted; ++i) {
+            bool end = i == commands.size() ||
+                       ((commands[i] ^ commands[start]) & I2C_IC_DATA_CMD_CMD_BITS) != 0;
+            if (end) {
+                std::vector<uint32_t> segment(commands.begin() + start, commands.begin() + i);
+                aborted = !run_segment(index, device, segment, i == commands.size());
+                start = i;
+            }
+        }
+        commands.clear();
+        if (aborted) {
+            hw.raw_intr_stat = hw.raw_intr_stat | I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS;
+            aborted = (hw.intr_mask & I2C_IC_INTR_MASK_M_TX_ABRT_BITS) != 0;
+        }
+    }
+
+    // Raise the interrupt from its own thread, as the mock DMA is holding its lock while it moves data
+    if (aborted) {
+        mock_run_after_us(0, [index]() { mock_irq_raise(I2C0_IRQ + index); });
+    }
+}
+
+bool mock_i2c_dma_read(unsigned int index, uint8_t *data)
+{
+    std::lock_guard<std::recursive_mutex> guard(i2c_mutex);
+    if (received[index].empty()) {
+        return false;
+    }
+    *data = received[index].front();
+    received[index].pop_front();
+    return true;
+}
+
+unsigned int mock_i2c_dma_rx_level(unsigned int index)
+{
+    std::lock_guard<std::recursive_mutex> guard(i2c_mutex);
+    return (unsigned int)received[index].size();
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PICO_ERROR_GENERIC -1
+
+// Register block of an I2C controller, with the fields the drivers use to run transfers by DMA. The mock only
+// reads `tar`, `intr_mask` and `dma_cr`; data moves through `data_cmd` by DMA (see mock_i2c_dma_write/read). A
+// transaction runs as soon as its STOP command is written, so `status` and `enable_status` always read as idle and
+// disabled.
+typedef struct {
+    volatile uint32_t enable;
+    volatile uint32_t tar;
+    volatile uint32_t status;
+    volatile uint32_t enable_status;
+    volatile uint32_t data_cmd;
+    volatile uint32_t intr_mask;
+    volatile uint32_t raw_intr_stat;
+    volatile uint32_t clr_tx_abrt;
+    volatile uint32_t dma_cr;
+    volatile uint32_t dma_tdlr;
+    volatile uint32_t dma_rdlr;
+} i2c_hw_t;
+
+// Register bits (as in the SDK's hardware/regs/i2c.h)
+#define I2C_IC_ENABLE_ENABLE_BITS 0x00000001
+#define I2C_IC_STATUS_MST_ACTIVITY_BITS 0x00000020
+#define I2C_IC_ENABLE_STATUS_IC_EN_BITS 0x00000001
+#define I2C_IC_DATA_CMD_CMD_BITS 0x00000100
+#define I2C_IC_DATA_CMD_STOP_BITS 0x00000200
+#define I2C_IC_DATA_CMD_RESTART_BITS 0x00000400
+#define I2C_IC_INTR_MASK_M_TX_ABRT_BITS 0x00000040
+#define I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS 0x00000040
+#define I2C_IC_DMA_CR_RDMAE_BITS 0x00000001
+#define I2C_IC_DMA_CR_TDMAE_BITS 0x00000002
+
+// I2C controller instances, as in the SDK
+typedef struct i2c_inst {
+    unsigned int index;
+    unsigned int baudrate;
+    i2c_hw_t hw;
+} i2c_inst_t;
+
+extern i2c_inst_t i2c0_inst;
+extern i2c_inst_t i2c1_inst;
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+
+// Functions defined to replicate the real API. A transaction with no device at the address fails with
+// PICO_ERROR_GENERIC, as if the address had not been acknowledged.
+unsigned int i2c_init(i2c_inst_t *i2c, unsigned int baudrate);
+void i2c_deinit(i2c_inst_t *i2c);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+unsigned int i2c_hw_index(i2c_inst_t *i2c);
+i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c);
+unsigned int i2c_get_dreq(i2c_inst_t *i2c, bool is_tx);
+
+// Test harness only: the DMA side of `data_cmd`, called by the DMA mock for transfers paced by the I2C DREQs. Each
+// command written is a byte to send, or (with I2C_IC_DATA_CMD_CMD_BITS) a byte to receive. The commands are run as
+// a transaction when one carries I2C_IC_DATA_CMD_STOP_BITS. If the device NAKs, TX_ABRT is raised (and I2Cn_IRQ if
+// it is unmasked) and the rest of the transaction is discarded, so a receive DMA waiting on it stalls until aborted.
+void mock_i2c_dma_write(unsigned int index, uint32_t command);
+bool mock_i2c_dma_read(unsigned int index, uint8_t *data);  // False if no received byte is waiting
+unsigned int mock_i2c_dma_rx_level(unsigned int index);      // Received bytes waiting to be read by DMA
+float mock_i2c_byte_period_us(unsigned int index);           // Time one byte (with its ACK) takes on the bus
+
+// Test harness only: a device on a mock I2C bus
+class MockI2CDevice {
+public:
+    virtual ~MockI2CDevice() {}
+
+    // Handle the data phase of a write or read transaction. Return false to NAK it.
+    virtual bool write(const uint8_t *data, size_t length, bool nostop) = 0;
+    virtual bool read(uint8_t *data, size_t length, bool nostop) = 0;
+};
+
+// Test harness only: a device modelled as a bank of 8-bit registers. The first byte of a write selects the
+// register; the remaining bytes are written from there, and a read continues from the selected register. If
+// `auto_increment_flag` is non-zero, the register address only advances when that bit was set in the first byte
+// (as on ST sensors, which use bit 7); otherwise it always advances. Subclasses override the hooks to model
+// registers with side effects.
+class MockI2CRegisterDevice : public MockI2CDevice {
+public:
+    explicit MockI2CRegisterDevice(uint8_t auto_increment_flag = 0);
+
+    bool write(const uint8_t *data, size_t length, bool nostop) override;
+    bool read(uint8_t *data, size_t length, bool nostop) override;
+
+    // Direct register access for test code (no side effects)
+    uint8_t peek(uint8_t reg) const { return registers[reg]; }
+    void poke(uint8_t reg, uint8_t value) { registers[reg] = value; }
+
+protected:
+    uint8_t registers[256];
+
+    virtual void on_transaction() {}                                  // Called at the start of every transaction
+    virtual uint8_t on_read(uint8_t reg) { return registers[reg]; }
+    virtual void on_write(uint8_t reg, uint8_t value) { registers[reg] = value; }
+    virtual uint8_t next_register(uint8_t reg) { return (uint8_t)(reg + 1); }
+
+private:
+    uint8_t auto_increment_flag;
+    uint8_t selected;       // Register the next access starts from
+    bool auto_increment;    // Whether the current access advances through registers
+};
+
+// Test harness only: connect `device` to a bus at a 7-bit address (nullptr disconnects it). The LIS3DH model is
+// connected to i2c0 at 0x19 by default, as on the board.
+void mock_i2c_attach(i2c_inst_t *i2c, uint8_t addr, MockI2CDevice *device);
+
+// Test harness only: traffic counters for a bus (transactions and data bytes, in either direction)
+uint32_t mock_i2c_transaction_count(i2c_inst_t *i2c);
+uint32_t mock_i2c_byte_count(i2c_inst_t *i2c);
+
+// Test harness only: time a bus has spent carrying transactions, at 9 bits per byte (with the acknowledge) plus the
+// start and stop conditions. Blocking transfers also take this long to return, on the mock clock.
+uint64_t mock_i2c_busy_us(i2c_inst_t *i2c);
+
+// Test harness only: print each initialised bus's traffic and utilisation, and the LIS3DH model's samples and
+// sensor-path latency, since the last call
+void mock_i2c_print_stats();
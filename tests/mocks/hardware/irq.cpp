@@ -0,0 +1,73 @@
+#include <mutex>
+
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+#define MOCK_NUM_IRQS 32            // Interrupts on the RP2040
+#define MOCK_MAX_SHARED_HANDLERS 4  // Handlers per interrupt
+
+// Plain arrays rather than containers, so that they are usable by drivers constructed during static initialisation
+static irq_handler_t irq_handlers[MOCK_NUM_IRQS][MOCK_MAX_SHARED_HANDLERS];
+static bool irq_enabled[MOCK_NUM_IRQS];
+static std::recursive_mutex irq_mutex;
+
+void irq_set_exclusive_handler(unsigned int num, irq_handler_t handler)
+{
+    std::lock_guard<std::recursive_mutex> guard(irq_mutex);
+    for (irq_handler_t &slot : irq_handlers[num]) {
+        slot = nullptr;
+    }
+    irq_handlers[num][0] = handler;
+}
+
+void irq_add_shared_handler(unsigned int num, irq_handler_t handler, uint8_t order_priority)
+{
+    std::lock_guard<std::recursive_mutex> guard(irq_mutex);
+    for (irq_handler_t &slot : irq_handlers[num]) {
+        if (slot == nullptr) {
+            slot = handler;
+            return;
+        }
+    }
+}
+
+void irq_remove_handler(unsigned int num, irq_handler_t handler)
+{
+    std::lock_guard<std::recursive_mutex> guard(irq_mutex);
+    for (irq_handler_t &slot : irq_handlers[num]) {
+        if (slot == handler) {
+            slot = nullptr;
+            break;
+        }
+    }
+}
+
+void irq_set_enabled(unsigned int num, bool enabled)
+{
+    std::lock_guard<std::recursive_mutex> guard(irq_mutex);
+    irq_enabled[num] = enabled;
+}
+
+void mock_irq_raise(unsigned int num)
+{
+    std::lock_guard<std::recursive_mutex> guard(irq_mutex);
+    if (!irq_enabled[num]) {
+        return;
+    }
+    for (irq_handler_t handler : irq_handlers[num]) {
+        if (handler != nullptr) {
+            handler();
+        }
+    }
+}
+
+uint32_t save_and_disable_interrupts()
+{
+    irq_mutex.lock();
+    return 0;
+}
+
+void restore_interrupts(uint32_t status)
+{
+    irq_mutex.unlock();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+// Interrupt numbers used by the drivers
+#define DMA_IRQ_0 11
+#define DMA_IRQ_1 12
+#define I2C0_IRQ 23
+#define I2C1_IRQ 24
+
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+typedef void (*irq_handler_t)(void);
+
+// Functions defined to replicate the real API
+void irq_set_exclusive_handler(unsigned int num, irq_handler_t handler);
+void irq_add_shared_handler(unsigned int num, irq_handler_t handler, uint8_t order_priority);
+void irq_remove_handler(unsigned int num, irq_handler_t handler);
+void irq_set_enabled(unsigned int num, bool enabled);
+
+// Test harness only: run the handlers for an interrupt (if it is enabled), as the NVIC would when the hardware
+// raises it. Handlers are serialised, because interrupts at the same priority cannot preempt each other.
+void mock_irq_raise(unsigned int num);
@@ -1,8 +1,11 @@
 #include <vector>
 #include "hardware/pio.h"
+#include "hardware/dma.h"
 
-PIO pio0 = 0;
+static pio_hw_t mock_pio0_hw;
+PIO pio0 = &mock_pio0_hw;
 static std::vector<pio_program_t> pio_programs;
+static float word_period_us[4];
 
 unsigned int pio_add_program(PIO pio, const pio_program_t* program)
 {
@@ -16,3 +19,25 @@ void pio_sm_put_blocking(PIO pio, unsigned int sm, uint32_t data)
         program(data);
     }
 }
+
+unsigned int pio_get_dreq(PIO pio, unsigned int sm, bool is_tx)
+{
+    // Only PIO0 TX is modelled
+    return DREQ_PIO0_TX0 + sm;
+}
+
+unsigned int pio_sm_get_tx_fifo_level(PIO pio, unsigned int sm)
+{
+    // Data is delivered to the program as soon as it is written, so the FIFO is always empty
+    return 0;
+}
+
+void mock_pio_set_word_period_us(unsigned int sm, float period_us)
+{
+    word_period_us[sm] = period_us;
+}
+
+float mock_pio_word_period_us(unsigned int sm)
+{
+    return word_period_us[sm];
+}
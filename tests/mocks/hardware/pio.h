@@ -1,9 +1,15 @@
 #pragma once 
 
+#include <stdint.h>
 #include <vector>
 
+// Register block, defined so that drivers can take the address of a TX FIFO for DMA
+typedef struct {
+    volatile uint32_t txf[4];
+} pio_hw_t;
+
 // Types defined just so that we can replicate the real API
-typedef uint32_t PIO;
+typedef pio_hw_t *PIO;
 extern PIO pio0;
 
 // A "program" in the mock is a function pointer that is called with the data being delivered to the PIO.
@@ -12,3 +18,10 @@ typedef void (*pio_program_t)(uint32_t data);
 // Functions defined to replicate the real API
 unsigned int pio_add_program(PIO pio, const pio_program_t* program);
 void pio_sm_put_blocking(PIO pio, unsigned int sm, uint32_t data);
+unsigned int pio_get_dreq(PIO pio, unsigned int sm, bool is_tx);
+unsigned int pio_sm_get_tx_fifo_level(PIO pio, unsigned int sm);
+
+// Test harness only: how long the state machine takes to shift out one FIFO word. The DMA mock uses this to pace
+// transfers into the TX FIFO.
+void mock_pio_set_word_period_us(unsigned int sm, float period_us);
+float mock_pio_word_period_us(unsigned int sm);
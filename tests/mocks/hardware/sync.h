@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+
+// Functions defined to replicate the real API. In the mock, "disabling interrupts" holds off the threads that emulate
+// interrupt handlers (see mock_irq_raise), which gives the same mutual exclusion as on the device.
+uint32_t save_and_disable_interrupts();
+void restore_interrupts(uint32_t status);
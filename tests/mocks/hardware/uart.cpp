@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+
+#include "hardware/uart.h"
+#include "hardware/dma.h"
+#include "pico/stdlib.h"
+
+uart_inst_t uart0_inst = {0, 0, {}};
+uart_inst_t uart1_inst = {1, 0, {}};
+static uart_inst_t *const instances[2] = {&uart0_inst, &uart1_inst};
+
+static FILE *output_files[2];
+static bool output_chosen[2];
+static uint64_t bytes_sent[2];
+static std::mutex uart_mutex;
+
+bool mock_uart_set_output_file(uart_inst_t *uart, const char *path)
+{
+    std::lock_guard<std::mutex> guard(uart_mutex);
+    if (output_files[uart->index] != nullptr) {
+        fclose(output_files[uart->index]);
+        output_files[uart->index] = nullptr;
+    }
+    output_chosen[uart->index] = true;
+    if (path == nullptr) {
+        return true;
+    }
+    output_files[uart->index] = fopen(path, "wb");
+    if (output_files[uart->index] == nullptr) {
+        printf("Debug: UART%u could not open %s\n", uart->index, path);
+        return false;
+    }
+    return true;
+}
+
+uint64_t mock_uart_bytes_sent(uart_inst_t *uart)
+{
+    std::lock_guard<std::mutex> guard(uart_mutex);
+    return bytes_sent[uart->index];
+}
+
+unsigned int uart_init(uart_inst_t *uart, unsigned int baudrate)
+{
+    printf("Debug: initialised UART%u at %u baud\n", uart->index, baudrate);
+    uart->baudrate = baudrate;
+    const char *path = getenv("MOCK_UART_FILE");
+    if (uart->index == 1 && !output_chosen[1] && path != nullptr) {
+        mock_uart_set_output_file(uart, path);
+    }
+    return baudrate;
+}
+
+// Record bytes that have gone out on the line
+static void sent(unsigned int index, const uint8_t *data, size_t len)
+{
+    std::lock_guard<std::mutex> guard(uart_mutex);
+    bytes_sent[index] += len;
+    if (output_files[index] != nullptr) {
+        fwrite(data, 1, len, output_files[index]);
+        fflush(output_files[index]);
+    }
+}
+
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len)
+{
+    sent(uart->index, src, len);
+    if (uart->baudrate != 0) {
+        sleep_us((uint32_t)(len * 10 * 1000000ull / uart->baudrate));
+    }
+}
+
+void uart_putc(uart_inst_t *uart, char c)
+{
+    uart_write_blocking(uart, (const uint8_t *)&c, 1);
+}
+
+void uart_puts(uart_inst_t *uart, const char *s)
+{
+    uart_write_blocking(uart, (const uint8_t *)s, strlen(s));
+}
+
+uart_hw_t *uart_get_hw(uart_inst_t *uart)
+{
+    return &uart->hw;
+}
+
+unsigned int uart_get_dreq(uart_inst_t *uart, bool is_tx)
+{
+    return DREQ_UART0_TX + 2 * uart->index + (is_tx ? 0 : 1);
+}
+
+void mock_uart_dma_write(unsigned int index, uint8_t byte)
+{
+    sent(index, &byte, 1);
+}
+
+float mock_uart_byte_period_us(unsigned int index)
+{
+    unsigned int baudrate = instances[index]->baudrate;
+    return baudrate == 0 ? 0.0f : 10 * 1000000.0f / baudrate;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Register block, defined so that drivers can take the address of the data register for DMA
+typedef struct {
+    volatile uint32_t dr;
+} uart_hw_t;
+
+// UART instances, as in the SDK
+typedef struct uart_inst {
+    unsigned int index;
+    unsigned int baudrate;
+    uart_hw_t hw;
+} uart_inst_t;
+
+extern uart_inst_t uart0_inst;
+extern uart_inst_t uart1_inst;
+#define uart0 (&uart0_inst)
+#define uart1 (&uart1_inst)
+
+// Functions defined to replicate the real API. Writes take as long as the bytes would take to shift out (ten bits
+// each at the configured baud rate), as the real blocking functions do.
+unsigned int uart_init(uart_inst_t *uart, unsigned int baudrate);
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len);
+void uart_putc(uart_inst_t *uart, char c);
+void uart_puts(uart_inst_t *uart, const char *s);
+uart_hw_t *uart_get_hw(uart_inst_t *uart);
+unsigned int uart_get_dreq(uart_inst_t *uart, bool is_tx);
+
+// Test harness only: a byte written to the data register by DMA (transfers paced by the UART TX DREQs)
+void mock_uart_dma_write(unsigned int index, uint8_t byte);
+
+// Test harness only: time one byte (start bit, 8 data bits and a stop bit) takes on the line
+float mock_uart_byte_period_us(unsigned int index);
+
+// Test harness only: also write everything sent on a UART to a file (nullptr to stop). If no file has been set,
+// UART1 (the Bluetooth module) is written to the file named by the MOCK_UART_FILE environment variable, if any.
+bool mock_uart_set_output_file(uart_inst_t *uart, const char *path);
+
+// Test harness only: bytes sent on a UART so far
+uint64_t mock_uart_bytes_sent(uart_inst_t *uart);
@@ -0,0 +1,337 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <vector>
+
+#include "lis3dh_model.h"
+#include "pico/time.h"
+#include "utils/telemetry.h"
+
+// Registers modelled
+#define WHO_AM_I 0x0F
+#define CTRL_REG1 0x20
+#define CTRL_REG4 0x23
+#define CTRL_REG5 0x24
+#define STATUS_REG 0x27
+#define OUT_X_L 0x28
+#define OUT_Z_H 0x2D
+#define FIFO_CTRL_REG 0x2E
+#define FIFO_SRC_REG 0x2F
+
+#define DEFAULT_ROTATION_PERIOD_US 10000000 // Time the default motion takes to rotate once about the X axis
+
+// The default motion: gravity, with the board slowly rolling about its X axis
+static void default_motion(uint64_t t_us, int16_t mg[3])
+{
+    double angle = 2.0 * M_PI * (double)(t_us % DEFAULT_ROTATION_PERIOD_US) / DEFAULT_ROTATION_PERIOD_US;
+    mg[0] = 0;
+    mg[1] = (int16_t)lround(1000.0 * sin(angle));
+    mg[2] = (int16_t)lround(1000.0 * cos(angle));
+}
+
+MockLIS3DH::MockLIS3DH()
+    : MockI2CRegisterDevice(0x80), motion(default_motion), last_update_us(0), owed_us(0), sensor_time_us(0),
+      sample_count(0), overwritten_count(0), read_count(0), latency_total_us(0), latency_maximum_us(0),
+      output_taken_us(0), fifo{}, fifo_taken_us{}, fifo_head(0), fifo_count(0), fifo_overrun(false)
+{
+    registers[WHO_AM_I] = 0x33;
+    registers[CTRL_REG1] = 0x07; // Power down, all axes enabled
+}
+
+void MockLIS3DH::set_motion(Motion new_motion)
+{
+    motion = new_motion ? new_motion : Motion(default_motion);
+}
+
+// One row of a motion trace
+struct MotionTracePoint {
+    uint64_t t_us;
+    int16_t mg[3];
+};
+
+bool MockLIS3DH::load_trace(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        printf("Debug: LIS3DH could not open %s\n", path);
+        return false;
+    }
+
+    auto points = std::make_shared<std::vector<MotionTracePoint>>();
+    char line[256];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        if (!(line[0] == '-' || (line[0] >= '0' && line[0] <= '9'))) {
+            continue; // Header or comment
+        }
+        double fields[8];
+        int count = 0;
+        char *next = line;
+        while (count < 8) {
+            char *end;
+            fields[count] = strtod(next, &end);
+            if (end == next) {
+                break;
+            }
+            count++;
+            next = end;
+            while (*next == ',' || *next == ' ') {
+                next++;
+            }
+        }
+
+        MotionTracePoint point;
+        int first_axis;
+        if (count == 4) {
+            point.t_us = (uint64_t)fields[0];
+            first_axis = 1;
+        } else if (count == 6 && (int)fields[2] == TELEMETRY_ACCELERATION) {
+            point.t_us = (uint64_t)fields[1]; // sequence,timestamp_us,type,x,y,z
+            first_axis = 3;
+        } else {
+            continue;
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            point.mg[axis] = (int16_t)fields[first_axis + axis];
+        }
+        if (!points->empty() && point.t_us < points->back().t_us) {
+            continue; // Time must not go backwards
+        }
+        points->push_back(point);
+    }
+    fclose(file);
+    if (points->empty()) {
+        printf("Debug: LIS3DH found no samples in %s\n", path);
+        return false;
+    }
+
+    // The trace repeats after its last row, one row interval later
+    uint64_t start_us = points->front().t_us;
+    for (MotionTracePoint &point : *points) {
+        point.t_us -= start_us;
+    }
+    size_t rows = points->size();
+    uint64_t duration_us = rows < 2 ? 1 : points->back().t_us + (points->back().t_us - (*points)[rows - 2].t_us);
+    if (duration_us == 0) {
+        duration_us = 1;
+    }
+
+    set_motion([points, duration_us](uint64_t t_us, int16_t mg[3]) {
+        uint64_t t = t_us % duration_us;
+        // The last row at or before t, and the row after it (the first row again past the end)
+        size_t low = 0, high = points->size();
+        while (high - low > 1) {
+            size_t middle = (low + high) / 2;
+            if ((*points)[middle].t_us <= t) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+        const MotionTracePoint &a = (*points)[low];
+        const MotionTracePoint &b = low + 1 < points->size() ? (*points)[low + 1] : points->front();
+        uint64_t b_us = low + 1 < points->size() ? b.t_us : duration_us;
+        double fraction = b_us > a.t_us ? (double)(t - a.t_us) / (double)(b_us - a.t_us) : 0.0;
+        for (int axis = 0; axis < 3; ++axis) {
+            mg[axis] = (int16_t)lround(a.mg[axis] + fraction * (b.mg[axis] - a.mg[axis]));
+        }
+    });
+    printf("Debug: LIS3DH playing %zu samples (%.3f s) from %s\n", rows, duration_us / 1e6, path);
+    return true;
+}
+
+void MockLIS3DH::reset_latency()
+{
+    read_count = 0;
+    latency_total_us = 0;
+    latency_maximum_us = 0;
+}
+
+void MockLIS3DH::record_latency(uint64_t taken_us)
+{
+    // Reads happen at the start of the transaction, which is when the clock was last looked at
+    uint64_t latency = last_update_us - taken_us;
+    read_count++;
+    latency_total_us += latency;
+    if (latency > latency_maximum_us) {
+        latency_maximum_us = latency;
+    }
+}
+
+bool MockLIS3DH::fifo_active() const
+{
+    return (registers[CTRL_REG5] & 0x40) != 0 && (registers[FIFO_CTRL_REG] >> 6) != 0;
+}
+
+uint32_t MockLIS3DH::sample_period_us() const
+{
+    // Output data rates in Hz, indexed by CTRL_REG1 ODR[3:0] (0 is power down)
+    static const uint32_t rates[16] = {0, 1, 10, 25, 50, 100, 200, 400, 1600, 1344, 0, 0, 0, 0, 0, 0};
+    unsigned int odr = registers[CTRL_REG1] >> 4;
+    uint32_t rate = rates[odr];
+    if (odr == 9 && (registers[CTRL_REG1] & 0x08)) {
+        rate = 5376; // Low power mode
+    }
+    return rate == 0 ? 0 : 1000000 / rate;
+}
+
+void MockLIS3DH::on_transaction()
+{
+    uint64_t now = time_us_64();
+    uint64_t elapsed = now - last_update_us;
+    last_update_us = now;
+
+    uint32_t period = sample_period_us();
+    if (period == 0) {
+        owed_us = 0;
+        return;
+    }
+    owed_us += elapsed;
+    while (owed_us >= period) {
+        owed_us -= period;
+        sensor_time_us += period;
+        take_sample(now - owed_us);
+    }
+}
+
+void MockLIS3DH::take_sample(uint64_t taken_us)
+{
+    int16_t mg[3];
+    motion(sensor_time_us, mg);
+    sample_count++;
+
+    // Quantise to the resolution of the mode (CTRL_REG1 LPen, CTRL_REG4 HR) at the sensitivity of the range
+    // (CTRL_REG4 FS), clip to full scale, and left-justify
+    static const int32_t sensitivities[3][4] = {{16, 32, 64, 192}, {4, 8, 16, 48}, {1, 2, 4, 12}};
+    int mode = (registers[CTRL_REG1] & 0x08) ? 0 : ((registers[CTRL_REG4] & 0x08) ? 2 : 1);
+    int bits = 8 + 2 * mode;
+    int32_t sensitivity = sensitivities[mode][(registers[CTRL_REG4] >> 4) & 0x03];
+    int32_t limit = 1 << (bits - 1);
+    uint8_t bytes[6];
+    for (int axis = 0; axis < 3; ++axis) {
+        int32_t digits = (int32_t)lround((double)mg[axis] / sensitivity);
+        digits = digits >= limit ? limit - 1 : (digits < -limit ? -limit : digits);
+        uint16_t raw = (uint16_t)(digits * (1 << (16 - bits)));
+        bytes[2 * axis] = (uint8_t)raw;
+        bytes[2 * axis + 1] = (uint8_t)(raw >> 8);
+    }
+    registers[STATUS_REG] |= 0x08; // ZYXDA
+
+    if (!fifo_active()) {
+        memcpy(&registers[OUT_X_L], bytes, sizeof(bytes));
+        output_taken_us = taken_us;
+        return;
+    }
+
+    if (fifo_count == MOCK_LIS3DH_FIFO_DEPTH) {
+        fifo_overrun = true;
+        if ((registers[FIFO_CTRL_REG] >> 6) == 1) {
+            return; // FIFO mode stops collecting once full
+        }
+        // Stream mode discards the oldest sample
+        fifo_head = (fifo_head + 1) % MOCK_LIS3DH_FIFO_DEPTH;
+        fifo_count--;
+        overwritten_count++;
+    }
+    unsigned int slot = (fifo_head + fifo_count) % MOCK_LIS3DH_FIFO_DEPTH;
+    memcpy(fifo[slot], bytes, sizeof(bytes));
+    fifo_taken_us[slot] = taken_us;
+    fifo_count++;
+    if (fifo_count == MOCK_LIS3DH_FIFO_DEPTH) {
+        fifo_overrun = true;
+    }
+}
+
+void MockLIS3DH::load_output_registers()
+{
+    if (fifo_count > 0) {
+        memcpy(&registers[OUT_X_L], fifo[fifo_head], 6);
+    }
+}
+
+uint8_t MockLIS3DH::on_read(uint8_t reg)
+{
+    if (reg == FIFO_SRC_REG) {
+        uint8_t threshold = registers[FIFO_CTRL_REG] & 0x1F;
+        uint8_t src = fifo_count > 31 ? 31 : (uint8_t)fifo_count;
+        if (fifo_count > threshold) {
+            src |= 0x80; // WTM
+        }
+        if (fifo_overrun) {
+            src |= 0x40; // OVRN_FIFO
+        }
+        if (fifo_count == 0) {
+            src |= 0x20; // EMPTY
+        }
+        return src;
+    }
+
+    if (reg >= OUT_X_L && reg <= OUT_Z_H) {
+        if (fifo_active()) {
+            load_output_registers();
+        }
+        uint8_t value = registers[reg];
+        if (reg == OUT_Z_H) {
+            if (!fifo_active() && (registers[STATUS_REG] & 0x08)) {
+                record_latency(output_taken_us);
+            }
+            registers[STATUS_REG] &= ~0x08;
+            // Reading the last output register pops the sample from the FIFO
+            if (fifo_active() && fifo_count > 0) {
+                record_latency(fifo_taken_us[fifo_head]);
+                fifo_head = (fifo_head + 1) % MOCK_LIS3DH_FIFO_DEPTH;
+                fifo_count--;
+                fifo_overrun = false;
+            }
+        }
+        return value;
+    }
+
+    return registers[reg];
+}
+
+void MockLIS3DH::on_write(uint8_t reg, uint8_t value)
+{
+    switch (reg) {
+    case WHO_AM_I:
+    case STATUS_REG:
+    case FIFO_SRC_REG:
+        return; // Read only
+    case CTRL_REG1:
+        // A new data rate starts timing afresh
+        owed_us = 0;
+        break;
+    default:
+        break;
+    }
+
+    registers[reg] = value;
+
+    // Bypass mode (or disabling the FIFO) empties the FIFO
+    if ((reg == FIFO_CTRL_REG || reg == CTRL_REG5) && !fifo_active()) {
+        fifo_head = 0;
+        fifo_count = 0;
+        fifo_overrun = false;
+    }
+}
+
+uint8_t MockLIS3DH::next_register(uint8_t reg)
+{
+    // With the FIFO enabled, auto-increment wraps from the last output register back to the first
+    if (reg == OUT_Z_H && (registers[CTRL_REG5] & 0x40)) {
+        return OUT_X_L;
+    }
+    return (uint8_t)(reg + 1);
+}
+
+MockLIS3DH &mock_lis3dh()
+{
+    static MockLIS3DH lis3dh;
+    static bool trace_loaded = [] {
+        const char *path = getenv("MOCK_LIS3DH_FILE");
+        return path != nullptr && lis3dh.load_trace(path);
+    }();
+    (void)trace_loaded;
+    return lis3dh;
+}
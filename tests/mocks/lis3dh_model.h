@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+
+#include "hardware/i2c.h"
+
+#define MOCK_LIS3DH_FIFO_DEPTH 32
+
+/*! \brief Test harness only: register-level model of the LIS3DH accelerometer.
+ *
+ * The model takes samples at the output data rate selected in CTRL_REG1, timed by the mock clock (so it runs
+ * deterministically with the virtual clock). Samples are generated lazily: at the start of every I2C transaction
+ * the model catches up on the samples that would have been taken since the last one.
+ *
+ * In bypass mode the output registers hold the latest sample. With FIFO_EN set in CTRL_REG5, the FIFO mode in
+ * FIFO_CTRL_REG is honoured: FIFO mode stops collecting once 32 samples are stored, and stream mode (and
+ * stream-to-FIFO, which the model treats as stream) keeps collecting, discarding the oldest sample. Reading OUT_Z_H
+ * pops a sample, and an auto-increment read wraps from OUT_Z_H back to OUT_X_L, as on the device. FIFO_SRC_REG
+ * reports the watermark, overrun, empty flags and the unread sample count.
+ *
+ * Accelerations are generated in mg, and written to the output registers left-justified at the resolution and
+ * sensitivity of the mode and range selected in CTRL_REG1 and CTRL_REG4. The default motion is a slow rotation
+ * about the X axis; a recorded trace can be played back instead (see load_trace).
+ *
+ * The model also measures the sensor-path latency: the mock clock time from when each sample was taken to the
+ * transaction that read it out.
+ */
+class MockLIS3DH : public MockI2CRegisterDevice {
+public:
+    // Source of motion: fill in `mg` (X, Y, Z) for the sample taken `t_us` after the sensor was powered up
+    typedef std::function<void(uint64_t t_us, int16_t mg[3])> Motion;
+
+    MockLIS3DH();
+
+    // Replace the motion the sensor measures (an empty function restores the default)
+    void set_motion(Motion motion);
+
+    // Play back a recorded CSV trace as the motion, interpolating linearly between rows and repeating from the start
+    // after the last one. Each row is `time_us,x,y,z` (in mg), or a row of telemetry_decode output, whose
+    // acceleration records have the same fields after the sequence number and type. Other lines (e.g. headers) are
+    // skipped, and times are taken relative to the first row. If the file named by the MOCK_LIS3DH_FILE environment
+    // variable can be loaded, mock_lis3dh() plays it back from the start.
+    bool load_trace(const char *path);
+
+    // Samples the sensor has taken, and samples lost to FIFO overruns
+    uint32_t samples_taken() const { return sample_count; }
+    uint32_t samples_overwritten() const { return overwritten_count; }
+
+    // Samples read out, and their latency from being taken to being read (in mock clock microseconds)
+    uint32_t samples_read() const { return read_count; }
+    uint64_t latency_mean_us() const { return read_count ? latency_total_us / read_count : 0; }
+    uint64_t latency_max_us() const { return latency_maximum_us; }
+    void reset_latency();
+
+protected:
+    void on_transaction() override;
+    uint8_t on_read(uint8_t reg) override;
+    void on_write(uint8_t reg, uint8_t value) override;
+    uint8_t next_register(uint8_t reg) override;
+
+private:
+    Motion motion;
+    uint64_t last_update_us;     // Mock clock time of the last catch-up
+    uint64_t owed_us;            // Time since the last sample was taken
+    uint64_t sensor_time_us;     // Time of the latest sample, relative to power-up
+    uint32_t sample_count;
+    uint32_t overwritten_count;
+    uint32_t read_count;
+    uint64_t latency_total_us;
+    uint64_t latency_maximum_us;
+    uint64_t output_taken_us;    // Mock clock time the sample in the output registers was taken (bypass mode)
+
+    // FIFO of samples, each as the six output register bytes
+    uint8_t fifo[MOCK_LIS3DH_FIFO_DEPTH][6];
+    uint64_t fifo_taken_us[MOCK_LIS3DH_FIFO_DEPTH]; // Mock clock time each sample was taken
+    unsigned int fifo_head;      // Index of the oldest sample
+    unsigned int fifo_count;
+    bool fifo_overrun;
+
+    bool fifo_active() const;
+    uint32_t sample_period_us() const;
+    void take_sample(uint64_t taken_us);
+    void record_latency(uint64_t taken_us);
+    void load_output_registers();
+};
+
+// Test harness only: the LIS3DH fitted to the board (connected to i2c0 at 0x19)
+MockLIS3DH &mock_lis3dh();
@@ -0,0 +1,71 @@
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+
+#include "pico/multicore.h"
+
+// Give up waiting for core 1 after this long, in case it waits on something only core 0 can do (e.g. a lock)
+#define MOCK_CORE1_IDLE_TIMEOUT_MS 1000
+
+// The emulated core the current thread belongs to. Every thread other than core 1's counts as core 0, including
+// the ones the mocks use to emulate hardware completing in the background.
+static thread_local unsigned int core_num = 0;
+
+// Virtual clock lockstep: the number of changes so far, and the last one core 1 is known to have caught up with
+static std::atomic<bool> core1_running(false);
+static std::atomic<uint64_t> change_count(0);
+static std::atomic<uint64_t> core1_idle_at(UINT64_MAX);
+static thread_local uint64_t core1_last_seen = UINT64_MAX;
+
+unsigned int get_core_num()
+{
+    return core_num;
+}
+
+void multicore_launch_core1(void (*entry)(void))
+{
+    core1_running = true;
+    std::thread core1([entry]() {
+        core_num = 1;
+        entry();
+        core1_running = false;
+    });
+    core1.detach();
+}
+
+void mock_multicore_note_change()
+{
+    change_count++;
+}
+
+void mock_multicore_note_waiting()
+{
+    // Core 1 has checked whatever it is waiting for since it last got here. If nothing changed in between, it has
+    // seen the latest change and is still waiting.
+    uint64_t changes = change_count.load();
+    if (changes == core1_last_seen) {
+        core1_idle_at = changes;
+    }
+    core1_last_seen = changes;
+}
+
+void mock_multicore_wait_for_idle()
+{
+    if (core_num != 0 || !core1_running) {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    while (core1_running && core1_idle_at.load() != change_count.load()) {
+        if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(MOCK_CORE1_IDLE_TIMEOUT_MS)) {
+            static bool warned = false;
+            if (!warned) {
+                printf("Debug: core 1 did not go idle within %d ms; the virtual clock is moving on without it\n",
+                       MOCK_CORE1_IDLE_TIMEOUT_MS);
+                warned = true;
+            }
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "pico/platform.h"
+
+// Start `entry` on core 1. The test harness emulates the second core with a std::thread, so code shared between
+// the cores (e.g. lock-free queues) runs truly in parallel with the main program, as it does on the RP2040.
+void multicore_launch_core1(void (*entry)(void));
+
+// Test harness only: keep core 1 in step with the virtual clock. Core 0 moves the clock, and before each move it
+// waits until core 1 has finished reacting to the last one, i.e. until core 1 is waiting (busy-waiting with
+// tight_loop_contents() twice in a row, or sleeping) with nothing having changed since. Computation on core 1 therefore
+// takes no virtual time, as on core 0, and the interleaving of the cores is the same on every run.
+void mock_multicore_note_change();     // Something core 1 may be waiting for has happened (the clock moved)
+void mock_multicore_note_waiting();    // Called by core 1 while it waits
+void mock_multicore_wait_for_idle();   // Called by core 0 before it moves the clock
@@ -0,0 +1,5 @@
+#pragma once
+
+// Number of the core the caller is running on (0 or 1). In the test harness, the main thread is core 0 and the
+// thread started by multicore_launch_core1() is core 1.
+unsigned int get_core_num();
@@ -3,7 +3,8 @@
 #include <chrono>
 
 #include "pico/stdlib.h"
-#include "ws2812.pio.h"
+#include "pico/time.h"
+#include "WS2812.pio.h"
 
 void stdio_init_all()
 {
@@ -12,10 +13,17 @@ void stdio_init_all()
 
 void sleep_ms(uint32_t ms)
 {
-    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    mock_clock_sleep_us((uint64_t)ms * 1000);
 }
 
 void sleep_us(uint32_t us)
 {
-    std::this_thread::sleep_for(std::chrono::microseconds(us));
+    mock_clock_sleep_us(us);
+}
+
+void tight_loop_contents()
+{
+    // Let the threads emulating DMA and interrupts run (or, with the virtual clock, the next event) while the caller
+    // busy-waits
+    mock_clock_busy_wait();
 }
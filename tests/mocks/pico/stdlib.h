@@ -1,8 +1,11 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
+#include "pico/platform.h"
 
 // Generic API
 typedef unsigned int uint;
 void stdio_init_all();
 void sleep_ms(uint32_t ms);
 void sleep_us(uint32_t us);
+void tight_loop_contents();
@@ -1,8 +1,112 @@
+#include <mutex>
+#include <set>
+#include <atomic>
+#include <thread>
+#include <string.h>
+#include <stdlib.h>
+
 #include "pico/time.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+#include "events.h"
+
+static std::mutex alarms_mutex;
+static std::set<alarm_id_t> active_alarms;
+static alarm_id_t next_alarm_id = 1;
+
+static std::atomic<int> virtual_clock_mode(-1); // -1 until the MOCK_CLOCK environment variable has been checked
+static std::atomic<uint64_t> virtual_time_us(0);
+
+bool mock_clock_is_virtual()
+{
+    if (virtual_clock_mode < 0) {
+        const char *mode = getenv("MOCK_CLOCK");
+        virtual_clock_mode = (mode != nullptr && strcmp(mode, "virtual") == 0) ? 1 : 0;
+    }
+    return virtual_clock_mode == 1;
+}
+
+void mock_clock_set_virtual(bool enabled)
+{
+    if (enabled && !mock_clock_is_virtual()) {
+        virtual_time_us = time_us_64(); // Carry on from the current wall clock time
+    }
+    virtual_clock_mode = enabled ? 1 : 0;
+}
+
+void mock_clock_advance_us(uint64_t us)
+{
+    if (!mock_clock_is_virtual()) {
+        return;
+    }
+    if (get_core_num() != 0) {
+        virtual_time_us += us;  // Only core 0 runs the event queue (see mock_multicore_wait_for_idle)
+        return;
+    }
+
+    // Run the events due before the target time in order, each at its own time
+    uint64_t target_us = virtual_time_us + us;
+    uint64_t due_us;
+    std::function<void()> callback;
+    for (;;) {
+        mock_multicore_wait_for_idle();
+        if (!mock_events_take_due(target_us, &due_us, &callback)) {
+            break;
+        }
+        if (due_us > virtual_time_us) {
+            virtual_time_us = due_us;
+        }
+        mock_multicore_note_change();
+        callback();
+    }
+    virtual_time_us = target_us;
+    mock_multicore_note_change();
+    mock_multicore_wait_for_idle();
+}
+
+void mock_clock_sleep_us(uint64_t us)
+{
+    if (!mock_clock_is_virtual()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    } else if (get_core_num() == 0) {
+        mock_clock_advance_us(us);
+    } else {
+        uint64_t wake_us = virtual_time_us + us;
+        while (virtual_time_us < wake_us) {
+            mock_multicore_note_waiting();
+            std::this_thread::yield();
+        }
+    }
+}
+
+void mock_clock_busy_wait()
+{
+    if (!mock_clock_is_virtual()) {
+        std::this_thread::yield();
+    } else if (get_core_num() == 0) {
+        uint64_t due_us, now = virtual_time_us, step_us = 1;
+        if (mock_events_next_due(&due_us)) {
+            step_us = due_us > now ? due_us - now : 0;
+        }
+        mock_clock_advance_us(step_us);
+    } else {
+        mock_multicore_note_waiting();
+        std::this_thread::yield();
+    }
+}
+
+uint64_t time_us_64()
+{
+    if (mock_clock_is_virtual()) {
+        return virtual_time_us;
+    }
+    static const std::chrono::steady_clock::time_point boot_time = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - boot_time).count();
+}
 
 absolute_time_t get_absolute_time() 
 {   
-    return std::chrono::steady_clock::now();
+    return absolute_time_t(std::chrono::microseconds(time_us_64()));
 }
 
 uint32_t to_ms_since_boot(absolute_time_t t)
@@ -11,3 +115,55 @@ uint32_t to_ms_since_boot(absolute_time_t t)
     auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
     return (uint32_t)millis;
 }
+
+// Fire an alarm (if it has not been cancelled) with interrupts disabled, like the timer interrupt handler
+static void fire_alarm(alarm_id_t id, alarm_callback_t callback, void *user_data)
+{
+    {
+        std::lock_guard<std::mutex> guard(alarms_mutex);
+        if (active_alarms.count(id) == 0) {
+            return;
+        }
+    }
+
+    uint32_t status = save_and_disable_interrupts();
+    int64_t reschedule_us = callback(id, user_data);
+    restore_interrupts(status);
+
+    if (reschedule_us != 0) {
+        uint64_t delay = reschedule_us > 0 ? reschedule_us : -reschedule_us;
+        mock_run_after_us(delay, [id, callback, user_data]() { fire_alarm(id, callback, user_data); });
+    } else {
+        std::lock_guard<std::mutex> guard(alarms_mutex);
+        active_alarms.erase(id);
+    }
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+    // An alarm due now has already passed by the time it could be set. As with the SDK, it is then either dropped
+    // (returning 0) or fired during this call, returning 0 unless the callback rescheduled it.
+    if (us == 0 && !fire_if_past) {
+        return 0;
+    }
+
+    alarm_id_t id;
+    {
+        std::lock_guard<std::mutex> guard(alarms_mutex);
+        id = next_alarm_id++;
+        active_alarms.insert(id);
+    }
+    if (us == 0) {
+        fire_alarm(id, callback, user_data);
+        std::lock_guard<std::mutex> guard(alarms_mutex);
+        return active_alarms.count(id) ? id : 0;
+    }
+    mock_run_after_us(us, [id, callback, user_data]() { fire_alarm(id, callback, user_data); });
+    return id;
+}
+
+bool cancel_alarm(alarm_id_t alarm_id)
+{
+    std::lock_guard<std::mutex> guard(alarms_mutex);
+    return active_alarms.erase(alarm_id) > 0;
+}
@@ -7,3 +7,34 @@ typedef std::chrono::time_point<std::chrono::steady_clock,std::chrono::steady_cl
 
 uint32_t to_ms_since_boot(absolute_time_t t);
 absolute_time_t get_absolute_time();
+
+// Microseconds since boot (the SDK declares this in hardware/timer.h, which pico/time.h includes)
+uint64_t time_us_64();
+
+// Test harness only: the clock read by time_us_64() and get_absolute_time(). By default it follows the host's wall
+// clock. In virtual mode (also selected by setting the MOCK_CLOCK environment variable to "virtual") it is a
+// discrete-event simulation: the clock only moves when core 0 sleeps, busy-waits or calls mock_clock_advance_us(),
+// and as it moves, the background hardware (DMA, alarms, the LEDs latching) runs from an event queue on core 0's
+// thread, in time order. Code takes no virtual time to run, so a long scenario runs as fast as the host allows and
+// gives the same results on every run. Select virtual mode before any hardware is started.
+void mock_clock_set_virtual(bool enabled);
+bool mock_clock_is_virtual();
+void mock_clock_advance_us(uint64_t us);
+
+// Test harness only: sleep on the mock clock (used by sleep_ms() and sleep_us()). With the virtual clock, core 1
+// waits for core 0 to move the clock past the end of the sleep instead.
+void mock_clock_sleep_us(uint64_t us);
+
+// Test harness only: a busy-wait on the mock clock (used by tight_loop_contents()). With the virtual clock, core 0
+// moves the clock on to the next queued event (or by 1 us if there is none), since nothing else can change.
+void mock_clock_busy_wait();
+
+// Alarms
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+
+// Call `callback` from "interrupt context" after `us` microseconds. As with the SDK, a positive return value from the
+// callback reschedules it that many microseconds later. An alarm in 0 us counts as already past: with `fire_if_past`
+// the callback runs before this returns, otherwise it never runs and 0 is returned.
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past);
+bool cancel_alarm(alarm_id_t alarm_id);
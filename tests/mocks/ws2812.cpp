@@ -1,77 +1,266 @@
-#include <vector>
-#include <iostream>
-#include <chrono>
 #include <atomic>
 #include <mutex>
+#include <math.h>
+#include <chrono>
 #include <thread>
-#include <semaphore>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "hardware/pio.h"
-#include "ws2812.pio.h"
+#include "pico/time.h"
+#include "WS2812.pio.h"
+#include "events.h"
+#include "utils/spsc_ring.h"
+
+#define MOCK_WS2812_LATCH_US 280      // Idle time after which the LEDs latch the colours they have received
+#define MOCK_WS2812_MAX_LEDS 256      // Longest frame recorded; further words are counted as overflow
+#define MOCK_WS2812_FRAME_QUEUE 256   // Latched frames that can wait to be logged (a power of two)
+#define MOCK_WS2812_WRITER_PERIOD_MS 2 // How often the writer thread logs the waiting frames (real clock only)
 
 void ws2812_program_impl(uint32_t data);
-void ws2812_idle_detection_thread();
 
 pio_program_t ws2812_program = ws2812_program_impl;
 
-// Array in which to receive the LED data during each call to pio_sm_put_blocking
-std::vector<uint32_t> mock_ws2812_leds;
-std::mutex mock_ws2812_leds_mutex;
-std::binary_semaphore mock_ws2812_semaphore (0); // to signal that the idle detection thread should wake up
+// One latched frame
+struct MockWS2812Frame {
+    uint64_t latch_us;        // Mock clock time the LEDs latched the frame
+    uint32_t interval_us;     // Time since the previous frame latched (0 for the first)
+    uint32_t latency_us;      // Time from the first word arriving to the frame latching
+    uint32_t count;           // Words received
+    uint32_t words[MOCK_WS2812_MAX_LEDS];
+};
+
+// The frame being received. Words go into one of two buffers, chosen by the generation in the top half of
+// `receive_state` (the bottom half is the number of words). Receiving a word and latching a frame both move the state
+// on with a compare-and-swap, so the words of a latched frame stay put while the next frame fills the other buffer,
+// and the word path takes no lock.
+static uint32_t receive_words[2][MOCK_WS2812_MAX_LEDS];
+static std::atomic<uint64_t> first_word_us[2];
+static std::atomic<uint64_t> receive_state(0);
+static std::atomic<uint64_t> last_word_us(0);
+static std::atomic<bool> latch_pending(false);
+static std::atomic<uint32_t> overflow_words(0);
 
-// Storage for the last update 
-std::atomic<std::chrono::steady_clock::time_point> last_update;
+// Latched frames, waiting to be logged. The producer is the latch check (there is only ever one pending) and the
+// consumer is the writer thread, or with the virtual clock the latch check itself, so that the output is in step with
+// the rest of the program.
+static SpscRing<MockWS2812Frame, MOCK_WS2812_FRAME_QUEUE> latched_frames;
+static MockWS2812Frame latching_frame;   // Filled by the latch check before being queued
+static MockWS2812Frame logging_frame;    // Being logged by the consumer
+static FILE *frame_log = nullptr;
+static unsigned int bytes_per_led = 3;
+
+// The latest latched frame, for mock_ws2812_last_frame()
+static std::mutex last_frame_mutex;
+static uint32_t last_frame_words[MOCK_WS2812_MAX_LEDS];
+static uint32_t last_frame_count = 0;
+
+// Statistics, updated by the latch check
+static uint64_t last_latch_us = 0;
+static std::atomic<uint32_t> frame_count(0), unlogged_count(0);
+static std::atomic<uint64_t> interval_sum_us(0), interval_square_sum(0), latency_sum_us(0), word_sum(0);
+static std::atomic<uint32_t> interval_min_us(UINT32_MAX), interval_max_us(0), latency_max_us(0);
+
+// Log (or print) every frame waiting in the queue
+static void log_frames()
+{
+    while (latched_frames.pop(logging_frame)) {
+        const MockWS2812Frame &frame = logging_frame;
+        if (frame_log != nullptr) {
+            fprintf(frame_log, "%llu,%u,%u,%u,", (unsigned long long)frame.latch_us, frame.interval_us,
+                    frame.latency_us, frame.count);
+            for (uint32_t i = 0; i < frame.count; ++i) {
+                fprintf(frame_log, "%0*x", 2 * bytes_per_led, frame.words[i] >> (32 - 8 * bytes_per_led));
+            }
+            fputc('\n', frame_log);
+            continue;
+        }
+        printf("Debug: LEDs (R,G,B) = ");
+        for (uint32_t i = 0; i < frame.count; ++i) {
+            uint32_t v = frame.words[i];
+            printf("(%03u,%03u,%03u),", (v >> 24) & 0xFF, (v >> 16) & 0xFF, (v >> 8) & 0xFF);
+        }
+        printf("\n");
+    }
+    if (frame_log != nullptr) {
+        fflush(frame_log);
+    }
+}
+
+static void writer_thread()
+{
+    for (;;) {
+        log_frames();
+        std::this_thread::sleep_for(std::chrono::milliseconds(MOCK_WS2812_WRITER_PERIOD_MS));
+    }
+}
 
 void ws2812_program_init(PIO pio, unsigned int sm, unsigned int offset, unsigned int pin, float freq, bool rgbw)
 {
-    last_update.store(std::chrono::steady_clock::now());
-    std::thread idle_detection (ws2812_idle_detection_thread);
-    idle_detection.detach();
+    // Each FIFO word holds one LED, shifted out one bit per cycle of `freq`
+    mock_pio_set_word_period_us(sm, (rgbw ? 32 : 24) * 1000000.0f / freq);
+    bytes_per_led = rgbw ? 4 : 3;
+
+    const char *path = getenv("MOCK_WS2812_FILE");
+    if (path != nullptr && frame_log == nullptr) {
+        frame_log = fopen(path, "w");
+        if (frame_log == nullptr) {
+            printf("Debug: WS2812 could not create %s\n", path);
+        } else {
+            fprintf(frame_log, "latch_us,interval_us,latency_us,leds,colours\n");
+        }
+    }
+    static bool writer_started = false;
+    if (!mock_clock_is_virtual() && !writer_started) {
+        std::thread(writer_thread).detach();
+        writer_started = true;
+    }
+}
+
+// Record the frame in buffer `buffer` (`count` words) as latched at `latch_us`
+static void record_frame(unsigned int buffer, uint32_t count, uint64_t latch_us)
+{
+    MockWS2812Frame &frame = latching_frame;
+    frame.latch_us = latch_us;
+    frame.interval_us = last_latch_us == 0 ? 0 : (uint32_t)(latch_us - last_latch_us);
+    frame.latency_us = (uint32_t)(latch_us - first_word_us[buffer].load(std::memory_order_relaxed));
+    frame.count = count;
+    for (uint32_t i = 0; i < count; ++i) {
+        frame.words[i] = receive_words[buffer][i];
+    }
+
+    frame_count.fetch_add(1, std::memory_order_relaxed);
+    word_sum.fetch_add(count, std::memory_order_relaxed);
+    latency_sum_us.fetch_add(frame.latency_us, std::memory_order_relaxed);
+    if (frame.latency_us > latency_max_us.load(std::memory_order_relaxed)) {
+        latency_max_us.store(frame.latency_us, std::memory_order_relaxed);
+    }
+    if (last_latch_us != 0) {
+        uint64_t interval = frame.interval_us;
+        interval_sum_us.fetch_add(interval, std::memory_order_relaxed);
+        interval_square_sum.fetch_add(interval * interval, std::memory_order_relaxed);
+        if (frame.interval_us < interval_min_us.load(std::memory_order_relaxed)) {
+            interval_min_us.store(frame.interval_us, std::memory_order_relaxed);
+        }
+        if (frame.interval_us > interval_max_us.load(std::memory_order_relaxed)) {
+            interval_max_us.store(frame.interval_us, std::memory_order_relaxed);
+        }
+    }
+    last_latch_us = latch_us;
+    {
+        std::lock_guard<std::mutex> guard(last_frame_mutex);
+        memcpy(last_frame_words, frame.words, count * sizeof(uint32_t));
+        last_frame_count = count;
+    }
+
+    if (!latched_frames.push(frame)) {
+        unlogged_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (mock_clock_is_virtual()) {
+        log_frames();
+    }
 }
 
-void ws2812_program_impl(uint32_t data) 
+// Latch the frame once the line has been idle for MOCK_WS2812_LATCH_US. This emulates the real wire protocol where
+// idle means to latch the latest values. If more data arrived since the check was scheduled, check again when the
+// line will next have been idle for long enough.
+static void ws2812_check_latch()
 {
-    // Store the LED colour we received
-    std::lock_guard<std::mutex> guard(mock_ws2812_leds_mutex);
-    mock_ws2812_leds.push_back(data);
-    // Reset the idle detection timer (because the real LEDs wait for the bus to go idle before latching the colours)
-    last_update.store(std::chrono::steady_clock::now());
-    // Signal to the idle detection thread
-    mock_ws2812_semaphore.release();
+    uint64_t last_us = last_word_us.load(std::memory_order_acquire);
+    uint64_t idle_us = time_us_64() - last_us;
+    if (idle_us < MOCK_WS2812_LATCH_US) {
+        mock_run_after_us(MOCK_WS2812_LATCH_US - idle_us, ws2812_check_latch);
+        return;
+    }
+
+    uint64_t state = receive_state.load(std::memory_order_acquire);
+    uint32_t count = (uint32_t)state;
+    if (count != 0) {
+        uint64_t generation = state >> 32;
+        if (!receive_state.compare_exchange_strong(state, (generation + 1) << 32, std::memory_order_acq_rel)) {
+            mock_run_after_us(MOCK_WS2812_LATCH_US, ws2812_check_latch); // A word has just arrived
+            return;
+        }
+        record_frame(generation & 1, count, last_us + MOCK_WS2812_LATCH_US);
+    }
+
+    // A word that arrived while this check was still pending did not schedule another one
+    latch_pending.store(false, std::memory_order_release);
+    if ((uint32_t)receive_state.load(std::memory_order_acquire) != 0 && !latch_pending.exchange(true)) {
+        mock_run_after_us(MOCK_WS2812_LATCH_US, ws2812_check_latch);
+    }
 }
 
-// Display the LED status 280us after the last message was posted. This emulates the real wire protocol where idle 
-// means to latch the latest values.
-void ws2812_idle_detection_thread()
+void ws2812_program_impl(uint32_t data)
 {
-    for (;;) {
-        // Wait for activity
-        mock_ws2812_semaphore.acquire();
-        std::this_thread::sleep_for(std::chrono::microseconds(280));
-        
-        for (;;) {
-            // Check that enough time has elapsed
-            auto elapsed = std::chrono::steady_clock::now() - last_update.load();
-            if (elapsed > std::chrono::microseconds(280)) {
-                std::lock_guard<std::mutex> guard(mock_ws2812_leds_mutex);
-                if (mock_ws2812_leds.size() > 0 ) {
-                    printf("Debug: LEDs (R,G,B) = ");
-
-                    for (uint32_t v : mock_ws2812_leds) {
-                        uint8_t r = (0xFF000000 & v) >> 24;
-                        uint8_t g = (0xFF0000 & v) >> 16;
-                        uint8_t b = (0xFF00 & v) >> 8;
-                        printf("(%03u,%03u,%03u),", r, g, b);
-                    }
-                    printf("\n");
-
-                    mock_ws2812_leds.clear();
-                    break;
-                }
-            }
+    // Reset the idle detection timer (because the real LEDs wait for the bus to go idle before latching the colours).
+    // This is stored before the word is published, so a latch check that sees the word also sees its time.
+    uint64_t now = time_us_64();
+    last_word_us.store(now, std::memory_order_release);
 
-            // Otherwise, wait 10us and try again 
-            std::this_thread::sleep_for(std::chrono::microseconds(10));
+    // Store the LED colour we received in the current frame's buffer
+    uint64_t state = receive_state.load(std::memory_order_acquire);
+    for (;;) {
+        uint32_t count = (uint32_t)state;
+        unsigned int buffer = (unsigned int)(state >> 32) & 1;
+        if (count == MOCK_WS2812_MAX_LEDS) {
+            overflow_words.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        receive_words[buffer][count] = data;
+        if (count == 0) {
+            first_word_us[buffer].store(now, std::memory_order_relaxed);
+        }
+        if (receive_state.compare_exchange_weak(state, state + 1, std::memory_order_acq_rel)) {
+            break;
         }
     }
+
+    if (!latch_pending.exchange(true)) {
+        mock_run_after_us(MOCK_WS2812_LATCH_US, ws2812_check_latch);
+    }
+}
+
+void mock_ws2812_print_stats()
+{
+    static uint32_t last_frames, last_unlogged;
+    static uint64_t last_interval_sum, last_interval_square_sum, last_latency_sum, last_word_sum, last_report_us;
+
+    uint64_t now = time_us_64();
+    uint32_t frames = frame_count.load() - last_frames;
+    uint64_t interval_sum = interval_sum_us.load() - last_interval_sum;
+    uint64_t square_sum = interval_square_sum.load() - last_interval_square_sum;
+    double elapsed_s = (now - last_report_us) / 1e6;
+
+    // Intervals are counted from the second frame ever, so there may be one fewer than frames
+    uint32_t intervals = last_frames == 0 && frames > 0 ? frames - 1 : frames;
+    double mean = intervals ? (double)interval_sum / intervals : 0.0;
+    double variance = intervals ? (double)square_sum / intervals - mean * mean : 0.0;
+    printf("WS2812: %u frames (%.1f per second), %.1f bytes per frame, interval mean %.0f us, jitter %.0f us "
+           "(min %u, max %u), latency mean %.0f us, max %u us, %u frames not logged, %u words overflowed\n",
+           (unsigned)frames, elapsed_s > 0 ? frames / elapsed_s : 0.0,
+           frames ? (double)(word_sum.load() - last_word_sum) * bytes_per_led / frames : 0.0, mean,
+           variance > 0 ? sqrt(variance) : 0.0, intervals ? (unsigned)interval_min_us.load() : 0u,
+           (unsigned)interval_max_us.load(), frames ? (double)(latency_sum_us.load() - last_latency_sum) / frames : 0.0,
+           (unsigned)latency_max_us.load(), (unsigned)(unlogged_count.load() - last_unlogged),
+           (unsigned)overflow_words.load());
+
+    last_frames = frame_count.load();
+    last_unlogged = unlogged_count.load();
+    last_interval_sum = interval_sum_us.load();
+    last_interval_square_sum = interval_square_sum.load();
+    last_latency_sum = latency_sum_us.load();
+    last_word_sum = word_sum.load();
+    last_report_us = now;
+    interval_min_us = UINT32_MAX;
+    interval_max_us = 0;
+    latency_max_us = 0;
+}
+
+uint32_t mock_ws2812_last_frame(uint32_t *words, uint32_t max_words)
+{
+    std::lock_guard<std::mutex> guard(last_frame_mutex);
+    memcpy(words, last_frame_words, (last_frame_count < max_words ? last_frame_count : max_words) * sizeof(uint32_t));
+    return last_frame_count;
 }
@@ -0,0 +1,75 @@
+// test_led_color.cpp
+// The compile-time colour tables (src/drivers/led_color.h).
+
+#include "unit_test.h"
+#include "drivers/led_color.h"
+
+// The original hueToRGB() from led_task.cpp, with its brightness of 200 as a parameter
+static void old_hue_to_rgb(unsigned int hue, float brightness, uint8_t *red, uint8_t *green, uint8_t *blue)
+{
+    float s = 1.0;  // Maximum saturation
+    float v = brightness;
+    float h = hue / 60.0;
+    int i = (int)h;
+    float f = h - (float)i;
+    float p = v * (1 - s);
+    float q = v * (1 - s * f);
+    float t = v * (1 - s * (1 - f));
+
+    switch (i) {
+    case 0:
+        *red = v, *green = t, *blue = p;
+        break;
+    case 1:
+        *red = q, *green = v, *blue = p;
+        break;
+    case 2:
+        *red = p, *green = v, *blue = t;
+        break;
+    case 3:
+        *red = p, *green = q, *blue = v;
+        break;
+    case 4:
+        *red = t, *green = p, *blue = v;
+        break;
+    case 5:
+    default:
+        *red = v, *green = p, *blue = q;
+        break;
+    }
+
+    *red = (uint8_t)*red;
+    *green = (uint8_t)*green;
+    *blue = (uint8_t)*blue;
+}
+
+TEST(led_color, hue_wheel_matches_float_conversion)
+{
+    static constexpr std::array<RGBColor, HUE_WHEEL_STEPS> wheel = make_hue_wheel(200.0);
+    for (unsigned int hue = 0; hue < HUE_WHEEL_STEPS; ++hue) {
+        uint8_t red, green, blue;
+        old_hue_to_rgb(hue, 200.0, &red, &green, &blue);
+        CHECK_EQUAL(red, wheel[hue].red);
+        CHECK_EQUAL(green, wheel[hue].green);
+        CHECK_EQUAL(blue, wheel[hue].blue);
+    }
+}
+
+TEST(led_color, gamma_table)
+{
+    static constexpr std::array<uint16_t, 256> table = make_gamma_table(LED_GAMMA);
+    CHECK_EQUAL(0, table[0]);
+    CHECK_EQUAL(255 << 8, table[255]);
+    for (unsigned int i = 1; i < 256; ++i) {
+        CHECK(table[i] >= table[i - 1]);
+    }
+    CHECK_EQUAL(14330, table[128]);  // 255 * (128 / 255)^2.2 = 55.98 in 8.8 fixed point
+}
+
+TEST(led_color, linear_table)
+{
+    static constexpr std::array<uint16_t, 256> table = make_linear_table();
+    for (unsigned int i = 0; i < 256; ++i) {
+        CHECK_EQUAL(i << 8, table[i]);
+    }
+}
@@ -0,0 +1,98 @@
+// test_leds.cpp
+// The LED driver's change detection and colour stage, against the mock WS2812 strip on the virtual clock.
+
+#include "unit_test.h"
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#include "drivers/leds.h"
+#include "WS2812.pio.h"
+
+#define TEST_LEDS 4
+
+// The strip shared by every test (the mock PIO cannot unload its program), back in its default state
+static LEDs &reset_strip()
+{
+    mock_clock_set_virtual(true);
+    static LEDs strip(0, TEST_LEDS, pio0, 0);
+    strip.waitForLatch();
+    strip.setBrightness(255);
+    strip.setGammaCorrection(false);
+    strip.setDithering(false);
+    strip.clear();
+    return strip;
+}
+
+// Wait until the strip has latched everything committed so far
+static void wait_for_strip(LEDs &strip)
+{
+    strip.waitForLatch();
+    sleep_us(1000);  // The mock latches once the line has been idle, independently of the driver's alarm
+}
+
+// Red channel of the latest frame the strip latched for LED `led`
+static uint32_t latched_red(unsigned int led)
+{
+    uint32_t words[TEST_LEDS];
+    CHECK_EQUAL(TEST_LEDS, mock_ws2812_last_frame(words, TEST_LEDS));
+    return words[led] >> 24;
+}
+
+TEST(leds, unchanged_frames_are_skipped)
+{
+    LEDs &strip = reset_strip();
+    uint32_t sent = strip.framesSent();
+    uint32_t skipped = strip.framesSkipped();
+    strip.setColor(0, 10, 20, 30);
+    CHECK(strip.commit());
+    wait_for_strip(strip);
+    CHECK(!strip.commit());
+    CHECK(strip.commit(true));
+    wait_for_strip(strip);
+    strip.setColor(1, 1, 1, 1);
+    CHECK(strip.commit());
+    wait_for_strip(strip);
+    CHECK_EQUAL(sent + 3, strip.framesSent());
+    CHECK_EQUAL(skipped + 1, strip.framesSkipped());
+}
+
+TEST(leds, colours_are_sent_as_drawn_by_default)
+{
+    LEDs &strip = reset_strip();
+    strip.setColor(2, 100, 50, 200);
+    strip.commit();
+    wait_for_strip(strip);
+    uint32_t words[TEST_LEDS];
+    CHECK_EQUAL(TEST_LEDS, mock_ws2812_last_frame(words, TEST_LEDS));
+    CHECK_EQUAL(0, words[0]);
+    CHECK_EQUAL((100u << 24) | (50u << 16) | (200u << 8), words[2]);
+
+    // Gamma correction is opt-in
+    strip.setGammaCorrection(true);
+    CHECK(strip.commit());
+    wait_for_strip(strip);
+    CHECK_EQUAL(33, latched_red(2));  // 255 * (100 / 255)^2.2 = 32.5
+}
+
+TEST(leds, dithering_resends_unchanged_frames)
+{
+    LEDs &strip = reset_strip();
+    strip.setBrightness(127);  // Half brightness: a level of 1 goes out as 0.5
+    strip.setDithering(true);
+    strip.setColor(0, 1, 0, 0);
+    uint32_t skipped = strip.framesSkipped();
+
+    // The LED shows the half level on average only if every frame is sent
+    uint32_t sum = 0;
+    for (int frame = 0; frame < 8; ++frame) {
+        CHECK(strip.commit());
+        wait_for_strip(strip);
+        sum += latched_red(0);
+    }
+    CHECK_EQUAL(4, sum);
+    CHECK_EQUAL(skipped, strip.framesSkipped());
+
+    // Once dithering is off, unchanged frames are skipped again
+    strip.setDithering(false);
+    CHECK(strip.commit());
+    CHECK(!strip.commit());
+}
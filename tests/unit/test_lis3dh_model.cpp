@@ -0,0 +1,305 @@
+// test_lis3dh_model.cpp
+// The LIS3DH register model (tests/mocks/lis3dh_model.h) in FIFO stream mode, driven through the LIS3DH driver on
+// the virtual clock.
+
+#include "unit_test.h"
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#include "drivers/lis3dh.h"
+#include "lis3dh_model.h"
+
+#define SAMPLE_PERIOD_US 10000 // At 100 Hz
+#define RAMP_LENGTH 200        // Samples before the X ramp starts again
+
+// X counts up one digit (4 mg at 2 g in normal mode) per sample, so the order of the samples read can be checked
+static void ramp_motion(uint64_t t_us, int16_t mg[3])
+{
+    mg[0] = (int16_t)(4 * ((t_us / SAMPLE_PERIOD_US) % RAMP_LENGTH) - 400);
+    mg[1] = 1000;
+    mg[2] = -500;
+}
+
+// The sensor shared by every test, set up at 100 Hz with an empty FIFO in stream mode
+static LIS3DH &reset_sensor(uint8_t watermark)
+{
+    mock_clock_set_virtual(true);
+    static LIS3DH sensor(i2c0, 0x19, 16, 17);
+    static bool initialised = false;
+    mock_lis3dh().set_motion(ramp_motion);
+    if (!initialised) {
+        LIS3DHConfig config;
+        config.data_rate = LIS3DH_ODR_100HZ;
+        config.range = LIS3DH_RANGE_2G;
+        config.mode = LIS3DH_MODE_NORMAL;
+        initialised = sensor.init(400000, config);
+        CHECK(initialised);
+    }
+    CHECK(sensor.enable_fifo_stream(watermark));
+    return sensor;
+}
+
+// True if each sample is the one after the previous
+static bool samples_in_order(const LIS3DHSample *samples, int count)
+{
+    for (int i = 1; i < count; ++i) {
+        if ((samples[i].x - samples[i - 1].x + RAMP_LENGTH) % RAMP_LENGTH != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint8_t fifo_src(LIS3DH &sensor)
+{
+    uint8_t src = 0;
+    CHECK(sensor.read_register(0x2F, &src, 1));
+    return src;
+}
+
+TEST(lis3dh_model, fills_and_reads_in_order)
+{
+    LIS3DH &sensor = reset_sensor(16);
+    CHECK(fifo_src(sensor) & 0x20);  // EMPTY
+
+    sleep_us(10 * SAMPLE_PERIOD_US + SAMPLE_PERIOD_US / 2);
+    uint8_t src = fifo_src(sensor);
+    CHECK((src & 0x1F) >= 10 && (src & 0x1F) <= 11);
+    CHECK(!(src & 0xE0));  // No watermark, overrun or empty flag
+
+    LIS3DHSample samples[LIS3DH_FIFO_DEPTH];
+    int count = sensor.read_fifo(samples, LIS3DH_FIFO_DEPTH);
+    CHECK_EQUAL(src & 0x1F, count);
+    CHECK(samples_in_order(samples, count));
+    CHECK_EQUAL(250, samples[0].y);   // 1000 mg at 4 mg per digit
+    CHECK_EQUAL(-125, samples[0].z);
+    CHECK(fifo_src(sensor) & 0x20);
+
+    // The next batch carries on from the last sample read
+    LIS3DHSample last = samples[count - 1];
+    sleep_us(5 * SAMPLE_PERIOD_US);
+    count = sensor.read_fifo(samples, LIS3DH_FIFO_DEPTH);
+    CHECK(count >= 4 && count <= 6);
+    CHECK_EQUAL((last.x + 1 + 100) % RAMP_LENGTH - 100, samples[0].x);
+    CHECK(samples_in_order(samples, count));
+    CHECK_EQUAL(0, sensor.fifo_overruns());
+}
+
+TEST(lis3dh_model, raises_watermark)
+{
+    LIS3DH &sensor = reset_sensor(8);
+    sleep_us(7 * SAMPLE_PERIOD_US + SAMPLE_PERIOD_US / 2);
+    uint8_t src = fifo_src(sensor);
+    CHECK((src & 0x1F) <= 8);
+    CHECK(!(src & 0x80));  // Not yet above the watermark
+    sleep_us(2 * SAMPLE_PERIOD_US);
+    src = fifo_src(sensor);
+    CHECK((src & 0x1F) > 8);
+    CHECK(src & 0x80);
+}
+
+TEST(lis3dh_model, stream_mode_overrun)
+{
+    LIS3DH &sensor = reset_sensor(16);
+    uint32_t overruns = sensor.fifo_overruns();
+    uint32_t overwritten = mock_lis3dh().samples_overwritten();
+
+    // 100 samples into a 32-level FIFO: the oldest 68 are discarded
+    sleep_us(100 * SAMPLE_PERIOD_US + SAMPLE_PERIOD_US / 2);
+    CHECK(fifo_src(sensor) & 0x40);  // OVRN_FIFO
+    LIS3DHSample samples[LIS3DH_FIFO_DEPTH];
+    int count = sensor.read_fifo(samples, LIS3DH_FIFO_DEPTH);
+    CHECK_EQUAL(LIS3DH_FIFO_DEPTH, count);
+    CHECK_EQUAL(overruns + 1, sensor.fifo_overruns());
+    CHECK_EQUAL(overwritten + 100 - LIS3DH_FIFO_DEPTH, mock_lis3dh().samples_overwritten());
+    CHECK(samples_in_order(samples, count));
+
+    // Reading cleared the overrun, and the FIFO carries on collecting
+    sleep_us(3 * SAMPLE_PERIOD_US);
+    CHECK(!(fifo_src(sensor) & 0x40));
+    count = sensor.read_fifo(samples, LIS3DH_FIFO_DEPTH);
+    CHECK(count >= 2 && count <= 4);
+    CHECK_EQUAL(overruns + 1, sensor.fifo_overruns());
+}
+
+TEST(lis3dh_model, bypass_after_disabling_fifo)
+{
+    LIS3DH &sensor = reset_sensor(16);
+    CHECK(sensor.disable_fifo());
+    sleep_us(3 * SAMPLE_PERIOD_US);
+    int16_t x, y, z;
+    CHECK(sensor.read_acceleration(&x, &y, &z));
+    CHECK_EQUAL(250, y);
+    CHECK_EQUAL(-125, z);
+    CHECK(fifo_src(sensor) & 0x20);  // The FIFO stays empty in bypass mode
+}
+
+static void wait_for_async(LIS3DH &sensor)
+{
+    while (sensor.async_busy()) {
+        tight_loop_contents();
+    }
+}
+
+static void on_async_read(bool ok, void *context)
+{
+    *static_cast<int *>(context) = ok ? 1 : 0;
+}
+
+TEST(lis3dh_model, async_register_read)
+{
+    LIS3DH &sensor = reset_sensor(16);
+    CHECK(sensor.async_available());
+    uint8_t who_am_i = 0;
+    int result = -1;
+    CHECK(sensor.read_register_async(0x0F, &who_am_i, 1, on_async_read, &result));
+    CHECK(sensor.async_busy());
+    CHECK(!sensor.read_register_async(0x0F, &who_am_i, 1, on_async_read, &result));  // One read at a time
+    wait_for_async(sensor);
+    CHECK_EQUAL(1, result);
+    CHECK_EQUAL(0x33, who_am_i);
+
+    // The controller is left enabled and addressing the sensor, so the next transfer need not touch it
+    i2c_hw_t *hw = i2c_get_hw(i2c0);
+    CHECK(hw->enable & I2C_IC_ENABLE_ENABLE_BITS);
+    CHECK_EQUAL(0x19, hw->tar);
+}
+
+// Asynchronous batches carry on from blocking reads, and from each other, without losing or reordering samples
+TEST(lis3dh_model, async_fifo_reads_in_order)
+{
+    LIS3DH &sensor = reset_sensor(16);
+    LIS3DHSample samples[LIS3DH_FIFO_DEPTH];
+    sleep_us(5 * SAMPLE_PERIOD_US);
+    int count = sensor.read_fifo(samples, LIS3DH_FIFO_DEPTH);
+    CHECK(count > 0);
+    int16_t last_x = samples[count - 1].x;
+
+    for (int batch = 0; batch < 5; ++batch) {
+        sleep_us(10 * SAMPLE_PERIOD_US);
+        CHECK(sensor.start_fifo_read());
+        CHECK_EQUAL(0, sensor.collect_fifo(samples, LIS3DH_FIFO_DEPTH));  // Still in flight
+        wait_for_async(sensor);
+        count = sensor.collect_fifo(samples, LIS3DH_FIFO_DEPTH);
+        CHECK(count >= 9 && count <= 11);
+        CHECK_EQUAL((last_x + 1 + 100) % RAMP_LENGTH - 100, samples[0].x);
+        CHECK(samples_in_order(samples, count));
+        CHECK_EQUAL(0, sensor.collect_fifo(samples, LIS3DH_FIFO_DEPTH));  // Only collected once
+        last_x = samples[count - 1].x;
+    }
+}
+
+TEST(lis3dh_model, async_read_reports_nak)
+{
+    LIS3DH &sensor = reset_sensor(16);
+    LIS3DHSample samples[LIS3DH_FIFO_DEPTH];
+    mock_i2c_attach(i2c0, 0x19, nullptr);
+    CHECK(sensor.start_fifo_read());
+    wait_for_async(sensor);
+    CHECK_EQUAL(-1, sensor.collect_fifo(samples, LIS3DH_FIFO_DEPTH));
+
+    // Once the sensor answers again, so do reads
+    mock_i2c_attach(i2c0, 0x19, &mock_lis3dh());
+    sleep_us(3 * SAMPLE_PERIOD_US);
+    CHECK(sensor.start_fifo_read());
+    wait_for_async(sensor);
+    CHECK(sensor.collect_fifo(samples, LIS3DH_FIFO_DEPTH) > 0);
+}
+
+// Passes transactions through to the sensor model, but NAKs writes to one register
+class FailingWrites : public MockI2CDevice {
+public:
+    explicit FailingWrites(uint8_t reg) : failing_reg(reg) {}
+
+    bool write(const uint8_t *data, size_t length, bool nostop) override
+    {
+        if (length > 1 && (data[0] & 0x7F) == failing_reg) {
+            return false;
+        }
+        return mock_lis3dh().write(data, length, nostop);
+    }
+
+    bool read(uint8_t *data, size_t length, bool nostop) override
+    {
+        return mock_lis3dh().read(data, length, nostop);
+    }
+
+private:
+    uint8_t failing_reg;
+};
+
+TEST(lis3dh_model, failed_configure_leaves_sensor_unchanged)
+{
+    LIS3DH &sensor = reset_sensor(16);
+    uint8_t ctrl_reg1 = mock_lis3dh().peek(0x20);
+    uint8_t ctrl_reg4 = mock_lis3dh().peek(0x23);
+    LIS3DHConfig config = sensor.config();
+    LIS3DHConfig change;
+    change.data_rate = LIS3DH_ODR_400HZ;
+    change.range = LIS3DH_RANGE_8G;
+    change.mode = LIS3DH_MODE_HIGH_RESOLUTION;
+
+    // CTRL_REG1 is written and then put back when CTRL_REG4 cannot be
+    FailingWrites failing(0x23);
+    mock_i2c_attach(i2c0, 0x19, &failing);
+    CHECK(!sensor.configure(change));
+    mock_i2c_attach(i2c0, 0x19, &mock_lis3dh());
+    CHECK_EQUAL(ctrl_reg1, mock_lis3dh().peek(0x20));
+    CHECK_EQUAL(ctrl_reg4, mock_lis3dh().peek(0x23));
+    CHECK_EQUAL(config.data_rate, sensor.config().data_rate);
+    CHECK_EQUAL(config.range, sensor.config().range);
+    CHECK_EQUAL(100, sensor.data_rate_hz());
+
+    // A mode that cannot run at the data rate is rejected before anything is written
+    change.data_rate = LIS3DH_ODR_5376HZ;
+    CHECK(!sensor.configure(change));
+    CHECK_EQUAL(ctrl_reg1, mock_lis3dh().peek(0x20));
+}
+
+// Milli-g per digit for every mode and range (datasheet table 4), against the integer conversion at full scale
+TEST(lis3dh_model, converts_to_mg)
+{
+    LIS3DH &sensor = reset_sensor(16);
+    static const int sensitivities[3][4] = {{16, 32, 64, 192}, {4, 8, 16, 48}, {1, 2, 4, 12}};
+    static const int bits[3] = {8, 10, 12};
+    for (int mode = LIS3DH_MODE_LOW_POWER; mode <= LIS3DH_MODE_HIGH_RESOLUTION; ++mode) {
+        for (int range = LIS3DH_RANGE_2G; range <= LIS3DH_RANGE_16G; ++range) {
+            LIS3DHConfig config;
+            config.data_rate = LIS3DH_ODR_100HZ;
+            config.range = (LIS3DHRange)range;
+            config.mode = (LIS3DHMode)mode;
+            CHECK(sensor.configure(config));
+            CHECK_EQUAL(sensitivities[mode][range], sensor.sensitivity_mg());
+
+            int16_t full_scale = (int16_t)((1 << (bits[mode] - 1)) - 1);
+            LIS3DHSample samples[2] = {{full_scale, (int16_t)(-full_scale - 1), 0}, {1, -1, 0}};
+            LIS3DHAcceleration accelerations[2];
+            sensor.convert_to_mg(samples, accelerations, 2);
+            CHECK_EQUAL(full_scale * sensitivities[mode][range], accelerations[0].x_mg);
+            CHECK_EQUAL((-full_scale - 1) * sensitivities[mode][range], accelerations[0].y_mg);
+            CHECK_EQUAL(0, accelerations[0].z_mg);
+            CHECK_EQUAL(sensitivities[mode][range], accelerations[1].x_mg);
+            CHECK_EQUAL(-sensitivities[mode][range], accelerations[1].y_mg);
+        }
+    }
+
+    // The integer and float reads agree on a sample from the model (1000 mg on Y, -500 mg on Z)
+    LIS3DHConfig config;
+    config.data_rate = LIS3DH_ODR_100HZ;
+    config.range = LIS3DH_RANGE_4G;
+    config.mode = LIS3DH_MODE_HIGH_RESOLUTION;
+    CHECK(sensor.configure(config));
+    CHECK(sensor.disable_fifo());
+    sleep_us(2 * SAMPLE_PERIOD_US);
+    int16_t x_mg, y_mg, z_mg;
+    float x_g, y_g, z_g;
+    CHECK(sensor.read_acceleration_mg(&x_mg, &y_mg, &z_mg));
+    CHECK_EQUAL(1000, y_mg);
+    CHECK_EQUAL(-500, z_mg);
+    CHECK(sensor.read_acceleration_g(&x_g, &y_g, &z_g));
+    CHECK(y_g > 0.999f && y_g < 1.001f);
+    CHECK(z_g > -0.501f && z_g < -0.499f);
+
+    config.range = LIS3DH_RANGE_2G;
+    config.mode = LIS3DH_MODE_NORMAL;
+    CHECK(sensor.configure(config));
+}
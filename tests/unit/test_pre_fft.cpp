@@ -0,0 +1,128 @@
+// test_pre_fft.cpp
+// The fused pre-FFT kernel against the original multi-pass pre-processing (see pre_fft_reference.h).
+
+#include <string.h>
+
+#include "unit_test.h"
+#include "pre_fft_reference.h"
+#include "dsp/pre_fft.h"
+#include "dsp/window.h"
+
+#define FRAME PRE_FFT_REFERENCE_SAMPLE_SIZE
+
+static uint32_t random_state = 1;
+static uint32_t next_random()
+{
+    random_state = random_state * 1664525u + 1013904223u;
+    return random_state >> 8;
+}
+
+// A frame around `centre` (raw ADC codes), deviating by up to `spread` codes, clamped to 12 bits
+static void make_frame(uint16_t *raw, size_t length, int centre, int spread)
+{
+    for (size_t i = 0; i < length; ++i) {
+        int value = centre + (int)(next_random() % (2 * spread + 1)) - spread;
+        raw[i] = (uint16_t)(value < 0 ? 0 : value > 4095 ? 4095 : value);
+    }
+}
+
+// Run the original passes on `raw`, then the fused kernel with the same DC, and check the outputs are identical
+static void check_against_old_passes(const uint16_t *raw, const int16_t *window, int16_t *out, size_t length)
+{
+    static int16_t offset[FRAME];
+    static int16_t expected[FRAME];
+    old_read_blocking_offset(raw, offset, length);
+    int32_t dc_bias = old_pre_fft_passes(offset, window, expected, (int)length);
+
+    PreFftState state;
+    pre_fft_init(&state, DC_OFFSET + dc_bias, 0);
+    pre_fft_process(&state, raw, window, out, length);
+    for (size_t i = 0; i < length; ++i) {
+        CHECK_EQUAL(expected[i], out[i]);
+    }
+}
+
+TEST(pre_fft, window_matches_matlab_table)
+{
+    static constexpr std::array<int16_t, FRAME> window = make_hann_window_q15<FRAME>();
+    for (size_t i = 0; i < FRAME; ++i) {
+        CHECK_EQUAL(old_hanning_window[i], window[i]);
+    }
+}
+
+// Within the range where the original code did not wrap around (|sample - mean| * 32 fits in 16 bits), the fused
+// kernel gives bit-identical output
+TEST(pre_fft, matches_old_passes)
+{
+    alignas(4) static uint16_t raw[FRAME];
+    alignas(4) static int16_t out[FRAME];
+    for (int frame = 0; frame < 200; ++frame) {
+        int centre = 1500 + (int)(next_random() % 1100);
+        make_frame(raw, FRAME, centre, 1 + (int)(next_random() % 900));
+        check_against_old_passes(raw, old_hanning_window, out, FRAME);
+    }
+}
+
+// The unaligned and odd-length paths of the kernel
+TEST(pre_fft, matches_old_passes_unaligned_and_odd_length)
+{
+    alignas(4) static uint16_t raw[FRAME + 1];
+    alignas(4) static int16_t out[FRAME + 1];
+    for (int frame = 0; frame < 50; ++frame) {
+        make_frame(raw, FRAME + 1, DC_OFFSET, 900);
+        check_against_old_passes(raw + 1, old_hanning_window, out, FRAME);      // Unaligned input
+        check_against_old_passes(raw, old_hanning_window, out + 1, FRAME);      // Unaligned output
+        check_against_old_passes(raw, old_hanning_window, out, FRAME - 1);      // Odd length, aligned
+        check_against_old_passes(raw + 1, old_hanning_window, out, FRAME - 1);  // Odd length, unaligned
+    }
+}
+
+// Where the original code wrapped around, the kernel saturates instead
+TEST(pre_fft, saturates_where_old_passes_wrapped)
+{
+    alignas(4) static uint16_t raw[FRAME];
+    alignas(4) static int16_t out[FRAME];
+    static int16_t offset[FRAME];
+    static int16_t old_output[FRAME];
+    for (size_t i = 0; i < FRAME; ++i) {
+        raw[i] = (i / 8) % 2 ? 4095 : 0;  // Full scale square wave
+    }
+    old_read_blocking_offset(raw, offset, FRAME);
+    int32_t dc_bias = old_pre_fft_passes(offset, old_hanning_window, old_output, FRAME);
+
+    PreFftState state;
+    pre_fft_init(&state, DC_OFFSET + dc_bias, 0);
+    pre_fft_process(&state, raw, old_hanning_window, out, FRAME);
+
+    unsigned int wrapped = 0;
+    for (size_t i = 0; i < FRAME; ++i) {
+        int32_t amplified = ((int32_t)raw[i] - (DC_OFFSET + dc_bias)) * 32;
+        amplified = amplified > INT16_MAX ? INT16_MAX : amplified < INT16_MIN ? INT16_MIN : amplified;
+        CHECK_EQUAL((amplified * old_hanning_window[i]) >> 15, out[i]);
+        wrapped += old_output[i] != out[i];
+    }
+    CHECK(wrapped > FRAME / 2);
+}
+
+TEST(pre_fft, tracks_frame_mean)
+{
+    alignas(4) static uint16_t raw[FRAME];
+    alignas(4) static int16_t out[FRAME];
+    make_frame(raw, FRAME, 2500, 300);
+    uint32_t sum = 0;
+    for (size_t i = 0; i < FRAME; ++i) {
+        sum += raw[i];
+    }
+    int32_t mean = (int32_t)(sum / FRAME);
+
+    // Without smoothing the next frame uses this frame's mean
+    PreFftState state;
+    pre_fft_init(&state, DC_OFFSET, 0);
+    pre_fft_process(&state, raw, old_hanning_window, out, FRAME);
+    CHECK_EQUAL(mean, state.dc);
+
+    // With smoothing it moves 1/2^n of the way
+    pre_fft_init(&state, DC_OFFSET, 2);
+    pre_fft_process(&state, raw, old_hanning_window, out, FRAME);
+    CHECK_EQUAL(DC_OFFSET + ((mean - DC_OFFSET) >> 2), state.dc);
+}
@@ -0,0 +1,75 @@
+// test_spsc_ring.cpp
+// The lock-free single-producer/single-consumer ring (src/utils/spsc_ring.h).
+
+#include <thread>
+
+#include "unit_test.h"
+#include "utils/spsc_ring.h"
+
+TEST(spsc_ring, fills_and_drains_in_order)
+{
+    static SpscRing<uint32_t, 8> ring;
+    uint32_t item;
+    CHECK(ring.empty());
+    CHECK(!ring.pop(item));
+    for (uint32_t i = 0; i < 8; ++i) {
+        CHECK(ring.push(i));
+    }
+    CHECK_EQUAL(8, ring.size());
+    CHECK(!ring.push(8));  // All slots are usable, and a full ring drops the new item
+    for (uint32_t i = 0; i < 8; ++i) {
+        CHECK(ring.pop(item));
+        CHECK_EQUAL(i, item);
+    }
+    CHECK(ring.empty());
+}
+
+// The indices are free-running, so the ring must keep working after they have gone round many times
+TEST(spsc_ring, wraps_around)
+{
+    static SpscRing<uint32_t, 4> ring;
+    uint32_t next_push = 0, next_pop = 0, item;
+    for (int round = 0; round < 10000; ++round) {
+        for (int i = 0; i < 3; ++i) {
+            CHECK(ring.push(next_push++));
+        }
+        for (int i = 0; i < 3; ++i) {
+            CHECK(ring.pop(item));
+            CHECK_EQUAL(next_pop++, item);
+        }
+    }
+    CHECK(ring.empty());
+}
+
+// One thread pushes a counting sequence while another pops it: every item must arrive once, intact and in order
+TEST(spsc_ring, two_threads)
+{
+    struct Item {
+        uint32_t sequence;
+        uint32_t check;
+    };
+    static SpscRing<Item, 64> ring;
+    const uint32_t count = 1000000;
+
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < count; ++i) {
+            while (!ring.push({ i, ~i })) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0, errors = 0;
+    Item item;
+    while (expected < count) {
+        if (!ring.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        errors += item.sequence != expected || item.check != ~expected;
+        expected++;
+    }
+    producer.join();
+    CHECK_EQUAL(0, errors);
+    CHECK(ring.empty());
+}
@@ -0,0 +1,175 @@
+// test_telemetry.cpp
+// Telemetry packets (src/utils/telemetry.h): CRC, COBS framing, and the encoder and decoder together.
+
+#include <string.h>
+#include <vector>
+
+#include "unit_test.h"
+#include "utils/telemetry.h"
+
+static uint32_t random_state = 1;
+static uint32_t next_random()
+{
+    random_state = random_state * 1664525u + 1013904223u;
+    return random_state >> 8;
+}
+
+TEST(telemetry, crc16_check_value)
+{
+    // The standard check value of CRC-16/CCITT-FALSE
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    CHECK_EQUAL(0x29B1, telemetry_crc16(check, sizeof(check)));
+
+    // Running the CRC over two parts gives the same result
+    CHECK_EQUAL(0x29B1, telemetry_crc16(check + 4, 5, telemetry_crc16(check, 4)));
+}
+
+TEST(telemetry, cobs_known_encodings)
+{
+    uint8_t output[8];
+    const uint8_t zero[] = {0x00};
+    CHECK_EQUAL(3, telemetry_cobs_encode(zero, sizeof(zero), output));
+    CHECK(memcmp(output, "\x01\x01\x00", 3) == 0);
+
+    const uint8_t mixed[] = {0x11, 0x22, 0x00, 0x33};
+    CHECK_EQUAL(6, telemetry_cobs_encode(mixed, sizeof(mixed), output));
+    CHECK(memcmp(output, "\x03\x11\x22\x02\x33\x00", 6) == 0);
+}
+
+// Every length around the 254-byte block limit, with and without zeros, comes back unchanged
+TEST(telemetry, cobs_round_trip)
+{
+    static uint8_t input[600];
+    static uint8_t encoded[600 + 600 / 254 + 2];
+    for (size_t length = 0; length <= sizeof(input); ++length) {
+        for (int zeros = 0; zeros < 3; ++zeros) {
+            for (size_t i = 0; i < length; ++i) {
+                input[i] = zeros == 0 ? (uint8_t)(1 + next_random() % 255)  // No zeros
+                         : zeros == 1 ? (uint8_t)(next_random() % 4)        // Many zeros
+                                      : (uint8_t)(next_random() % 256);
+            }
+            size_t written = telemetry_cobs_encode(input, length, encoded);
+            CHECK(written <= length + length / 254 + 2);
+            CHECK(memchr(encoded, 0, written - 1) == nullptr);
+            CHECK_EQUAL(0, encoded[written - 1]);
+
+            size_t decoded = telemetry_cobs_decode(encoded, written - 1);
+            CHECK_EQUAL(length, decoded);
+            CHECK(memcmp(encoded, input, length) == 0);
+        }
+    }
+}
+
+TEST(telemetry, cobs_rejects_malformed_blocks)
+{
+    uint8_t zero_code[] = {0x00, 0x11};
+    CHECK_EQUAL(0, telemetry_cobs_decode(zero_code, sizeof(zero_code)));
+    uint8_t too_long[] = {0x05, 0x11, 0x22};  // The code promises more bytes than there are
+    CHECK_EQUAL(0, telemetry_cobs_decode(too_long, sizeof(too_long)));
+}
+
+// Encode a packet of `count` random 6-byte records, remembering them in `records`
+static size_t encode_packet(TelemetryEncoder &encoder, int count, std::vector<uint8_t> &records, uint8_t *frame)
+{
+    encoder.begin(TELEMETRY_ACCELERATION, 6);
+    records.resize(6 * count);
+    for (int i = 0; i < count; ++i) {
+        for (int j = 0; j < 6; ++j) {
+            records[6 * i + j] = (uint8_t)(next_random() % 8);  // Plenty of zeros to escape
+        }
+        CHECK(encoder.add(&records[6 * i]));
+    }
+    return encoder.finish(1000u * count, 40000, frame);
+}
+
+TEST(telemetry, packets_round_trip)
+{
+    TelemetryEncoder encoder;
+    TelemetryDecoder decoder;
+    static uint8_t frame[TELEMETRY_MAX_FRAME];
+    std::vector<uint8_t> records;
+    for (int packet = 0; packet < 1000; ++packet) {
+        int count = 1 + (int)(next_random() % 40);
+        uint16_t sequence = encoder.next_sequence();
+        size_t length = encode_packet(encoder, count, records, frame);
+        CHECK(length <= TELEMETRY_MAX_FRAME);
+
+        // Only the delimiter completes the packet
+        for (size_t i = 0; i + 1 < length; ++i) {
+            CHECK(!decoder.push(frame[i]));
+        }
+        CHECK(decoder.push(frame[length - 1]));
+        CHECK_EQUAL(TELEMETRY_ACCELERATION, decoder.header().type);
+        CHECK_EQUAL(6, decoder.header().record_size);
+        CHECK_EQUAL(count, decoder.header().count);
+        CHECK_EQUAL(sequence, decoder.header().sequence);
+        CHECK_EQUAL(1000u * count, decoder.header().timestamp_us);
+        CHECK_EQUAL(40000, decoder.header().interval_us);
+        CHECK(memcmp(decoder.records(), records.data(), records.size()) == 0);
+    }
+    CHECK_EQUAL(1000, decoder.packets());
+    CHECK_EQUAL(0, decoder.crc_errors() + decoder.framing_errors() + decoder.lost());
+}
+
+TEST(telemetry, packets_full)
+{
+    TelemetryEncoder encoder;
+    encoder.begin(TELEMETRY_ACCELERATION, 6);
+    const uint8_t record[6] = {1, 2, 3, 4, 5, 6};
+    for (int i = 0; i < TELEMETRY_MAX_RECORDS_SIZE / 6; ++i) {
+        CHECK(encoder.add(record));
+    }
+    CHECK_EQUAL(0, encoder.space());
+    CHECK(!encoder.add(record));
+    CHECK_EQUAL(TELEMETRY_MAX_RECORDS_SIZE / 6, encoder.count());
+}
+
+// A damaged packet is dropped, and the decoder picks up again at the next one
+TEST(telemetry, corruption_and_loss)
+{
+    TelemetryEncoder encoder;
+    TelemetryDecoder decoder;
+    static uint8_t frame[TELEMETRY_MAX_FRAME];
+    std::vector<uint8_t> records;
+
+    // A flipped bit in the records fails the CRC (or, if it lands on a COBS code, the framing)
+    size_t length = encode_packet(encoder, 20, records, frame);
+    frame[length / 2] ^= 0x10;
+    for (size_t i = 0; i < length; ++i) {
+        decoder.push(frame[i]);
+    }
+    CHECK_EQUAL(0, decoder.packets());
+    CHECK_EQUAL(1, decoder.crc_errors() + decoder.framing_errors());
+
+    // The next packet decodes. Losses are counted from the first good packet, so the damaged one is not among them
+    length = encode_packet(encoder, 20, records, frame);
+    bool complete = false;
+    for (size_t i = 0; i < length; ++i) {
+        complete = decoder.push(frame[i]);
+    }
+    CHECK(complete);
+    CHECK_EQUAL(1, decoder.packets());
+    CHECK_EQUAL(1, decoder.header().sequence);
+    CHECK_EQUAL(0, decoder.lost());
+
+    // A packet cut off part way through (its tail lost) runs into the next one and is dropped; the one after it
+    // decodes, and both are counted as lost from the gap in the sequence
+    uint32_t errors = decoder.crc_errors() + decoder.framing_errors();
+    length = encode_packet(encoder, 20, records, frame);
+    for (size_t i = 0; i < length - 100; ++i) {
+        decoder.push(frame[i]);
+    }
+    length = encode_packet(encoder, 20, records, frame);
+    for (size_t i = 0; i < length; ++i) {
+        decoder.push(frame[i]);
+    }
+    CHECK_EQUAL(errors + 1, decoder.crc_errors() + decoder.framing_errors());
+    length = encode_packet(encoder, 20, records, frame);
+    for (size_t i = 0; i < length; ++i) {
+        complete = decoder.push(frame[i]);
+    }
+    CHECK(complete);
+    CHECK_EQUAL(4, decoder.header().sequence);
+    CHECK_EQUAL(2, decoder.packets());
+    CHECK_EQUAL(2, decoder.lost());
+}
@@ -0,0 +1,94 @@
+// test_uart_tx.cpp
+// UART transmit queue (src/drivers/uart_tx.h), sending through the mock UART's DMA pacing on the virtual clock.
+
+#include <stdio.h>
+#include <vector>
+
+#include "unit_test.h"
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#include "drivers/uart_tx.h"
+
+#define UART_TX_TEST_FILE "unit_test_uart_tx.bin"
+
+static void wait_until_sent(UartTx &tx)
+{
+    while (tx.is_busy()) {
+        tight_loop_contents();
+    }
+}
+
+// Messages of every length up to most of the queue wrap around its end many times and arrive whole and in order
+TEST(uart_tx, messages_arrive_in_order)
+{
+    mock_clock_set_virtual(true);
+    uart_init(uart1, 115200);
+    CHECK(mock_uart_set_output_file(uart1, UART_TX_TEST_FILE));
+    uint64_t line_start = mock_uart_bytes_sent(uart1);
+
+    UartTx tx(uart1, 100);  // Rounded up to 128
+    CHECK_EQUAL(128, tx.space());
+
+    std::vector<uint8_t> expected;
+    uint8_t message[100];
+    uint8_t next = 0;
+    for (int i = 0; i < 300; ++i) {
+        size_t length = 1 + (size_t)(i * 37) % 100;
+        for (size_t j = 0; j < length; ++j) {
+            message[j] = next++;
+        }
+        while (tx.space() < length) {
+            tight_loop_contents();
+        }
+        CHECK(tx.write(message, length));
+        expected.insert(expected.end(), message, message + length);
+    }
+    wait_until_sent(tx);
+    mock_uart_set_output_file(uart1, nullptr);
+
+    CHECK_EQUAL(expected.size(), tx.bytes_queued());
+    CHECK_EQUAL(expected.size(), tx.bytes_sent());
+    CHECK_EQUAL(0, tx.bytes_dropped());
+    CHECK_EQUAL(128, tx.space());
+    CHECK_EQUAL(expected.size(), mock_uart_bytes_sent(uart1) - line_start);
+
+    std::vector<uint8_t> received(expected.size() + 1);
+    FILE *file = fopen(UART_TX_TEST_FILE, "rb");
+    CHECK(file != nullptr);
+    if (file != nullptr) {
+        CHECK_EQUAL(expected.size(), fread(received.data(), 1, received.size(), file));
+        fclose(file);
+        received.resize(expected.size());
+        CHECK(received == expected);
+    }
+    remove(UART_TX_TEST_FILE);
+}
+
+// A message that does not fit is dropped whole and counted, and the queue carries on afterwards
+TEST(uart_tx, full_queue_drops_whole_messages)
+{
+    mock_clock_set_virtual(true);
+    uart_init(uart1, 115200);
+    uint64_t line_start = mock_uart_bytes_sent(uart1);
+
+    UartTx tx(uart1, 64);
+    uint8_t message[48] = {};
+    CHECK(tx.write(message, 48));
+    CHECK(tx.space() < 48);
+    CHECK(!tx.write(message, 48));
+    CHECK(!tx.write(message, 30));
+    CHECK_EQUAL(78, tx.bytes_dropped());
+    CHECK(tx.write(message, tx.space()));  // Exactly filling the queue is allowed
+    CHECK_EQUAL(0, tx.space());
+    CHECK(!tx.write(message, 1));
+    CHECK_EQUAL(79, tx.bytes_dropped());
+
+    wait_until_sent(tx);
+    uint32_t queued = tx.bytes_queued();
+    CHECK_EQUAL(queued, tx.bytes_sent());
+    CHECK_EQUAL(queued, mock_uart_bytes_sent(uart1) - line_start);
+    CHECK(tx.write(message, 48));
+    wait_until_sent(tx);
+    CHECK_EQUAL(queued + 48, tx.bytes_sent());
+    CHECK_EQUAL(79, tx.bytes_dropped());
+}
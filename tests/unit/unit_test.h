@@ -0,0 +1,48 @@
+// unit_test.h
+// A minimal test framework for the host unit tests. Each test is a function defined with TEST(suite, name) in one of
+// the test_*.cpp files; CHECK and CHECK_EQUAL record a failure and carry on, so one run reports every broken check.
+//
+//   unit_tests [suite]   run every test, or only those of one suite (each suite is registered with CTest)
+
+#ifndef UNIT_TEST_H
+#define UNIT_TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+typedef void (*UnitTestFunction)();
+
+// Registers a test when constructed (as a static object, before main runs)
+struct UnitTestRegistration {
+    UnitTestRegistration(const char *suite, const char *name, UnitTestFunction function);
+};
+
+// Record a failed check at `file`:`line`
+void unit_test_fail(const char *file, int line, const char *message);
+
+#define TEST(suite, name)                                                                          \
+    static void test_##suite##_##name();                                                           \
+    static UnitTestRegistration registration_##suite##_##name(#suite, #name, test_##suite##_##name); \
+    static void test_##suite##_##name()
+
+#define CHECK(condition)                                                                           \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            unit_test_fail(__FILE__, __LINE__, #condition);                                        \
+        }                                                                                          \
+    } while (0)
+
+// Compare two integers, printing both values on failure
+#define CHECK_EQUAL(expected, actual)                                                              \
+    do {                                                                                           \
+        long long expected_value = (long long)(expected);                                          \
+        long long actual_value = (long long)(actual);                                              \
+        if (expected_value != actual_value) {                                                      \
+            char message[256];                                                                     \
+            snprintf(message, sizeof(message), "%s == %s (expected %lld, got %lld)", #expected,    \
+                     #actual, expected_value, actual_value);                                       \
+            unit_test_fail(__FILE__, __LINE__, message);                                           \
+        }                                                                                          \
+    } while (0)
+
+#endif // UNIT_TEST_H
@@ -0,0 +1,54 @@
+// unit_tests.cpp
+// Runner for the host unit tests (see unit_test.h). Prints one line per test and exits with 1 if any check failed.
+
+#include <string.h>
+#include <vector>
+
+#include "unit_test.h"
+
+struct UnitTest {
+    const char *suite;
+    const char *name;
+    UnitTestFunction function;
+};
+
+// Function-local, so registrations from any translation unit find it constructed
+static std::vector<UnitTest> &registered_tests()
+{
+    static std::vector<UnitTest> tests;
+    return tests;
+}
+
+static unsigned int failed_checks = 0;
+
+UnitTestRegistration::UnitTestRegistration(const char *suite, const char *name, UnitTestFunction function)
+{
+    registered_tests().push_back({suite, name, function});
+}
+
+void unit_test_fail(const char *file, int line, const char *message)
+{
+    // Only the first few failures of a test are interesting; the rest are usually the same fault
+    if (++failed_checks <= 10) {
+        printf("  %s:%d: check failed: %s\n", file, line, message);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *suite = argc > 1 ? argv[1] : nullptr;
+    unsigned int run = 0, failed = 0;
+    for (const UnitTest &test : registered_tests()) {
+        if (suite != nullptr && strcmp(suite, test.suite) != 0) {
+            continue;
+        }
+        failed_checks = 0;
+        test.function();
+        printf("%s %s.%s\n", failed_checks == 0 ? "PASS" : "FAIL", test.suite, test.name);
+        fflush(stdout);
+        run++;
+        failed += failed_checks != 0;
+    }
+    printf("%u tests, %u failed\n", run, failed);
+    return run == 0 || failed != 0 ? 1 : 0;
+}
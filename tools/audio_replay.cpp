@@ -0,0 +1,202 @@
+// audio_replay.cpp
+// Host tool: play recordings through the microphone task's analysis and LED drawing as fast as the host allows.
+//
+//   audio_replay [-o <frames.csv>] [--compare <expected.csv>] <recordings...>
+//
+// Recordings are read by the mock ADC (16-bit PCM WAV or headerless raw audio, at MIC_SAMPLE_RATE) and cut into
+// hops of STFT_HOP_SIZE raw ADC codes, exactly as the DMA would capture them. Each hop goes through the same window,
+// FFT and band energy stages as on the device, and every analysed frame's LED colours are written to the -o file:
+//
+//   file,frame,time_ms,led0,led1,...   (colours as RRGGBB hex; time_ms is the end of the frame in the recording)
+//
+// A summary of the processing time per frame is printed for each recording, followed by the trace statistics of
+// each stage. With --compare, the frames are checked against an earlier -o file (recordings are matched by the
+// path given on the command line) and the exit code is 1 if any frame differs.
+//
+// Build with optimisation (e.g. CMAKE_BUILD_TYPE=Release) for meaningful timings. Without the CMSIS-DSP submodule
+// the FFT is the test harness's stand-in, which is not bit-exact with CMSIS-DSP (see tests/mocks/cmsis/arm_math.h).
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "tasks/task_manager.h"
+#include "board.h"
+#include "drivers/leds.h"
+#include "tasks/microphone_task.h"
+#include "utils/trace.h"
+#include "hardware/adc.h"
+
+// The globals that main.cpp defines for the tasks
+volatile Tasks current_task = MICROPHONE_TASK;
+LEDs led_strip(LED_PIN, NUM_LEDS, pio0, 0);
+
+// Frames of an expected output file, by recording and frame number
+typedef std::map<std::pair<std::string, uint32_t>, std::string> FrameMap;
+
+// Split a line of the frames file into the recording, the frame number and the rest (time and colours)
+static bool parse_frame_line(const std::string& line, std::string& file, uint32_t& frame, std::string& rest) {
+    size_t first = line.find(',');
+    size_t second = first == std::string::npos ? std::string::npos : line.find(',', first + 1);
+    if (second == std::string::npos) {
+        return false;
+    }
+    file = line.substr(0, first);
+    frame = (uint32_t)strtoul(line.c_str() + first + 1, nullptr, 10);
+    rest = line.substr(second + 1);
+    return true;
+}
+
+static bool read_expected(const char* path, FrameMap& frames) {
+    FILE* input = fopen(path, "r");
+    if (input == nullptr) {
+        return false;
+    }
+    char buffer[1024];
+    bool header = true;
+    while (fgets(buffer, sizeof(buffer), input) != nullptr) {
+        std::string line(buffer);
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+            line.pop_back();
+        }
+        std::string file, rest;
+        uint32_t frame;
+        if (header) {
+            header = false;
+        } else if (parse_frame_line(line, file, frame, rest)) {
+            frames[{file, frame}] = rest;
+        }
+    }
+    fclose(input);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* output_path = nullptr;
+    const char* expected_path = nullptr;
+    int first_file = 1;
+    while (first_file < argc && argv[first_file][0] == '-') {
+        if (strcmp(argv[first_file], "-o") == 0 && first_file + 1 < argc) {
+            output_path = argv[first_file + 1];
+        } else if (strcmp(argv[first_file], "--compare") == 0 && first_file + 1 < argc) {
+            expected_path = argv[first_file + 1];
+        } else {
+            break;
+        }
+        first_file += 2;
+    }
+    if (first_file >= argc) {
+        fprintf(stderr, "Usage: %s [-o <frames.csv>] [--compare <expected.csv>] <recordings...>\n", argv[0]);
+        return 1;
+    }
+
+    FrameMap expected;
+    if (expected_path != nullptr && !read_expected(expected_path, expected)) {
+        fprintf(stderr, "Could not open %s\n", expected_path);
+        return 1;
+    }
+    FILE* output = nullptr;
+    if (output_path != nullptr) {
+        output = fopen(output_path, "w");
+        if (output == nullptr) {
+            fprintf(stderr, "Could not create %s\n", output_path);
+            return 1;
+        }
+        fprintf(output, "file,frame,time_ms");
+        for (int led = 0; led < NUM_LEDS; ++led) {
+            fprintf(output, ",led%d", led);
+        }
+        fprintf(output, "\n");
+    }
+
+    // Sample at the microphone's rate (as microphone::init() sets it) and play each recording once
+    adc_set_clkdiv(48000000.0f / MIC_SAMPLE_RATE - 1.0f);
+    mock_adc_set_loop(false);
+
+    // The summary is printed at the end, clear of the mock ADC's messages
+    std::string summary =
+        "recording,frames,audio_ms,processing_ms,us_per_frame,max_us_per_frame,realtime_factor,mismatches\n";
+    uint32_t total_mismatches = 0;
+    for (int i = first_file; i < argc; ++i) {
+        const char* path = argv[i];
+        if (!mock_adc_load_file(path)) {
+            fprintf(stderr, "Could not load %s\n", path);
+            return 1;
+        }
+        microphone_task_replay_reset();
+
+        uint16_t hop[STFT_HOP_SIZE];
+        uint32_t hops = 0, frames = 0, mismatches = 0;
+        double processing_us = 0.0, max_frame_us = 0.0;
+        for (;;) {
+            size_t count = 0;
+            while (count < STFT_HOP_SIZE && !mock_adc_finished()) {
+                hop[count++] = mock_adc_next_sample();
+            }
+            if (count < STFT_HOP_SIZE) {
+                break;  // A partial hop is left over at the end of the recording
+            }
+            hops++;
+
+            auto start = std::chrono::steady_clock::now();
+            bool drawn = microphone_task_replay_hop(hop);
+            double elapsed_us =
+                std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            processing_us += elapsed_us;
+            if (!drawn) {
+                continue;
+            }
+            frames++;
+            if (elapsed_us > max_frame_us) {
+                max_frame_us = elapsed_us;
+            }
+
+            // The frame's time and colours, as written to the output file
+            char line[32 + 7 * NUM_LEDS];
+            int length = snprintf(line, sizeof(line), "%.1f", hops * STFT_HOP_SIZE * 1000.0 / MIC_SAMPLE_RATE);
+            for (int led = 0; led < NUM_LEDS; ++led) {
+                length += snprintf(line + length, sizeof(line) - length, ",%06x", (unsigned)led_strip.getColor(led));
+            }
+            if (output != nullptr) {
+                fprintf(output, "%s,%u,%s\n", path, (unsigned)(frames - 1), line);
+            }
+            if (expected_path != nullptr) {
+                auto entry = expected.find({path, frames - 1});
+                if (entry == expected.end() || entry->second != line) {
+                    if (mismatches == 0) {
+                        fprintf(stderr, "%s: frame %u differs: %s, expected %s\n", path, (unsigned)(frames - 1), line,
+                                entry == expected.end() ? "no frame" : entry->second.c_str());
+                    }
+                    mismatches++;
+                }
+            }
+        }
+        if (expected_path != nullptr && expected.count({path, frames}) != 0) {
+            fprintf(stderr, "%s: fewer frames than expected\n", path);
+            mismatches++;
+        }
+        total_mismatches += mismatches;
+
+        double audio_ms = hops * STFT_HOP_SIZE * 1000.0 / MIC_SAMPLE_RATE;
+        char row[512];
+        snprintf(row, sizeof(row), "%s,%u,%.1f,%.3f,%.2f,%.2f,%.1f,%u\n", path, (unsigned)frames, audio_ms,
+                 processing_us / 1000.0, frames ? processing_us / frames : 0.0, max_frame_us,
+                 processing_us > 0.0 ? audio_ms * 1000.0 / processing_us : 0.0, (unsigned)mismatches);
+        summary += row;
+    }
+    if (output != nullptr) {
+        fclose(output);
+    }
+
+    printf("\n%s\n", summary.c_str());
+    trace_print_stats();
+    if (expected_path != nullptr) {
+        printf("\n%u frames differ from %s\n", (unsigned)total_mismatches, expected_path);
+    }
+    return total_mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,349 @@
+// log_tokens.cpp
+// Host tool for tokenized logging (LOG_TOKENIZED):
+//
+//   log_tokens dictionary [-o <file>] <source files...>
+//                                              Write the token dictionary (CSV) for the LOG_ macros in the sources
+//   log_tokens decode <dictionary> [capture]   Turn a console capture (default: stdin) back into text
+//
+// The build runs the first command to generate log_dictionary.csv from the application sources. Decoding passes
+// any line that is not a tokenized message through unchanged, so a capture can contain ordinary printf output too.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "drivers/logging/logging.h"
+
+// Names of the macros whose first argument is a format string to tokenize
+static const char* const log_macros[] = {"LOG_VERBOSE", "LOG_INFO", "LOG_WARNING", "LOG_ERROR"};
+
+static bool read_file(const char* path, std::string& contents) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        contents.append(buffer, length);
+    }
+    fclose(file);
+    return true;
+}
+
+static bool is_identifier_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static size_t skip_space(const std::string& text, size_t pos) {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) {
+        pos++;
+    }
+    return pos;
+}
+
+// Parse the string literal starting at `pos` (the opening quote), appending its value to `value`. Returns the
+// position after the closing quote, or 0 if the literal is malformed.
+static size_t parse_literal(const std::string& text, size_t pos, std::string& value) {
+    pos++;
+    while (pos < text.size() && text[pos] != '"') {
+        char c = text[pos++];
+        if (c == '\n') {
+            return 0;
+        }
+        if (c != '\\') {
+            value += c;
+            continue;
+        }
+        if (pos >= text.size()) {
+            return 0;
+        }
+        char escape = text[pos++];
+        switch (escape) {
+        case 'n': value += '\n'; break;
+        case 't': value += '\t'; break;
+        case 'r': value += '\r'; break;
+        case '0': value += '\0'; break;
+        case 'x': {
+            unsigned int code = 0;
+            while (pos < text.size() && isxdigit((unsigned char)text[pos])) {
+                code = code * 16 + (isdigit((unsigned char)text[pos]) ? text[pos] - '0' : (tolower(text[pos]) - 'a' + 10));
+                pos++;
+            }
+            value += (char)code;
+            break;
+        }
+        default: value += escape; break;  // \\, \", \' and \?
+        }
+    }
+    return pos < text.size() ? pos + 1 : 0;
+}
+
+// Add the format strings of every LOG_ macro call in `text` to `formats`
+static void scan_source(const std::string& text, std::vector<std::string>& formats) {
+    for (const char* macro : log_macros) {
+        size_t macro_length = strlen(macro);
+        for (size_t pos = text.find(macro); pos != std::string::npos; pos = text.find(macro, pos + 1)) {
+            if ((pos > 0 && is_identifier_char(text[pos - 1])) ||
+                (pos + macro_length < text.size() && is_identifier_char(text[pos + macro_length]))) {
+                continue;
+            }
+            size_t next = skip_space(text, pos + macro_length);
+            if (next >= text.size() || text[next] != '(') {
+                continue;
+            }
+
+            // The format may be split into adjacent literals
+            std::string format;
+            bool found = false;
+            next = skip_space(text, next + 1);
+            while (next < text.size() && text[next] == '"') {
+                next = parse_literal(text, next, format);
+                if (next == 0) {
+                    break;
+                }
+                found = true;
+                next = skip_space(text, next);
+            }
+            if (found && next != 0) {
+                formats.push_back(format);
+            }
+        }
+    }
+}
+
+static void print_csv_field(FILE* output, const std::string& value) {
+    fputc('"', output);
+    for (char c : value) {
+        if (c == '"') {
+            fputc('"', output);
+        }
+        fputc(c, output);
+    }
+    fputc('"', output);
+}
+
+static int make_dictionary(FILE* output, int count, char** paths) {
+    std::map<uint32_t, std::string> dictionary;
+    bool collision = false;
+    for (int i = 0; i < count; ++i) {
+        std::string text;
+        if (!read_file(paths[i], text)) {
+            fprintf(stderr, "Could not open %s\n", paths[i]);
+            return 1;
+        }
+        std::vector<std::string> formats;
+        scan_source(text, formats);
+        for (const std::string& format : formats) {
+            uint32_t token = logToken(format.c_str());
+            auto existing = dictionary.find(token);
+            if (existing != dictionary.end() && existing->second != format) {
+                fprintf(stderr, "%s: token %08x of \"%s\" collides with \"%s\"; reword one of them\n", paths[i],
+                        token, format.c_str(), existing->second.c_str());
+                collision = true;
+            }
+            dictionary[token] = format;
+        }
+    }
+
+    fprintf(output, "token,format\n");
+    for (const auto& entry : dictionary) {
+        fprintf(output, "%08x,", entry.first);
+        print_csv_field(output, entry.second);
+        fprintf(output, "\n");
+    }
+    return collision ? 1 : 0;
+}
+
+// Read a dictionary written by make_dictionary(). Quoted fields may span lines.
+static bool read_dictionary(const char* path, std::map<uint32_t, std::string>& dictionary) {
+    std::string text;
+    if (!read_file(path, text)) {
+        return false;
+    }
+    size_t pos = text.find('\n');  // Skip the header
+    while (pos != std::string::npos && pos + 1 < text.size()) {
+        pos++;
+        uint32_t token = (uint32_t)strtoul(text.c_str() + pos, nullptr, 16);
+        pos = text.find(",\"", pos);
+        if (pos == std::string::npos) {
+            break;
+        }
+        pos += 2;
+        std::string format;
+        while (pos < text.size()) {
+            if (text[pos] == '"') {
+                if (pos + 1 < text.size() && text[pos + 1] == '"') {
+                    format += '"';
+                    pos += 2;
+                    continue;
+                }
+                pos++;
+                break;
+            }
+            format += text[pos++];
+        }
+        dictionary[token] = format;
+        pos = text.find('\n', pos);
+    }
+    return true;
+}
+
+static int base64_value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+static bool read_varint(const std::vector<uint8_t>& data, size_t& pos, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && pos < data.size(); shift += 7) {
+        uint8_t byte = data[pos++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Decode one tokenized line (without the '$' and newline) into text. Returns false if it is not a valid message.
+static bool decode_message(const std::string& encoded, const std::map<uint32_t, std::string>& dictionary,
+                           std::string& text) {
+    std::vector<uint8_t> data;
+    uint32_t bits = 0;
+    int bit_count = 0;
+    for (char c : encoded) {
+        if (c == '=') {
+            break;
+        }
+        int value = base64_value(c);
+        if (value < 0) {
+            return false;
+        }
+        bits = (bits << 6) | (uint32_t)value;
+        bit_count += 6;
+        if (bit_count >= 8) {
+            bit_count -= 8;
+            data.push_back((uint8_t)(bits >> bit_count));
+        }
+    }
+    if (data.size() < 6) {
+        return false;
+    }
+
+    uint32_t token = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+    uint8_t level = data[4];
+    size_t pos = 5;
+    uint32_t time;
+    if (!read_varint(data, pos, time)) {
+        return false;
+    }
+    uint32_t args[LOG_MAX_ARGS] = {};
+    unsigned int arg_count = 0;
+    while (pos < data.size()) {
+        uint32_t zigzag;
+        if (arg_count == LOG_MAX_ARGS || !read_varint(data, pos, zigzag)) {
+            return false;
+        }
+        args[arg_count++] = (zigzag >> 1) ^ (0u - (zigzag & 1));
+    }
+
+    static const char* const level_names[] = {"Verbose", "Information", "Warning", "Error"};
+    char buffer[512];
+    uint32_t time_ms = time / 1000;
+    snprintf(buffer, sizeof(buffer), "[%u.%03u %s]: ", time_ms / 1000, time_ms % 1000,
+             level < 4 ? level_names[level] : "Error");
+    text = buffer;
+
+    auto entry = dictionary.find(token);
+    if (entry == dictionary.end()) {
+        snprintf(buffer, sizeof(buffer), "<unknown token %08x>", token);
+        text += buffer;
+        for (unsigned int i = 0; i < arg_count; ++i) {
+            snprintf(buffer, sizeof(buffer), " %d", (int)args[i]);
+            text += buffer;
+        }
+    } else if (arg_count == 0) {
+        text += entry->second;  // Printed as it is, as on the device
+    } else {
+        snprintf(buffer, sizeof(buffer), entry->second.c_str(), args[0], args[1], args[2], args[3]);
+        text += buffer;
+    }
+    return true;
+}
+
+static int decode(const char* dictionary_path, const char* capture_path) {
+    std::map<uint32_t, std::string> dictionary;
+    if (!read_dictionary(dictionary_path, dictionary)) {
+        fprintf(stderr, "Could not open %s\n", dictionary_path);
+        return 1;
+    }
+    FILE* input = stdin;
+    if (capture_path != nullptr) {
+        input = fopen(capture_path, "rb");
+        if (input == nullptr) {
+            fprintf(stderr, "Could not open %s\n", capture_path);
+            return 1;
+        }
+    }
+
+    unsigned int decoded = 0, errors = 0;
+    std::string line;
+    int c;
+    do {
+        c = fgetc(input);
+        if (c != EOF && c != '\n') {
+            line += (char)c;
+            continue;
+        }
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        std::string text;
+        if (line.size() > 1 && line[0] == '$' && decode_message(line.substr(1), dictionary, text)) {
+            printf("%s\n", text.c_str());
+            decoded++;
+        } else {
+            if (!line.empty() && line[0] == '$') {
+                errors++;
+            }
+            if (c != EOF || !line.empty()) {
+                printf("%s\n", line.c_str());
+            }
+        }
+        line.clear();
+    } while (c != EOF);
+
+    fprintf(stderr, "%u messages decoded, %u malformed\n", decoded, errors);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && strcmp(argv[1], "dictionary") == 0) {
+        if (argc >= 4 && strcmp(argv[2], "-o") == 0) {
+            FILE* output = fopen(argv[3], "w");
+            if (output == nullptr) {
+                fprintf(stderr, "Could not create %s\n", argv[3]);
+                return 1;
+            }
+            int result = make_dictionary(output, argc - 4, argv + 4);
+            fclose(output);
+            return result;
+        }
+        return make_dictionary(stdout, argc - 2, argv + 2);
+    }
+    if ((argc == 3 || argc == 4) && strcmp(argv[1], "decode") == 0) {
+        return decode(argv[2], argc == 4 ? argv[3] : nullptr);
+    }
+    fprintf(stderr, "Usage: %s dictionary [-o <file>] <source files...>\n       %s decode <dictionary> [capture]\n", argv[0],
+            argv[0]);
+    return 1;
+}
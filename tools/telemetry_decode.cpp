@@ -0,0 +1,52 @@
+// telemetry_decode.cpp
+// Host tool: decode a capture of the Bluetooth telemetry stream (e.g. the file written by the test harness when
+// MOCK_UART_FILE is set, or bytes logged from the Bluetooth module's serial port) and print the records as CSV.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "utils/telemetry.h"
+
+int main(int argc, char** argv) {
+    FILE* input = stdin;
+    if (argc > 1) {
+        input = fopen(argv[1], "rb");
+        if (input == nullptr) {
+            fprintf(stderr, "Could not open %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    TelemetryDecoder decoder;
+    printf("sequence,timestamp_us,type,values\n");
+    int c;
+    while ((c = fgetc(input)) != EOF) {
+        if (!decoder.push((uint8_t)c)) {
+            continue;
+        }
+
+        // Spread the packet's timestamp back over its records using the interval
+        const TelemetryHeader& header = decoder.header();
+        for (int i = 0; i < header.count; ++i) {
+            const uint8_t* record = decoder.records() + i * header.record_size;
+            uint32_t timestamp = header.timestamp_us - (uint32_t)(header.count - 1 - i) * header.interval_us;
+            printf("%u,%u,%u", header.sequence, timestamp, header.type);
+            if (header.type == TELEMETRY_ACCELERATION && header.record_size == 6) {
+                int16_t mg[3];
+                memcpy(mg, record, sizeof(mg));
+                printf(",%d,%d,%d", mg[0], mg[1], mg[2]);
+            } else if (header.type == TELEMETRY_BAND_ENERGY) {
+                for (int j = 0; j + 4 <= header.record_size; j += 4) {
+                    uint32_t energy;
+                    memcpy(&energy, record + j, sizeof(energy));
+                    printf(",%u", energy);
+                }
+            }
+            printf("\n");
+        }
+    }
+
+    fprintf(stderr, "%u packets, %u lost, %u CRC errors, %u framing errors\n", decoder.packets(), decoder.lost(),
+            decoder.crc_errors(), decoder.framing_errors());
+    return 0;
+}